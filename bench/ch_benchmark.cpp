@@ -0,0 +1,1169 @@
+// CH lab
+// micro- and macro-benchmarks of the collision and GO kernels, without any window or haptic device
+//
+// usage: ch_benchmark [--sizes 12,1000,...] [--out results.jsonl] [--label name] [--min-time seconds]
+//
+// every measurement is printed as a table row and, with --out, appended as one JSON object per line
+// so that runs of different commits can be compared
+
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+#include "../src/ch_segmentTriangleCollisionChecker.h"
+#include "../src/ch_collisionWorld.h"
+#include "../src/ch_deviceIO.h"
+#include "../src/ch_devicePredictor.h"
+#include "../src/ch_featureTracker.h"
+#include "../src/ch_GOAlgorithm.h"
+#include "../src/ch_GOBatch.h"
+#include "../src/ch_plane.h"
+#include "../src/ch_sceneGenerator.h"
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// default mesh sizes in triangles
+const unsigned int DEFAULT_SIZES[] = { 12, 1000, 10000, 100000, 1000000, 10000000 };
+
+// numbers of objects in the scene benchmarks
+const unsigned int SCENE_SIZES[] = { 10, 100, 1000 };
+
+// number of segments / points per distribution
+const unsigned int NUM_SAMPLES = 4096;
+
+// device step used for the segments, relative to the edge of the test cube
+const double STEP_LENGTH = 0.01;
+
+// sessions and ticks of the GO batch benchmark
+const unsigned int BATCH_SESSIONS = 16384;
+const unsigned int BATCH_TICKS = 64;
+
+// simulated device for the predictor: ticks [s], age of a reading and time until its force is applied [ticks],
+// and the noise [m] of a reading
+const double DEVICE_TICK = 0.001;
+const unsigned int DEVICE_LATENCY = 2;
+const unsigned int DEVICE_FORCE_DELAY = 1;
+const double DEVICE_NOISE = 1.0e-5;
+
+// simulated USB device for the transfer thread: time [s] a reading and a force transfer block, and the
+// computation of a haptic tick
+const double DEVICE_READ_TIME = 0.00025;
+const double DEVICE_WRITE_TIME = 0.00025;
+const double TICK_COMPUTE_TIME = 0.0004;
+
+
+//---------------------------------------------------------------------------
+// DECLARED VARIABLES
+//---------------------------------------------------------------------------
+
+// minimum time spent per measurement
+double minTime = 0.2;
+
+// label written with every result, eg. the commit under test
+string label = "local";
+
+// machine-readable output, one JSON object per line
+FILE* jsonFile = NULL;
+
+// keeps the compiler from dropping the measured calls
+volatile double sink = 0.0;
+
+// random generator state, reset for every mesh so that runs are comparable
+unsigned int seed = 1;
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// uniform random number in [0, 1)
+double random01()
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) / 16777216.0;
+}
+
+
+// hardware cache miss counter, where the platform offers one
+class cacheMissCounter
+{
+public:
+	cacheMissCounter()
+	{
+		fd = -1;
+#if defined(__linux__)
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+
+	~cacheMissCounter()
+	{
+#if defined(__linux__)
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+
+	// is the counter available?
+	bool available() const { return fd >= 0; }
+
+	void start()
+	{
+#if defined(__linux__)
+		if (fd >= 0)
+		{
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	// misses since start(), -1 if not available
+	long long stop()
+	{
+		long long count = -1;
+#if defined(__linux__)
+		if (fd >= 0)
+		{
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &count, sizeof(count)) != sizeof(count))
+				count = -1;
+		}
+#endif
+		return count;
+	}
+
+protected:
+	int fd;
+};
+
+cacheMissCounter cacheMisses;
+
+
+// print one result and append it to the JSON file
+void report(const char* kernel, unsigned int numTriangles, const char* distribution, const char* variant, unsigned long long ops, double seconds, long long misses)
+{
+	double nsPerOp = 1.0e9 * seconds / ops;
+	double missesPerOp = (misses >= 0) ? (double)misses / ops : -1.0;
+
+	if (misses >= 0)
+		printf("%-32s %9u %-8s %-10s %12.1lf ns/op %10.3lf misses/op\n", kernel, numTriangles, distribution, variant, nsPerOp, missesPerOp);
+	else
+		printf("%-32s %9u %-8s %-10s %12.1lf ns/op        n/a misses/op\n", kernel, numTriangles, distribution, variant, nsPerOp);
+
+	if (jsonFile)
+	{
+		fprintf(jsonFile, "{\"label\":\"%s\",\"kernel\":\"%s\",\"triangles\":%u,\"distribution\":\"%s\",\"variant\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.3lf,",
+			label.c_str(), kernel, numTriangles, distribution, variant, ops, nsPerOp);
+		if (misses >= 0)
+			fprintf(jsonFile, "\"cache_misses_per_op\":%.4lf}\n", missesPerOp);
+		else
+			fprintf(jsonFile, "\"cache_misses_per_op\":null}\n");
+		fflush(jsonFile);
+	}
+}
+
+
+// cube of edge 1 centered at the origin with every face split into n x n quads, 12 n^2 triangles,
+// outward winding as in createCube()
+cMultiMesh* createTessellatedCube(unsigned int n)
+{
+	cMesh* mesh = new cMesh();
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int side = -1; side <= 1; side += 2)
+		{
+			// in-plane axes ordered so that u x v points along the outward normal
+			int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			if (side < 0)
+				swap(u, v);
+
+			unsigned int base = mesh->getNumVertices();
+			for (unsigned int j = 0; j <= n; j++)
+			{
+				for (unsigned int i = 0; i <= n; i++)
+				{
+					cVector3d p;
+					p(axis) = 0.5 * side;
+					p(u) = -0.5 + (double)i / n;
+					p(v) = -0.5 + (double)j / n;
+					mesh->newVertex(p);
+				}
+			}
+
+			for (unsigned int j = 0; j < n; j++)
+			{
+				for (unsigned int i = 0; i < n; i++)
+				{
+					unsigned int v00 = base + j * (n + 1) + i;
+					mesh->newTriangle(v00, v00 + 1, v00 + n + 2);
+					mesh->newTriangle(v00, v00 + n + 2, v00 + n + 1);
+				}
+			}
+		}
+	}
+
+	cMultiMesh* multiMesh = new cMultiMesh();
+	multiMesh->addMesh(mesh);
+	multiMesh->computeGlobalPositions(true);
+	return multiMesh;
+}
+
+
+// generated mesh of about numTriangles triangles, see ch_sceneGenerator
+cMultiMesh* createGeneratedMesh(ch_sceneType type, unsigned int numTriangles)
+{
+	ch_sceneGenerator generator;
+	generator.ch_generate(type, numTriangles);
+
+	const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& vertices = generator.ch_getVertices();
+	const vector<unsigned int>& indices = generator.ch_getIndices();
+
+	cMesh* mesh = new cMesh();
+	for (unsigned int v = 0; v < vertices.size(); v++)
+		mesh->newVertex(ch_toCVector3d(vertices[v]));
+	for (unsigned int i = 0; i < generator.ch_getNumTriangles(); i++)
+		mesh->newTriangle(indices[3 * i], indices[3 * i + 1], indices[3 * i + 2]);
+
+	cMultiMesh* multiMesh = new cMultiMesh();
+	multiMesh->addMesh(mesh);
+	multiMesh->computeGlobalPositions(true);
+	return multiMesh;
+}
+
+
+// random point on the surface of the test cube with its outward normal; onEdge snaps it onto a
+// tessellation line
+void randomSurfacePoint(unsigned int n, bool onEdge, cVector3d& point, cVector3d& normal)
+{
+	int axis = (int)(3.0 * random01());
+	double side = (random01() < 0.5) ? -0.5 : 0.5;
+	double a = random01() - 0.5, b = random01() - 0.5;
+
+	if (onEdge)
+		a = floor((a + 0.5) * n + 0.5) / n - 0.5;
+
+	point.zero();
+	normal.zero();
+	point(axis) = side;
+	point((axis + 1) % 3) = a;
+	point((axis + 2) % 3) = b;
+	normal(axis) = (side > 0.0) ? 1.0 : -1.0;
+}
+
+
+// device segments of one distribution: "hit" enters the surface, "miss" stays in free space,
+// "graze" enters at a shallow angle exactly on a tessellation edge
+void createSegments(const char* distribution, unsigned int n, vector<cVector3d>& starts, vector<cVector3d>& ends)
+{
+	starts.resize(NUM_SAMPLES);
+	ends.resize(NUM_SAMPLES);
+
+	for (unsigned int i = 0; i < NUM_SAMPLES; i++)
+	{
+		cVector3d point, normal, tangent;
+		randomSurfacePoint(n, strcmp(distribution, "graze") == 0, point, normal);
+
+		// a tangent direction in the face
+		tangent.set(normal(1), normal(2), normal(0));
+
+		if (strcmp(distribution, "hit") == 0)
+		{
+			starts[i] = point + normal * (0.5 * STEP_LENGTH);
+			ends[i] = point - normal * (0.5 * STEP_LENGTH);
+		}
+		else if (strcmp(distribution, "miss") == 0)
+		{
+			starts[i] = point + normal * (2.0 * STEP_LENGTH) + tangent * (STEP_LENGTH * (random01() - 0.5));
+			ends[i] = starts[i] + normal * STEP_LENGTH;
+		}
+		else
+		{
+			starts[i] = point + normal * (0.05 * STEP_LENGTH) - tangent * (0.5 * STEP_LENGTH);
+			ends[i] = point - normal * (0.05 * STEP_LENGTH) + tangent * (0.5 * STEP_LENGTH);
+		}
+	}
+}
+
+
+// segments crossing one triangle: "hit" through its centroid, "miss" through a point outside it,
+// "graze" through the middle of an edge
+void createTriangleSegment(const char* distribution, const ch_plane& plane, const cVector3d& v0, const cVector3d& v1, const cVector3d& v2, cVector3d& start, cVector3d& end)
+{
+	cVector3d point;
+	if (strcmp(distribution, "hit") == 0)
+		point = (v0 + v1 + v2) * (1.0 / 3.0);
+	else if (strcmp(distribution, "miss") == 0)
+		point = v0 * 2.0 - (v1 + v2) * 0.5;
+	else
+		point = (v0 + v1) * 0.5;
+
+	cVector3d normal = plane.ch_getPlaneNormal();
+	start = point + normal * (0.5 * STEP_LENGTH);
+	end = point - normal * (0.5 * STEP_LENGTH);
+}
+
+
+// world space vertices of a triangle
+void triangleVertices(cMultiMesh* object, unsigned int index, cVector3d& v0, cVector3d& v1, cVector3d& v2)
+{
+	v0 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex0(index));
+	v1 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex1(index));
+	v2 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex2(index));
+}
+
+
+// run body(i) for i = 0, 1, ... in rounds of batch calls until minTime has passed
+template <class Body>
+void measure(const char* kernel, unsigned int numTriangles, const char* distribution, const char* variant, unsigned int batch, Body body)
+{
+	cPrecisionClock clock;
+	unsigned long long ops = 0;
+	double seconds = 0.0;
+
+	cacheMisses.start();
+	clock.reset();
+	clock.start();
+	do
+	{
+		for (unsigned int i = 0; i < batch; i++)
+			body(i);
+		ops += batch;
+		seconds = clock.getCurrentTimeSeconds();
+	} while (seconds < minTime);
+	clock.stop();
+	long long misses = cacheMisses.stop();
+
+	report(kernel, numTriangles, distribution, variant, ops, seconds, misses);
+}
+
+
+// all benchmarks on one mesh
+void benchmarkMesh(unsigned int targetTriangles)
+{
+	unsigned int n = (unsigned int)cMax(1.0, floor(sqrt(targetTriangles / 12.0) + 0.5));
+	const char* distributions[] = { "hit", "miss", "graze" };
+
+	seed = 1;
+	cMultiMesh* object = createTessellatedCube(n);
+	unsigned int numTriangles = object->getNumTriangles();
+
+	printf("\n--- %u triangles ---\n", numTriangles);
+
+	// plane computation over all triangles
+	vector<ch_plane> planes(numTriangles);
+	measure("ch_plane::ch_computePlane", numTriangles, "-", "-", cMin(numTriangles, 4096u), [&](unsigned int i)
+	{
+		planes[i % numTriangles].ch_computePlane(i % numTriangles, object);
+	});
+	for (unsigned int i = 0; i < numTriangles; i++)
+		planes[i].ch_computePlane(i, object);
+
+	// load-time decimation into a collision proxy; the flat faces of the cube collapse almost completely
+	if (numTriangles <= 100000)
+	{
+		ch_collisionProxy proxy;
+		measure("ch_collisionProxy::ch_build", numTriangles, "-", "1mm", 1, [&](unsigned int)
+		{
+			proxy.ch_build(object, 0.001);
+		});
+		printf("collision proxy: %u of %u triangles\n", proxy.ch_getProxyObject()->getNumTriangles(), numTriangles);
+	}
+
+	ch_segmentTriangleCollisionChecker checker(object);
+	cVector3d intersectionPt;
+
+	ch_segmentTriangleCollisionChecker fieldChecker(object);
+	fieldChecker.ch_setBroadphase(CH_BROADPHASE_GRID);
+	fieldChecker.ch_buildDistanceField();
+
+	for (int d = 0; d < 3; d++)
+	{
+		const char* distribution = distributions[d];
+
+		// per triangle kernels, on triangles spread over the mesh
+		vector<unsigned int> triangles(NUM_SAMPLES);
+		vector<cVector3d> starts(NUM_SAMPLES), ends(NUM_SAMPLES), points(NUM_SAMPLES), corners(3 * NUM_SAMPLES);
+		for (unsigned int i = 0; i < NUM_SAMPLES; i++)
+		{
+			triangles[i] = (unsigned int)(random01() * numTriangles);
+			triangleVertices(object, triangles[i], corners[3 * i], corners[3 * i + 1], corners[3 * i + 2]);
+			createTriangleSegment(distribution, planes[triangles[i]], corners[3 * i], corners[3 * i + 1], corners[3 * i + 2], starts[i], ends[i]);
+			points[i] = (starts[i] + ends[i]) * 0.5;
+		}
+
+		measure("ch_checkSegTriangleCollision", numTriangles, distribution, "-", NUM_SAMPLES, [&](unsigned int i)
+		{
+			sink += checker.ch_checkSegTriangleCollision(triangles[i], starts[i], ends[i], intersectionPt);
+		});
+
+		measure("ch_pointInTriangle", numTriangles, distribution, "-", NUM_SAMPLES, [&](unsigned int i)
+		{
+			sink += checker.ch_pointInTriangle(points[i], corners[3 * i], corners[3 * i + 1], corners[3 * i + 2]);
+		});
+
+		measure("ch_sameSide", numTriangles, distribution, "-", NUM_SAMPLES, [&](unsigned int i)
+		{
+			sink += checker.ch_sameSide(points[i], corners[3 * i + 2], corners[3 * i], corners[3 * i + 1]);
+		});
+
+		// full queries through every broadphase, the test cube is convex
+		createSegments(distribution, n, starts, ends);
+
+		const char* broadphases[] = { "linear", "grid", "tree", "convex", "compact" };
+		for (int b = 0; b < 5; b++)
+		{
+			checker.ch_setBroadphase((ch_broadphaseType)b);
+
+			// a full linear scan of a large mesh takes long, do not run thousands of them per round
+			unsigned int batch = (b == CH_BROADPHASE_LINEAR) ? cMax(1u, cMin(NUM_SAMPLES, 1000000u / numTriangles)) : NUM_SAMPLES;
+			unsigned int next = 0;
+
+			measure("ch_checkCollisions", numTriangles, distribution, broadphases[b], batch, [&](unsigned int)
+			{
+				checker.ch_checkCollisions(starts[next], ends[next], intersectionPt);
+				checker.ch_clearContacts();
+				next = (next + 1) % NUM_SAMPLES;
+			});
+		}
+
+		// footprint of the tree walk: full triangles, nodes and leaf lists against the quantized copy
+		if (d == 0)
+		{
+			const ch_aabbTree& tree = checker.ch_getTree();
+			double fullBytes = (double)numTriangles * sizeof(ch_triangle) + tree.ch_getNumNodes() * sizeof(ch_aabbNode) + tree.ch_getLeafTriangles().size() * sizeof(unsigned int);
+			const ch_compactMesh& compact = checker.ch_getCompactMesh();
+			printf("%-32s %9u %-8s %-10s %12.1lf bytes/triangle full, %.1lf compact, error %lg\n", "ch_compactMesh", numTriangles, "-", "-",
+				fullBytes / numTriangles, (double)compact.ch_getMemoryUsage() / numTriangles, compact.ch_getMaxError());
+		}
+
+		// grid queries that stop early
+		const char* modes[] = { "grid-any", "grid-near" };
+		checker.ch_setBroadphase(CH_BROADPHASE_GRID);
+		for (int m = 0; m < 2; m++)
+		{
+			unsigned int next = 0;
+			measure("ch_checkCollisions", numTriangles, distribution, modes[m], NUM_SAMPLES, [&](unsigned int)
+			{
+				checker.ch_checkCollisions(starts[next], ends[next], intersectionPt, (ch_queryMode)m);
+				checker.ch_clearContacts();
+				next = (next + 1) % NUM_SAMPLES;
+			});
+		}
+
+		// the same queries cut off after 64 triangle tests, as a haptic tick would on a pathological jump
+		checker.ch_setBroadphase(CH_BROADPHASE_TREE);
+		unsigned int incompleteBefore = checker.ch_getNumIncompleteQueries(), queriesBefore = checker.ch_getNumQueries();
+		unsigned int nextBudgeted = 0;
+		measure("ch_checkCollisionsBudgeted", numTriangles, distribution, "tree-64", NUM_SAMPLES, [&](unsigned int)
+		{
+			unsigned int budget = 64;
+			bool complete;
+			checker.ch_checkCollisionsBudgeted(starts[nextBudgeted], ends[nextBudgeted], intersectionPt, budget, complete);
+			checker.ch_clearContacts();
+			nextBudgeted = (nextBudgeted + 1) % NUM_SAMPLES;
+		});
+		printf("%-32s %9u %-8s %-10s %12.1lf %% incomplete\n", "ch_checkCollisionsBudgeted", numTriangles, distribution, "tree-64",
+			100.0 * (checker.ch_getNumIncompleteQueries() - incompleteBefore) / cMax(1u, checker.ch_getNumQueries() - queriesBefore));
+		checker.ch_setBroadphase(CH_BROADPHASE_GRID);
+
+		// a fast device move split into 16 sub-steps, queried one by one and as one packet
+		const unsigned int SUBSTEPS = 16;
+		vector<cVector3d> subStarts(NUM_SAMPLES), subEnds(NUM_SAMPLES);
+		vector<ch_segmentHit> hits;
+		for (unsigned int i = 0; i < NUM_SAMPLES; i++)
+		{
+			const cVector3d& a = starts[i / SUBSTEPS];
+			cVector3d step = (ends[i / SUBSTEPS] - a) * (1.0 / SUBSTEPS);
+			subStarts[i] = a + step * (double)(i % SUBSTEPS);
+			subEnds[i] = subStarts[i] + step;
+		}
+
+		measure("ch_checkCollisions", numTriangles, distribution, "grid-seq16", NUM_SAMPLES, [&](unsigned int i)
+		{
+			checker.ch_checkCollisions(subStarts[i], subEnds[i], intersectionPt, CH_QUERY_NEAREST);
+			checker.ch_clearContacts();
+		});
+
+		measure("ch_checkCollisions", numTriangles, distribution, "grid-pkt16", NUM_SAMPLES, [&](unsigned int i)
+		{
+			// one packet every SUBSTEPS segments, so that the time is reported per segment
+			if (i % SUBSTEPS == 0)
+			{
+				hits.clear();
+				sink += checker.ch_checkCollisionsBatch(&subStarts[i], &subEnds[i], SUBSTEPS, hits, CH_QUERY_NEAREST);
+			}
+		});
+
+		// grid behind the distance field rejection
+		unsigned int next = 0;
+		measure("ch_checkCollisions", numTriangles, distribution, "field", NUM_SAMPLES, [&](unsigned int)
+		{
+			fieldChecker.ch_checkCollisions(starts[next], ends[next], intersectionPt);
+			fieldChecker.ch_clearContacts();
+			next = (next + 1) % NUM_SAMPLES;
+		});
+	}
+
+	// deformable update latency: a patch of vertices and the whole mesh moved (in place, the geometry
+	// stays the same), until the snapshot with the new planes and bounds is published
+	ch_segmentTriangleCollisionChecker deformableChecker(object);
+	deformableChecker.ch_enableDeformation();
+	ch_deformableMesh* deformable = deformableChecker.ch_getDeformableMesh();
+	unsigned int numVertices = object->getNumVertices();
+	unsigned int patch = cMin(64u, numVertices);
+
+	measure("ch_updateDeformedVertices", numTriangles, "-", "patch64", 64, [&](unsigned int i)
+	{
+		deformableChecker.ch_updateDeformedVertices((i * patch) % (numVertices - patch + 1), patch);
+		deformable->ch_flush();
+	});
+
+	measure("ch_updateDeformedVertices", numTriangles, "-", "all", 1, [&](unsigned int)
+	{
+		deformableChecker.ch_updateDeformedVertices(0, numVertices);
+		deformable->ch_flush();
+	});
+
+	// GO position solve in free space and held by one to three faces near the corner (0.5, 0.5, 0.5);
+	// "warm" keeps the active set of the previous tick, "cold" starts every solve from nothing
+	ch_GOAlgorithm goAlgorithm;
+	const char* contacts[] = { "free", "1-plane", "2-plane", "3-plane" };
+	const cVector3d entries[3][2] = {
+		{ cVector3d(0.1, 0.2, 0.55), cVector3d(0.1, 0.2, 0.45) },
+		{ cVector3d(0.55, 0.2, 0.3), cVector3d(0.45, 0.2, 0.3) },
+		{ cVector3d(0.3, 0.55, 0.3), cVector3d(0.3, 0.45, 0.3) } };
+	const cVector3d devices[4] = { cVector3d(0.0, 0.0, 2.0), cVector3d(0.1, 0.2, 0.45), cVector3d(0.45, 0.2, 0.45), cVector3d(0.45, 0.45, 0.45) };
+	cVector3d proxyPos;
+
+	checker.ch_setBroadphase(CH_BROADPHASE_GRID);
+	for (int planes = 0; planes <= 3; planes++)
+	{
+		checker.ch_clearContacts();
+		for (int p = 0; p < planes; p++)
+			checker.ch_checkCollisions(entries[p][0], entries[p][1], intersectionPt);
+
+		for (int warm = 1; warm >= 0; warm--)
+		{
+			goAlgorithm.ch_resetActiveSet();
+			measure("ch_fillGOPositionOptimisation", numTriangles, contacts[planes], warm ? "warm" : "cold", 1024, [&](unsigned int)
+			{
+				if (!warm)
+					goAlgorithm.ch_resetActiveSet();
+				goAlgorithm.ch_fillGOPositionOptimisation(&checker, devices[planes], proxyPos);
+				sink += proxyPos(0);
+			});
+		}
+	}
+	checker.ch_clearContacts();
+}
+
+
+// a device walking through a scene of numObjects unit cubes, checked against the objects the sweep and
+// prune selects and, for comparison, against every object
+void benchmarkScene(unsigned int numObjects)
+{
+	unsigned int side = (unsigned int)ceil(pow((double)numObjects, 1.0 / 3.0));
+	const double spacing = 2.0;
+
+	seed = 1;
+	printf("\n--- scene of %u objects ---\n", numObjects);
+
+	ch_collisionWorld world;
+	unsigned int worldTool = world.ch_addTool();
+	vector<ch_segmentTriangleCollisionChecker*> checkers(numObjects);
+	for (unsigned int i = 0; i < numObjects; i++)
+	{
+		cMultiMesh* object = createTessellatedCube(1);
+		object->getMesh(0)->setLocalPos(spacing * (i % side), spacing * ((i / side) % side), spacing * (i / (side * side)));
+		object->computeGlobalPositions(true);
+
+		checkers[i] = new ch_segmentTriangleCollisionChecker(object);
+		world.ch_addObject(checkers[i]);
+	}
+
+	// random walk with steps of up to a tenth of a cube, kept inside the scene
+	vector<cVector3d> positions(NUM_SAMPLES + 1);
+	positions[0].set(0.6, 0.6, 0.6);
+	for (unsigned int i = 1; i <= NUM_SAMPLES; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+			positions[i](axis) = cClamp(positions[i - 1](axis) + 0.2 * (random01() - 0.5), -1.0, spacing * side);
+	}
+
+	cVector3d intersectionPt;
+	unsigned int numTriangles = 12 * numObjects;
+
+	measure("ch_collisionWorld::ch_checkCollisions", numTriangles, "walk", "sap", NUM_SAMPLES, [&](unsigned int i)
+	{
+		sink += world.ch_checkCollisions(worldTool, positions[i], positions[i + 1], intersectionPt);
+		world.ch_clearContacts();
+	});
+
+	measure("ch_collisionWorld::ch_checkCollisions", numTriangles, "walk", "every", NUM_SAMPLES, [&](unsigned int i)
+	{
+		for (unsigned int j = 0; j < numObjects; j++)
+		{
+			sink += checkers[j]->ch_checkCollisions(positions[i], positions[i + 1], intersectionPt);
+			checkers[j]->ch_clearContacts();
+		}
+	});
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		delete checkers[i];
+}
+
+
+// hand motion of the simulated device at time [s]: a few sinusoids, and a stop against a wall at x = 0.02
+cVector3d simulatedDevicePosition(double time)
+{
+	cVector3d position(0.03 * sin(2.0 * C_PI * 1.3 * time) + 0.01 * sin(2.0 * C_PI * 3.1 * time),
+		0.02 * sin(2.0 * C_PI * 0.9 * time + 1.0) + 0.003 * sin(2.0 * C_PI * 7.0 * time),
+		0.015 * sin(2.0 * C_PI * 1.7 * time + 2.0));
+	position(0) = cMin(position(0), 0.02);
+	return position;
+}
+
+
+// predictor on a simulated device whose readings are DEVICE_LATENCY ticks old, against the position at the
+// time the force is applied; the error of using the readings as they are is printed for comparison
+void benchmarkPredictor()
+{
+	const unsigned int numTicks = 60000;
+
+	seed = 1;
+	printf("\n--- device prediction, readings %u ms old, force %u ms later ---\n", DEVICE_LATENCY, DEVICE_FORCE_DELAY);
+
+	vector<ch_vec3> readings(numTicks), actual(numTicks);
+	for (unsigned int i = 0; i < numTicks; i++)
+	{
+		cVector3d noise(random01() + random01() + random01() - 1.5, random01() + random01() + random01() - 1.5, random01() + random01() + random01() - 1.5);
+		readings[i] = ch_toVec3(simulatedDevicePosition((double)(i - (int)DEVICE_LATENCY) * DEVICE_TICK) + noise * (2.0 * DEVICE_NOISE));
+		actual[i] = ch_toVec3(simulatedDevicePosition((double)(i + DEVICE_FORCE_DELAY) * DEVICE_TICK));
+	}
+
+	double leadTime = (DEVICE_LATENCY + DEVICE_FORCE_DELAY) * DEVICE_TICK;
+	ch_devicePredictor predictor(leadTime);
+
+	// accuracy over the whole run, after a second to settle
+	double rawSq = 0.0, predictedSq = 0.0, rawMax = 0.0, predictedMax = 0.0;
+	unsigned int numCompared = 0;
+	for (unsigned int i = 0; i < numTicks; i++)
+	{
+		predictor.ch_update(readings[i], DEVICE_TICK);
+		if (i < 1000)
+			continue;
+
+		double raw = ch_distance(readings[i], actual[i]);
+		double predicted = ch_distance(predictor.ch_predict(), actual[i]);
+		rawSq += raw * raw;
+		predictedSq += predicted * predicted;
+		rawMax = cMax(rawMax, raw);
+		predictedMax = cMax(predictedMax, predicted);
+		numCompared++;
+	}
+	printf("%-32s %9s %-8s %-10s %12.4lf mm rms %8.4lf mm max\n", "ch_devicePredictor", "-", "sim", "raw", 1000.0 * sqrt(rawSq / numCompared), 1000.0 * rawMax);
+	printf("%-32s %9s %-8s %-10s %12.4lf mm rms %8.4lf mm max\n", "ch_devicePredictor", "-", "sim", "kalman", 1000.0 * sqrt(predictedSq / numCompared), 1000.0 * predictedMax);
+
+	measure("ch_devicePredictor", 0, "sim", "update", numTicks, [&](unsigned int i)
+	{
+		predictor.ch_update(readings[i], DEVICE_TICK);
+		sink += predictor.ch_predict().x;
+	});
+}
+
+
+// busy for a duration [s], like the collision queries and the solve of a tick
+void spin(double duration)
+{
+	chrono::steady_clock::time_point end = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(duration));
+	while (chrono::steady_clock::now() < end)
+		sink += 1.0;
+}
+
+
+// haptic loop on a simulated device whose transfers block without using the processor, with the transfers
+// in the loop and on a ch_deviceIO thread. the device numbers its readings, a force carries the number of the
+// one it was computed from in x; the lag is the number of readings between the two
+void benchmarkDeviceIO()
+{
+	const unsigned int numTicks = 4000;
+	printf("\n--- device transfers, %.2f ms read, %.2f ms write, %.2f ms computation per tick ---\n", 1000.0 * DEVICE_READ_TIME, 1000.0 * DEVICE_WRITE_TIME, 1000.0 * TICK_COMPUTE_TIME);
+
+	unsigned long long numReadings = 0, numForces = 0, lagSum = 0, lagMax = 0;
+	ch_deviceIO::ch_readFunction readDevice = [&](ch_vec3& position, unsigned int& switches)
+	{
+		this_thread::sleep_for(chrono::duration<double>(DEVICE_READ_TIME));
+		position = ch_vec3((double)++numReadings, 0.0, 0.0);
+		switches = 0;
+		return true;
+	};
+	ch_deviceIO::ch_writeFunction writeDevice = [&](const ch_vec3& force)
+	{
+		this_thread::sleep_for(chrono::duration<double>(DEVICE_WRITE_TIME));
+		if (force.x > 0.0)
+		{
+			unsigned long long lag = numReadings - (unsigned long long)force.x;
+			lagSum += lag;
+			lagMax = max(lagMax, lag);
+			numForces++;
+		}
+		return true;
+	};
+
+	const char* variants[] = { "serial", "pipelined" };
+	for (int v = 0; v < 2; v++)
+	{
+		numReadings = numForces = lagSum = lagMax = 0;
+
+		ch_deviceIO io;
+		if (v == 1)
+			io.ch_start(readDevice, writeDevice);
+
+		vector<double> periods;
+		periods.reserve(numTicks);
+		chrono::steady_clock::time_point begin = chrono::steady_clock::now(), last = begin;
+		for (unsigned int i = 0; i < numTicks; i++)
+		{
+			if (v == 0)
+			{
+				ch_vec3 position;
+				unsigned int switches;
+				readDevice(position, switches);
+				spin(TICK_COMPUTE_TIME);
+				writeDevice(ch_vec3(position.x, 0.0, 0.0));
+			}
+			else
+			{
+				io.ch_waitForSample(0.01);
+				spin(TICK_COMPUTE_TIME);
+				io.ch_setForce(ch_vec3(io.ch_getSample().position.x, 0.0, 0.0));
+			}
+
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+			periods.push_back(chrono::duration<double>(now - last).count());
+			last = now;
+		}
+		double seconds = chrono::duration<double>(last - begin).count();
+		unsigned long long numMissed = io.ch_getNumMissedSamples();
+		io.ch_stop();
+
+		double mean = seconds / numTicks, variance = 0.0, longest = 0.0;
+		for (unsigned int i = 0; i < numTicks; i++)
+		{
+			variance += (periods[i] - mean) * (periods[i] - mean);
+			longest = max(longest, periods[i]);
+		}
+		printf("%-32s %9s %-8s %-10s %12.1lf ticks/s %6.3lf ms jitter %6.3lf ms max %5.2lf readings lag %llu max, %llu missed\n", "ch_deviceIO", "-", "sim", variants[v],
+			numTicks / seconds, 1000.0 * sqrt(variance / numTicks), 1000.0 * longest, numForces ? (double)lagSum / numForces : 0.0, lagMax, numMissed);
+		report("ch_deviceIO", 0, "sim", variants[v], numTicks, seconds, -1);
+	}
+}
+
+
+// hand motion next to the test cube at time [s], touching its +x face now and then, at most about 1.6 m/s
+cVector3d simulatedHandPosition(double time)
+{
+	return cVector3d(0.62 + 0.13 * sin(2.0 * C_PI * 0.4 * time),
+		0.3 * sin(2.0 * C_PI * 0.7 * time),
+		0.3 * sin(2.0 * C_PI * 0.5 * time + 1.0));
+}
+
+
+// the highlighting query of every tick along a simulated hand motion, with and without the proximity culling;
+// both have to report the same contacts
+void benchmarkProximity(unsigned int targetTriangles)
+{
+	const unsigned int numTicks = 20000;
+	unsigned int n = (unsigned int)cMax(1.0, floor(sqrt(targetTriangles / 12.0) + 0.5));
+
+	cMultiMesh* object = createTessellatedCube(n);
+	unsigned int numTriangles = object->getNumTriangles();
+	printf("\n--- proximity culling, %u triangles, %u ticks ---\n", numTriangles, numTicks);
+
+	vector<cVector3d> positions(numTicks + 1);
+	for (unsigned int i = 0; i <= numTicks; i++)
+		positions[i] = simulatedHandPosition(i * DEVICE_TICK);
+
+	ch_segmentTriangleCollisionChecker checker(object), culled(object);
+	checker.ch_setBroadphase(CH_BROADPHASE_GRID);
+	checker.ch_buildDistanceField();
+	culled.ch_setBroadphase(CH_BROADPHASE_GRID);
+	culled.ch_buildDistanceField();
+	culled.ch_setProximityCulling(2.0, DEVICE_TICK);
+
+	cVector3d intersectionPt;
+	unsigned int mismatches = 0, contactTicks = 0;
+	for (unsigned int i = 0; i < numTicks; i++)
+	{
+		unsigned int numHits = checker.ch_checkCollisions(positions[i], positions[i + 1], intersectionPt);
+		unsigned int numCulledHits = culled.ch_checkCollisions(positions[i], positions[i + 1], intersectionPt);
+		contactTicks += (numHits > 0);
+
+		bool same = (numHits == numCulledHits);
+		for (unsigned int k = 0; same && k < numHits; k++)
+			same = (checker.ch_getContacts()[k].triangle == culled.ch_getContacts()[k].triangle);
+		mismatches += !same;
+
+		checker.ch_clearContacts();
+		culled.ch_clearContacts();
+	}
+	printf("%-32s %9u %-8s %-10s %12.1lf %% skipped, %u contact ticks, %u skips aborted%s\n", "ch_checkCollisions", numTriangles, "hand", "culling",
+		100.0 * culled.ch_getNumSkippedQueries() / numTicks, contactTicks, culled.ch_getNumSkipAborts(), mismatches ? " - WARNING: contacts missed" : "");
+
+	const char* variants[] = { "every", "culling" };
+	ch_segmentTriangleCollisionChecker* checkers[] = { &checker, &culled };
+	for (int v = 0; v < 2; v++)
+	{
+		measure("ch_checkCollisions", numTriangles, "hand", variants[v], numTicks, [&](unsigned int i)
+		{
+			sink += checkers[v]->ch_checkCollisions(positions[i], positions[i + 1], intersectionPt);
+			checkers[v]->ch_clearContacts();
+		});
+	}
+}
+
+
+// latency against size and shape: every generated mesh at every size of at least 1000 triangles, the tree
+// build, segments crossing random triangles and the closest point to their starts
+void benchmarkScaling(const vector<unsigned int>& sizes)
+{
+	for (int type = 0; type < CH_NUM_SCENE_TYPES; type++)
+	{
+		const char* name = ch_sceneGenerator::ch_getName((ch_sceneType)type);
+		printf("\n--- %s ---\n", name);
+
+		for (unsigned int s = 0; s < sizes.size(); s++)
+		{
+			if (sizes[s] < 1000)
+				continue;
+
+			seed = 1;
+			cMultiMesh* object = createGeneratedMesh((ch_sceneType)type, sizes[s]);
+			unsigned int numTriangles = object->getNumTriangles();
+			ch_segmentTriangleCollisionChecker checker(object);
+
+			cPrecisionClock clock;
+			clock.start();
+			checker.ch_setBroadphase(CH_BROADPHASE_TREE);
+			report("ch_aabbTree::ch_build", numTriangles, name, "build", 1, clock.getCurrentTimeSeconds(), -1);
+
+			// a device step across a random point of a random triangle, from its front side
+			vector<cVector3d> starts(NUM_SAMPLES), ends(NUM_SAMPLES);
+			for (unsigned int i = 0; i < NUM_SAMPLES; i++)
+			{
+				const ch_triangle& triangle = checker.ch_getTriangle((unsigned int)(random01() * numTriangles) % numTriangles);
+				double a = random01(), b = random01();
+				if (a + b > 1.0)
+				{
+					a = 1.0 - a;
+					b = 1.0 - b;
+				}
+				ch_vec3 point = triangle.v0 + (triangle.v1 - triangle.v0) * a + (triangle.v2 - triangle.v0) * b;
+				starts[i] = ch_toCVector3d(point + triangle.normal * (0.5 * STEP_LENGTH));
+				ends[i] = ch_toCVector3d(point - triangle.normal * (0.5 * STEP_LENGTH));
+			}
+
+			cVector3d intersectionPt, closest;
+			double distance;
+			int triangle;
+			measure("ch_checkCollisions", numTriangles, name, "nearest", NUM_SAMPLES, [&](unsigned int i)
+			{
+				sink += checker.ch_checkCollisions(starts[i], ends[i], intersectionPt, CH_QUERY_NEAREST);
+				checker.ch_clearContacts();
+			});
+			measure("ch_findClosestPoint", numTriangles, name, "step", NUM_SAMPLES, [&](unsigned int i)
+			{
+				sink += checker.ch_findClosestPoint(starts[i], STEP_LENGTH, closest, distance, triangle);
+			});
+
+			delete object;
+		}
+	}
+}
+
+
+// closest surface point to points near the surface of the test cube and far from it, through the tree and by
+// testing every triangle; both have to find the same distance
+void benchmarkClosestPoint(unsigned int targetTriangles)
+{
+	const double radius = 0.1;
+	const unsigned int numReference = 256;
+	unsigned int n = (unsigned int)cMax(1.0, floor(sqrt(targetTriangles / 12.0) + 0.5));
+
+	seed = 1;
+	cMultiMesh* object = createTessellatedCube(n);
+	unsigned int numTriangles = object->getNumTriangles();
+	printf("\n--- closest point within %.2f, %u triangles ---\n", radius, numTriangles);
+
+	ch_segmentTriangleCollisionChecker checker(object);
+
+	// "near" lies within the radius on either side of the surface, "far" beyond it
+	const char* distributions[] = { "near", "far" };
+	for (int d = 0; d < 2; d++)
+	{
+		vector<cVector3d> points(NUM_SAMPLES);
+		for (unsigned int i = 0; i < NUM_SAMPLES; i++)
+		{
+			cVector3d normal;
+			randomSurfacePoint(n, false, points[i], normal);
+			points[i] += normal * ((d == 0) ? (2.0 * random01() - 1.0) * radius : radius * (1.5 + random01()));
+		}
+
+		cVector3d closest;
+		double distance, reference;
+		int triangle;
+		unsigned int mismatches = 0, found = 0;
+		for (unsigned int i = 0; i < numReference; i++)
+		{
+			bool hit = checker.ch_findClosestPoint(points[i], radius, closest, distance, triangle);
+			bool referenceHit = checker.ch_findClosestPointLinear(points[i], radius, closest, reference, triangle);
+			mismatches += (hit != referenceHit) || (hit && fabs(distance - reference) > 1.0e-12);
+			found += hit;
+		}
+		printf("%-32s %9u %-8s %-10s %12u of %u found%s\n", "ch_findClosestPoint", numTriangles, distributions[d], "reference", found, numReference,
+			mismatches ? " - WARNING: differs from the linear search" : "");
+
+		measure("ch_findClosestPoint", numTriangles, distributions[d], "tree", NUM_SAMPLES, [&](unsigned int i)
+		{
+			sink += checker.ch_findClosestPoint(points[i], radius, closest, distance, triangle);
+		});
+		measure("ch_findClosestPoint", numTriangles, distributions[d], "linear", numReference, [&](unsigned int i)
+		{
+			sink += checker.ch_findClosestPointLinear(points[i], radius, closest, distance, triangle);
+		});
+	}
+}
+
+
+// device circling the test cube at time [s], over its faces, edges and corners, now outside and now inside
+// near the corners and edges, about 3 mm per tick
+ch_vec3 orbitPosition(double time)
+{
+	double theta = 2.0 * C_PI * 0.5 * time;
+	double phi = 1.3 * sin(2.0 * C_PI * 0.37 * time);
+	double radius = 0.85 + 0.2 * sin(2.0 * C_PI * 0.23 * time);
+	return ch_vec3(cos(theta) * cos(phi), sin(theta) * cos(phi), sin(phi)) * radius;
+}
+
+
+// closest feature of the test cube along a device path around it, tracked from tick to tick and searched
+// among all features every tick; both have to give the same distance and closest point, and the walk
+// between features must not give up
+void benchmarkFeatureTracker(unsigned int targetTriangles)
+{
+	const unsigned int numTicks = 20000;
+	unsigned int n = (unsigned int)cMax(1.0, floor(sqrt(targetTriangles / 12.0) + 0.5));
+
+	cMultiMesh* object = createTessellatedCube(n);
+	unsigned int numTriangles = object->getNumTriangles();
+
+	ch_segmentTriangleCollisionChecker checker(object);
+	if (!checker.ch_isConvex())
+		return;
+	const ch_convexCollider& collider = checker.ch_getConvexCollider();
+	printf("\n--- closest feature, %u triangles, %u faces, %u edges, %u ticks ---\n", numTriangles, collider.ch_getNumFaces(), collider.ch_getNumEdges(), numTicks);
+
+	vector<ch_vec3> positions(numTicks);
+	for (unsigned int i = 0; i < numTicks; i++)
+		positions[i] = orbitPosition(i * DEVICE_TICK);
+
+	ch_featureTracker tracker(&collider);
+	ch_closestFeature tracked, located;
+	tracked.type = CH_FEATURE_FACE;
+	tracked.index = 0;
+	unsigned int mismatches = 0, contactTicks = 0, featureChanges = 0;
+	unsigned int counts[3] = { 0, 0, 0 };
+	for (unsigned int i = 0; i < numTicks; i++)
+	{
+		ch_featureType lastType = tracked.type;
+		unsigned int lastIndex = tracked.index;
+
+		tracker.ch_update(positions[i], tracked);
+		ch_featureTracker::ch_locate(collider, positions[i], located);
+		mismatches += (fabs(tracked.distance - located.distance) > 1.0e-9 || ch_distance(tracked.point, located.point) > 1.0e-9);
+		contactTicks += (tracked.distance < 0.0);
+		featureChanges += (i > 0 && (tracked.type != lastType || tracked.index != lastIndex));
+		counts[located.type]++;
+	}
+	printf("%-32s %9u %-8s %-10s %12llu steps, %u feature changes, %llu face scans, %llu fallbacks, %u mismatches\n", "ch_featureTracker", numTriangles, "orbit", "tracked",
+		tracker.ch_getNumSteps(), featureChanges, tracker.ch_getNumFaceScans(), tracker.ch_getNumFallbacks(), mismatches);
+	printf("%-32s %9u %-8s %-10s %u face, %u edge, %u corner, %u contact ticks%s\n", "ch_featureTracker", numTriangles, "orbit", "every",
+		counts[CH_FEATURE_FACE], counts[CH_FEATURE_EDGE], counts[CH_FEATURE_VERTEX], contactTicks,
+		(mismatches || tracker.ch_getNumFallbacks()) ? " - WARNING: the tracker differs from ch_locate()" : "");
+
+	tracker.ch_reset();
+	measure("ch_featureTracker", numTriangles, "orbit", "tracked", numTicks, [&](unsigned int i)
+	{
+		tracker.ch_update(positions[i], tracked);
+		sink += tracked.distance;
+	});
+	measure("ch_featureTracker", numTriangles, "orbit", "every", numTicks, [&](unsigned int i)
+	{
+		ch_featureTracker::ch_locate(collider, positions[i], located);
+		sink += located.distance;
+	});
+}
+
+
+// many GO sessions on random walks that keep pushing into the test cube, stepped on one thread and on
+// every core
+void benchmarkGOBatch(unsigned int targetTriangles)
+{
+	unsigned int n = (unsigned int)cMax(1.0, floor(sqrt(targetTriangles / 12.0) + 0.5));
+
+	seed = 1;
+	cMultiMesh* object = createTessellatedCube(n);
+	unsigned int numTriangles = object->getNumTriangles();
+	printf("\n--- %u GO sessions, %u triangles ---\n", BATCH_SESSIONS, numTriangles);
+
+	ch_segmentTriangleCollisionChecker checker(object);
+	ch_GOBatch batch(checker.ch_getTriangles(), checker.ch_getTree(), BATCH_SESSIONS);
+
+	// device positions of every tick, each session starts outside the cube and drifts towards its centre
+	vector<double> deviceX(BATCH_SESSIONS * BATCH_TICKS), deviceY(BATCH_SESSIONS * BATCH_TICKS), deviceZ(BATCH_SESSIONS * BATCH_TICKS);
+	for (unsigned int i = 0; i < BATCH_SESSIONS; i++)
+	{
+		cVector3d position(random01() - 0.5, random01() - 0.5, random01() - 0.5);
+		position.normalize();
+		position.mul(0.8);
+		for (unsigned int t = 0; t < BATCH_TICKS; t++)
+		{
+			position += cVector3d(random01() - 0.5, random01() - 0.5, random01() - 0.5) * (4.0 * STEP_LENGTH) - position * 0.02;
+			deviceX[t * BATCH_SESSIONS + i] = position(0);
+			deviceY[t * BATCH_SESSIONS + i] = position(1);
+			deviceZ[t * BATCH_SESSIONS + i] = position(2);
+		}
+	}
+
+	ch_threadPool pool;
+	for (int parallel = 0; parallel < 2; parallel++)
+	{
+		cPrecisionClock clock;
+		unsigned long long ops = 0;
+		double seconds = 0.0;
+		unsigned int numContacts = 0;
+
+		clock.reset();
+		clock.start();
+		do
+		{
+			for (unsigned int i = 0; i < BATCH_SESSIONS; i++)
+				batch.ch_resetSession(i, ch_vec3(deviceX[i], deviceY[i], deviceZ[i]));
+
+			for (unsigned int t = 0; t < BATCH_TICKS; t++)
+				batch.ch_step(&deviceX[t * BATCH_SESSIONS], &deviceY[t * BATCH_SESSIONS], &deviceZ[t * BATCH_SESSIONS], parallel ? &pool : NULL);
+			ops += BATCH_SESSIONS * BATCH_TICKS;
+			seconds = clock.getCurrentTimeSeconds();
+		} while (seconds < minTime);
+		clock.stop();
+
+		for (unsigned int i = 0; i < BATCH_SESSIONS; i++)
+			numContacts += (batch.ch_getNumActiveConstraints(i) > 0);
+
+		char variant[32];
+		sprintf(variant, "%u-threads", parallel ? pool.ch_getNumThreads() : 1);
+		report("ch_GOBatch::ch_step", numTriangles, "walk", variant, ops, seconds, -1);
+		printf("%-32s %9u %-8s %-10s %12.2lf M ticks/s, %u of %u sessions in contact\n", "ch_GOBatch::ch_step", numTriangles, "walk", variant,
+			ops / seconds * 1.0e-6, numContacts, BATCH_SESSIONS);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	vector<unsigned int> sizes(DEFAULT_SIZES, DEFAULT_SIZES + sizeof(DEFAULT_SIZES) / sizeof(DEFAULT_SIZES[0]));
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+		{
+			sizes.clear();
+			for (char* token = strtok(argv[++i], ","); token; token = strtok(NULL, ","))
+				sizes.push_back((unsigned int)atoi(token));
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			jsonFile = fopen(argv[++i], "a");
+			if (!jsonFile)
+			{
+				printf("Error - cannot open %s\n", argv[i]);
+				return (-1);
+			}
+		}
+		else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc)
+		{
+			label = argv[++i];
+		}
+		else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+		{
+			minTime = atof(argv[++i]);
+		}
+		else
+		{
+			printf("usage: %s [--sizes 12,1000,...] [--out results.jsonl] [--label name] [--min-time seconds]\n", argv[0]);
+			return (-1);
+		}
+	}
+
+	printf("CH lab - collision and GO kernel benchmarks (%s)\n", label.c_str());
+	if (!cacheMisses.available())
+		printf("cache miss counters not available on this system\n");
+
+	for (unsigned int i = 0; i < sizes.size(); i++)
+		benchmarkMesh(sizes[i]);
+
+	for (unsigned int i = 0; i < sizeof(SCENE_SIZES) / sizeof(SCENE_SIZES[0]); i++)
+		benchmarkScene(SCENE_SIZES[i]);
+
+	benchmarkProximity(100000);
+
+	benchmarkFeatureTracker(100000);
+
+	benchmarkClosestPoint(1000);
+	benchmarkClosestPoint(100000);
+
+	benchmarkScaling(sizes);
+
+	benchmarkGOBatch(1000);
+
+	benchmarkPredictor();
+
+	benchmarkDeviceIO();
+
+	if (jsonFile)
+		fclose(jsonFile);
+
+	return (0);
+}
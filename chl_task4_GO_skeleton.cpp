@@ -51,7 +51,15 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 //---------------------------------------------------------------------------
 #include "src/ch_segmentTriangleCollisionChecker.h"
+#include "src/ch_collisionWorld.h"
+#include "src/ch_devicePredictor.h"
+#include "src/ch_pipelinedDevice.h"
+#include "src/ch_scenePreparation.h"
+#include "src/ch_sceneGenerator.h"
+#include "src/ch_rcuPointer.h"
 #include "src/ch_GOAlgorithm.h"
+#include "src/ch_sharedState.h"
+#include "src/ch_trace.h"
 //---------------------------------------------------------------------------
 //---------------------------------------------------------------------------
 #include "chai3d.h"
@@ -94,6 +102,25 @@ const int WINDOW_SIZE_H = 600;
 const int OPTION_FULLSCREEN = 1;
 const int OPTION_WINDOWDISPLAY = 2;
 
+// largest deviations [m] of the collision mesh from the rendered one, key 3 rebuilds the scene with the next
+const double COLLISION_PROXY_TOLERANCES[] = { 0.001, 0.01, 0.05 };
+const int NUM_COLLISION_PROXY_TOLERANCES = 3;
+
+// triangle tests a haptic tick may spend on the collision query, a few hundred microseconds at most
+const unsigned int COLLISION_TRIANGLE_BUDGET = 2000;
+
+// how far ahead [s] of the last device reading the collisions and forces are computed: the reading is about a
+// USB frame old and the force goes out a tick later. --predict <ms> overrides it, 0 turns the prediction off
+const double DEVICE_PREDICTION_LEAD = 0.002;
+
+// period [s] of the haptic loop, and the fastest [m/s] the device handle is assumed to move: far from the object
+// the collision queries are skipped for as many ticks as the distance to it lasts at that speed
+const double HAPTIC_TICK_PERIOD = 0.001;
+const double DEVICE_MAX_SPEED = 2.0;
+
+// longest wait [s] of a haptic tick for the next device reading, beyond it the tick runs on the last one
+const double DEVICE_SAMPLE_TIMEOUT = 0.01;
+
 
 //---------------------------------------------------------------------------
 // DECLARED VARIABLES
@@ -126,15 +153,36 @@ double proxyRadius;
 // a pointer to the current haptic device
 cGenericHapticDevicePtr hapticDevice;
 
-// our collision detector for this task
+// the device as the tool sees it, its transfers on a thread of their own. null with --serial-io
+shared_ptr<ch_pipelinedDevice> pipelinedDevice;
+bool serialDeviceIO = false;
+
+// the collision scene in use, replaced by the graphics thread without stopping the haptic loop
+ch_rcuPointer<ch_collisionScene> ch_HR2Scene;
+int ch_HR2Reader;
+
+// our collision detector for this task, of the scene the current haptic tick uses
 ch_segmentTriangleCollisionChecker* ch_HR2Collisions;
 
+// the objects of the scene, the device segment is only checked against those it may touch
+ch_collisionWorld* ch_HR2World;
+unsigned int ch_HR2Tool;
+
+// builds the proxy, the checker and the world in the background while the haptic loop already runs
+ch_scenePreparation scenePreparation;
+int proxyToleranceIndex = 0;
+
 // the GO algorithm
 ch_GOAlgorithm* ch_GOAlg;
 
 
 // our object of attention - we will draw a pyramid
 cMesh* object;
+
+// a generated mesh in place of the cube, set with --scene
+bool generatedScene = false;
+ch_sceneType sceneType = CH_SCENE_ICOSPHERE;
+unsigned int sceneTriangles = 0;
 cMultiMesh* CubeMultiMesh;
 // A global function for sticking a pyramid into the world
 void createPyramid(cMesh *mesh);
@@ -143,6 +191,9 @@ void createCube(cMesh *mesh, float edge, int include_top);
 // set object position and orientation in global space
 void setObjectPosOr();
 
+// publish proxy, device, force, contacts and loop statistics of this tick to the shared memory
+void publishHapticState(const cVector3d& proxyPos, const cVector3d& devicePos, const cVector3d& force);
+
 // status of the main simulation haptics loop
 bool simulationRunning = false;
 
@@ -153,6 +204,15 @@ string resourceRoot;
 // has exited haptics simulation thread
 bool simulationFinished = false;
 
+// Chrome trace JSON file for the stage timings (--trace), empty if tracing is off
+string traceFileName;
+
+// state of the haptic loop in shared memory, for monitors in other processes
+ch_sharedState sharedState;
+
+// estimates where the device is when the force of a tick is applied
+ch_devicePredictor devicePredictor(DEVICE_PREDICTION_LEAD);
+
 
 
 //---------------------------------------------------------------------------
@@ -200,12 +260,59 @@ int main(int argc, char* argv[])
 	printf("Keyboard Options:\n\n");
 	printf("[1] - texture   (ON/OFF)\n");
 	printf("[2] - wireframe (ON/OFF)\n");
+	printf("[3] - collision proxy tolerance (swapped while running)\n");
 	printf("[x] - exit application\n");
 	printf("\n\n");
 
 	// parse first arg to try and locate resources
 	resourceRoot = string(argv[0]).substr(0, string(argv[0]).find_last_of("/\\") + 1);
 
+	// --serial-io: read and write the device in the haptic loop, as CHAI3D does
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--serial-io") == 0)
+		{
+			serialDeviceIO = true;
+			printf("device transfers in the haptic loop\n\n");
+		}
+	}
+
+	// --trace <file>: record the stage timings of the haptic and graphics loops, written on exit
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--trace") == 0)
+		{
+			traceFileName = argv[i + 1];
+			ch_trace::ch_start();
+			ch_trace::ch_registerThread("graphics");
+			printf("tracing to %s\n\n", traceFileName.c_str());
+		}
+
+		// --predict <ms>: lead time of the device position prediction
+		if (strcmp(argv[i], "--predict") == 0)
+		{
+			devicePredictor.ch_setLeadTime(0.001 * atof(argv[i + 1]));
+			printf("device prediction %.1f ms ahead\n\n", 1000.0 * devicePredictor.ch_getLeadTime());
+		}
+
+		// --scene <type> <triangles>: a generated mesh instead of the cube, eg. --scene terrain 1000000
+		if (strcmp(argv[i], "--scene") == 0 && i + 2 < argc)
+		{
+			if (ch_sceneGenerator::ch_findType(argv[i + 1], sceneType))
+			{
+				generatedScene = true;
+				sceneTriangles = (unsigned int)atoi(argv[i + 2]);
+				printf("%s scene of about %u triangles\n\n", argv[i + 1], sceneTriangles);
+			}
+			else
+				printf("Error - unknown scene %s, the cube is used\n\n", argv[i + 1]);
+		}
+	}
+
+	// external monitors read the haptic state from here
+	if (!sharedState.ch_create(CH_STATE_NAME))
+		printf("Error - cannot create shared memory %s, the haptic state is not published\n\n", CH_STATE_NAME);
+
 	//--------------------------------------------------------------------------
 	// OPEN GL - WINDOW DISPLAY
 	//--------------------------------------------------------------------------
@@ -308,12 +415,23 @@ int main(int argc, char* argv[])
 		tool = new cToolCursor(world);
 		world->addChild(tool);
 
+		// the tool talks to the device through the transfer thread
+		if (hapticDevice && !serialDeviceIO)
+			pipelinedDevice = make_shared<ch_pipelinedDevice>(hapticDevice);
+
 		// connect the haptic device to the tool
-		tool->setHapticDevice(hapticDevice);
+		if (pipelinedDevice)
+			tool->setHapticDevice(pipelinedDevice);
+		else
+			tool->setHapticDevice(hapticDevice);
 
 		// initialize tool by connecting to haptic device
 		tool->start();
 
+		// from here on the transfers overlap the haptic loop
+		if (pipelinedDevice && !pipelinedDevice->ch_start())
+			printf("Error - cannot start the device thread\n");
+
 		// map the physical workspace of the haptic device to a larger virtual workspace.
 		// Phantom Omni physical workspace radius is around 0.1m , this creates a scale factor of 
 		// approx. 10 from the physical to the virtual workspace, if 1.0 is passed to the following function
@@ -365,7 +483,20 @@ int main(int argc, char* argv[])
 
 		//Choose Cube or Pyramid
 		//createPyramid(object);
-		createCube(object, 1.0, 0);
+		if (generatedScene)
+		{
+			ch_sceneGenerator generator;
+			generator.ch_generate(sceneType, sceneTriangles);
+
+			const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& vertices = generator.ch_getVertices();
+			const vector<unsigned int>& indices = generator.ch_getIndices();
+			for (unsigned int v = 0; v < vertices.size(); v++)
+				object->newVertex(ch_toCVector3d(vertices[v]));
+			for (unsigned int t = 0; t < generator.ch_getNumTriangles(); t++)
+				object->newTriangle(indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]);
+		}
+		else
+			createCube(object, 1.0, 0);
 
 		// set object position and orientation in global space
 		setObjectPosOr();
@@ -403,6 +534,11 @@ int main(int argc, char* argv[])
 		CubeMultiMesh->addMesh(object);
 		world->addChild(CubeMultiMesh);
 
+		// prepare the collision scene on a thread pool; the haptic loop starts at once and renders zero
+		// force until it is ready
+		world->computeGlobalPositions(true);
+		scenePreparation.ch_start(CubeMultiMesh, COLLISION_PROXY_TOLERANCES[proxyToleranceIndex]);
+
 		
 
 
@@ -422,6 +558,7 @@ int main(int argc, char* argv[])
 		simulationRunning = true;
 
 		// create a thread which starts the main haptics rendering loop
+		ch_HR2Reader = ch_HR2Scene.ch_registerReader();
 		cThread* hapticsThread = new cThread();
 		hapticsThread->start(updateHaptics, CTHREAD_PRIORITY_HAPTICS);
 
@@ -472,6 +609,15 @@ int main(int argc, char* argv[])
 			bool useWireMode = object->getWireMode();
 			object->setWireMode(!useWireMode, true);
 		}
+
+		// option 3: rebuild the collision scene with the next proxy tolerance, the haptic loop keeps the
+		// current one until the new one is published
+		if (key == '3')
+		{
+			int next = (proxyToleranceIndex + 1) % NUM_COLLISION_PROXY_TOLERANCES;
+			if (scenePreparation.ch_start(CubeMultiMesh, COLLISION_PROXY_TOLERANCES[next]))
+				proxyToleranceIndex = next;
+		}
 	}
 
 
@@ -505,17 +651,51 @@ int main(int argc, char* argv[])
 
 		// close haptic device
 		tool->stop();
+
+		// both loops have stopped, write the stage timings
+		if (!traceFileName.empty() && !ch_trace::ch_write(traceFileName.c_str()))
+			printf("Error - cannot write %s\n", traceFileName.c_str());
 	}
 
 	//---------------------------------------------------------------------------
 
 	void updateGraphics(void)
 	{
+		CH_TRACE_SCOPE("updateGraphics");
+
+		// hand a prepared scene to the haptic loop, the replaced one is deleted once the haptic thread moved on
+		ch_collisionScene* preparedScene = scenePreparation.ch_takeScene();
+		if (preparedScene)
+		{
+			ch_HR2Scene.ch_publish(preparedScene);
+			printf("collision scene published, proxy tolerance %f\n", COLLISION_PROXY_TOLERANCES[proxyToleranceIndex]);
+		}
+		ch_HR2Scene.ch_reclaim();
+
+		// progress of the scene preparation in the title bar
+		static int shownStage = -1;
+		if (shownStage != scenePreparation.ch_getStage())
+		{
+			shownStage = scenePreparation.ch_getStage();
+			char title[128];
+			if (scenePreparation.ch_isReady())
+				sprintf(title, "CH lab - Haptic Rendering part II");
+			else
+				sprintf(title, "CH lab - Haptic Rendering part II (preparing %s, %d%%)", ch_scenePreparation::ch_getStageName(scenePreparation.ch_getStage()), (int)(100.0 * scenePreparation.ch_getProgress()));
+			glutSetWindowTitle(title);
+		}
+
 		// render world
-		camera->renderView(displayW, displayH);
+		{
+			CH_TRACE_SCOPE("renderView");
+			camera->renderView(displayW, displayH);
+		}
 
 		// Swap buffers
-		glutSwapBuffers();
+		{
+			CH_TRACE_SCOPE("glutSwapBuffers");
+			glutSwapBuffers();
+		}
 
 		// check for any OpenGL errors
 		GLenum err;
@@ -535,9 +715,18 @@ int main(int argc, char* argv[])
 	{
 		bool first_time_here = true, first_time_here_too = false;
 
+		// time between device readings for the predictor
+		cPrecisionClock readingClock;
+		readingClock.start();
+		double lastReadingTime = 0.0;
+
+		ch_trace::ch_registerThread("haptics");
+
 		// main haptic simulation loop
 		while (simulationRunning)
 		{
+			CH_TRACE_SCOPE("updateHaptics");
+
 			static unsigned int highlight_wait;
 
 			cVector3d ch_feedbackForce;
@@ -548,60 +737,127 @@ int main(int argc, char* argv[])
 			//cSleepMs(10);
 
 			// compute global reference frames for each object
-			world->computeGlobalPositions(true);
+			{
+				CH_TRACE_SCOPE("computeGlobalPositions");
+				world->computeGlobalPositions(true);
+			}
 
 			// update device ("goal") pose
-			tool->updateFromDevice();
-			tool->updateToolImagePosition();
+			{
+				CH_TRACE_SCOPE("updateFromDevice");
+
+				// the transfer thread paces the loop, its readings carry the time they were taken
+				double readingTime;
+				if (pipelinedDevice && pipelinedDevice->ch_isRunning())
+				{
+					pipelinedDevice->ch_waitForSample(DEVICE_SAMPLE_TIMEOUT);
+					readingTime = pipelinedDevice->ch_getSampleTime();
+				}
+				else
+					readingTime = readingClock.getCurrentTimeSeconds();
+
+				tool->updateFromDevice();
+				tool->updateToolImagePosition();
+
+				devicePredictor.ch_update(ch_toVec3(tool->getDeviceLocalPos()), readingTime - lastReadingTime);
+				lastReadingTime = readingTime;
+			}
+
+			{
+				CH_TRACE_SCOPE("computeInteractionForces");
+				tool->computeInteractionForces();
+			}
 
-			tool->computeInteractionForces();
+			// the latest published scene, it stays valid for this whole tick
+			ch_collisionScene* scene = ch_HR2Scene.ch_acquire(ch_HR2Reader);
+
+			// no collision geometry yet: keep the device still and the loop running
+			if (!scene)
+			{
+				tool->setDeviceGlobalForce(cVector3d(0.0, 0.0, 0.0));
+				tool->applyToDevice();
+				publishHapticState(tool->getDeviceGlobalPos(), tool->getDeviceGlobalPos(), cVector3d(0.0, 0.0, 0.0));
+				continue;
+			}
 
 			if (first_time_here)
 			{
+				// switch to full rendering with the first scene
 				ch_nextProxyPos.zero();
-
-				// initialize the collision checker when first time here 
-				ch_HR2Collisions = new ch_segmentTriangleCollisionChecker(CubeMultiMesh);
 				ch_GOAlg = new ch_GOAlgorithm();
 
 				first_time_here = false;	// never enter here again
 				first_time_here_too = true;
 			}
 
+			if (scene->checker != ch_HR2Collisions)
+			{
+				CH_TRACE_SCOPE("collision setup");
+
+				// switch to the new scene, the colors of the previous one are reset
+				ch_HR2Collisions = scene->checker;
+				ch_HR2World = scene->world;
+				ch_HR2Tool = scene->tool;
+				ch_HR2Collisions->ch_setProximityCulling(DEVICE_MAX_SPEED, HAPTIC_TICK_PERIOD);
+				ch_HR2Collisions->ch_unHighlightTriangles();
+				highlight_wait = 0;
+
+				// the planes of the GO belong to the triangles of the previous geometry: start over with the
+				// GO on the device, as in the first tick
+				ch_GOAlg->ch_resetActiveSet();
+				ch_nextProxyPos.copyfrom(tool->getDeviceLocalPos());
+			}
+
 
 			// check for GO-goal segment collisions with our object
 			cVector3d device_pos, intersectionPt;
 
+			// where the device will be when the force of this tick is applied
+			cVector3d predicted_pos = ch_toCVector3d(devicePredictor.ch_predict());
+
 
 
 			//---------------------------uncomment this block for triangle highlighting, without feedback force!--------------------------------------//
 			// collision detection and touched primitive highlighting
-			device_pos = tool->getDeviceLocalPos();
-			ch_HR2Collisions->ch_checkCollisions(ch_lastDevicePosition, device_pos, intersectionPt);		
+			device_pos = predicted_pos;
+			{
+				CH_TRACE_SCOPE("ch_checkCollisions");
+				// a huge jump, eg. after a USB hiccup, yields the contacts found in time rather than an overrun
+				bool complete;
+				ch_HR2World->ch_checkCollisionsBudgeted(ch_HR2Tool, ch_lastDevicePosition, device_pos, intersectionPt, COLLISION_TRIANGLE_BUDGET, complete, CH_QUERY_ALL);
+			}
 			
 
-			ch_HR2Collisions->ch_highlightTriangles();		
-
-			if(highlight_wait == 5000)
-			{	
-				// wait for some time before resetting colors,
-				// otherwise the highlighting goes unnoticed
-				ch_HR2Collisions->ch_unHighlightTriangles();		
-				highlight_wait = 0;
+			{
+				CH_TRACE_SCOPE("highlighting");
+				ch_HR2Collisions->ch_highlightTriangles();		
+
+				if(highlight_wait == 5000)
+				{	
+					// wait for some time before resetting colors,
+					// otherwise the highlighting goes unnoticed
+					ch_HR2Collisions->ch_unHighlightTriangles();		
+					highlight_wait = 0;
+				}
+				highlight_wait++;
 			}
-			highlight_wait++;
 			
 			//last device position required in the next iteration to form the GO-goal segment
 			ch_lastDevicePosition.copyfrom(device_pos);	
 			tool->m_hapticPoint->m_algorithmFingerProxy->setProxyGlobalPosition(device_pos);
 
+			publishHapticState(device_pos, device_pos, tool->getDeviceGlobalForce());
 
-			// clear the collided-triangle index list from the previous iteration
-			ch_HR2Collisions->ch_clearCollidedTriangleIndex();
+
+			// clear the contacts of the previous iteration
+			ch_HR2World->ch_clearContacts();
 
 			
 			// send forces to device
-			tool->applyToDevice();
+			{
+				CH_TRACE_SCOPE("applyToDevice");
+				tool->applyToDevice();
+			}
 
 			//---------------------------uncomment this block for triangle highlighting!--------------------------------------//
 
@@ -610,9 +866,16 @@ int main(int argc, char* argv[])
 
 			//---------------------------uncomment this block for collision detection with feedback force!--------------------------------------//
 			////collision detection
-			//ch_HR2Collisions->ch_checkCollisions(ch_nextProxyPos, tool->getDeviceGlobalPos(), intersectionPt);
+			//{
+			//	CH_TRACE_SCOPE("ch_checkCollisions");
+			//	bool complete;
+			//	ch_HR2World->ch_checkCollisionsBudgeted(ch_HR2Tool, ch_nextProxyPos, predicted_pos, intersectionPt, COLLISION_TRIANGLE_BUDGET, complete);
+			//}
 			//		
-			//ch_feedbackForce = ch_GOAlg->ch_GOComputeForces(ch_HR2Collisions, ch_nextProxyPos, tool->getDeviceGlobalPos());
+			//{
+			//	CH_TRACE_SCOPE("ch_GOComputeForces");
+			//	ch_feedbackForce = ch_GOAlg->ch_GOComputeForces(ch_HR2Collisions, ch_nextProxyPos, predicted_pos);
+			//}
 			//
 			//if(first_time_here_too)
 			//{
@@ -623,7 +886,7 @@ int main(int argc, char* argv[])
 
 			//// compensate for the radius of the proxy sphere
 			//cVector3d ray_device_proxy;		
-			//ch_nextProxyPos.subr(tool->getDeviceGlobalPos(), ray_device_proxy);		
+			//ch_nextProxyPos.subr(predicted_pos, ray_device_proxy);		
 			//
 			//if(ray_device_proxy.lengthsq())
 			//{
@@ -636,19 +899,27 @@ int main(int argc, char* argv[])
 			//	ray_device_proxy.mul(ray_length);
 			//}		
 			//			
-			//tool->getDeviceLocalPos().addr(ray_device_proxy, ch_nextProxyPos);		
+			//predicted_pos.addr(ray_device_proxy, ch_nextProxyPos);		
 			//// set the proxy position on the surface of the virtual object
 			//tool->m_hapticPoint->m_sphereProxy->setLocalPos(ch_nextProxyPos);
 			//
-			//// clear the collided-triangle index list from the previous iteration
-			//ch_HR2Collisions->ch_clearCollidedTriangleIndex();
+			//publishHapticState(ch_nextProxyPos, tool->getDeviceGlobalPos(), ch_feedbackForce);
+			//
+			//// clear the contacts of the previous iteration
+			//ch_HR2World->ch_clearContacts();
 			//
 			//tool->setDeviceGlobalForce(ch_feedbackForce);
 			//// send forces to device
-			//tool->applyToDevice();
+			//{
+			//	CH_TRACE_SCOPE("applyToDevice");
+			//	tool->applyToDevice();
+			//}
 			//---------------------------uncomment this block for collision detection with feedback force!--------------------------------------//
 		}
 
+		// the scenes may be deleted from now on
+		ch_HR2Scene.ch_goOffline(ch_HR2Reader);
+
 		// exit haptics thread
 		simulationFinished = true;
 	}
@@ -833,40 +1104,43 @@ int main(int argc, char* argv[])
 
 		double multiplier = 0.25;
 
+		// the corners are listed clockwise seen from outside, the triangles are wound the other way
+		// round so that their normals point out of the pyramid as for the cube
+
 		mesh->newVertex(multiplier*0.0, multiplier*0.0, multiplier*4.0f);
 		mesh->newVertex(multiplier*2.5, multiplier*2.5, multiplier*0.0);
 		mesh->newVertex(multiplier*2.5, multiplier*-2.5, multiplier*0.0);
-		mesh->newTriangle(cur_index, cur_index + 1, cur_index + 2);
+		mesh->newTriangle(cur_index, cur_index + 2, cur_index + 1);
 		cur_index += 3;
 
 		mesh->newVertex(multiplier*0.0, multiplier*0.0, multiplier*4.0f);
 		mesh->newVertex(multiplier*2.5, multiplier*-2.5, multiplier*0.0);
 		mesh->newVertex(multiplier*-2.5, multiplier*-2.5, multiplier*0.0);
-		mesh->newTriangle(cur_index, cur_index + 1, cur_index + 2);
+		mesh->newTriangle(cur_index, cur_index + 2, cur_index + 1);
 		cur_index += 3;
 
 		mesh->newVertex(multiplier*0.0, multiplier*0.0, multiplier*4.0f);
 		mesh->newVertex(multiplier*-2.5, multiplier*-2.5, multiplier*0.0);
 		mesh->newVertex(multiplier*-2.5, multiplier*2.5, multiplier*0.0);
-		mesh->newTriangle(cur_index, cur_index + 1, cur_index + 2);
+		mesh->newTriangle(cur_index, cur_index + 2, cur_index + 1);
 		cur_index += 3;
 
 		mesh->newVertex(multiplier*0.0, multiplier*0.0, multiplier*4.0f);
 		mesh->newVertex(multiplier*-2.5, multiplier*2.5, multiplier*0.0);
 		mesh->newVertex(multiplier*2.5, multiplier*2.5, multiplier*0.0);
-		mesh->newTriangle(cur_index, cur_index + 1, cur_index + 2);
+		mesh->newTriangle(cur_index, cur_index + 2, cur_index + 1);
 		cur_index += 3;
 
 		mesh->newVertex(multiplier*2.5, multiplier*-2.5, multiplier*0.0);
 		mesh->newVertex(multiplier*2.5, multiplier*2.5, multiplier*0.0);
 		mesh->newVertex(multiplier*-2.5, multiplier*-2.5, multiplier*0.0);
-		mesh->newTriangle(cur_index, cur_index + 1, cur_index + 2);
+		mesh->newTriangle(cur_index, cur_index + 2, cur_index + 1);
 		cur_index += 3;
 
 		mesh->newVertex(multiplier*-2.5, multiplier*-2.5, multiplier*0.0);
 		mesh->newVertex(multiplier*2.5, multiplier*2.5, multiplier*0.0);
 		mesh->newVertex(multiplier*-2.5, multiplier*2.5, multiplier*0.0);
-		mesh->newTriangle(cur_index, cur_index + 1, cur_index + 2);
+		mesh->newTriangle(cur_index, cur_index + 2, cur_index + 1);
 		cur_index += 3;
 
 		// Give a color to each vertex
@@ -914,4 +1188,61 @@ int main(int argc, char* argv[])
 
 		// set the position of the object 22
 		object->setLocalPos(object_pos);
-	}
\ No newline at end of file
+	}
+
+
+
+	// publish proxy, device, force, contacts and loop statistics of this tick to the shared memory
+	void publishHapticState(const cVector3d& proxyPos, const cVector3d& devicePos, const cVector3d& force)
+	{
+		static cPrecisionClock loopClock;
+		static ch_hapticState state;
+		static double lastTime = 0.0;
+
+		if (!sharedState.ch_isOpen())
+			return;
+
+		if (!loopClock.on())
+		{
+			loopClock.reset();
+			loopClock.start();
+		}
+
+		double time = loopClock.getCurrentTimeSeconds();
+
+		// loop statistics, the first tick has no period
+		if (state.tick > 0)
+		{
+			state.tickPeriod = time - lastTime;
+			state.meanTickPeriod += (state.tickPeriod - state.meanTickPeriod) / (double)state.tick;
+			state.maxTickPeriod = cMax(state.maxTickPeriod, state.tickPeriod);
+			if (state.tickPeriod > HAPTIC_TICK_PERIOD)
+				state.numOverruns++;
+		}
+		lastTime = time;
+		state.time = time;
+
+		for (int i = 0; i < 3; i++)
+		{
+			state.proxyPos[i] = proxyPos(i);
+			state.devicePos[i] = devicePos(i);
+			state.force[i] = force(i);
+		}
+
+		// the contacts of the world last until its next query, those of the checker go with the highlighting
+		state.numContacts = ch_HR2World ? ch_HR2World->ch_getContacts().ch_size() : 0;
+		for (unsigned int i = 0; i < state.numContacts && i < CH_STATE_MAX_CONTACTS; i++)
+			state.contacts[i] = ch_HR2World->ch_getContacts()[i].triangle;
+
+		// the duty cycle of the collision queries
+		if (ch_HR2Collisions)
+		{
+			state.numQueries = ch_HR2Collisions->ch_getNumQueries();
+			state.numSkippedQueries = ch_HR2Collisions->ch_getNumSkippedQueries();
+			state.skipTicks = ch_HR2Collisions->ch_getSkipTicks();
+			state.clearance = ch_HR2Collisions->ch_getClearance();
+		}
+
+		sharedState.ch_publish(state);
+		state.tick++;
+	}
@@ -1,12 +1,80 @@
 #include "ch_GOAlgorithm.h"
 #include <vector>
 
+// smallest pivot of a KKT factorization that still counts as independent planes
+#define CH_GO_MIN_PIVOT 0.000001
+
+// distance [m] within which the GO still counts as on the face of one of its planes
+#define CH_GO_FACE_TOLERANCE 0.000001
+
+
+// constructor
+ch_GOAlgorithm::ch_GOAlgorithm()
+{
+	// one KKT system per number of active planes, allocated once so that the haptic loop never allocates
+	for (unsigned int k = 0; k <= CH_GO_MAX_CONSTRAINTS; k++)
+	{
+		kktMatrix[k] = gsl_matrix_alloc(3 + k, 3 + k);
+		kktPermutation[k] = gsl_permutation_alloc(3 + k);
+		kktRhs[k] = gsl_vector_alloc(3 + k);
+		kktSolution[k] = gsl_vector_alloc(3 + k);
+	}
+
+	ch_resetActiveSet();
+	ch_resetCounters();
+}
+
+
+// destructor
+ch_GOAlgorithm::~ch_GOAlgorithm()
+{
+	for (unsigned int k = 0; k <= CH_GO_MAX_CONSTRAINTS; k++)
+	{
+		gsl_matrix_free(kktMatrix[k]);
+		gsl_permutation_free(kktPermutation[k]);
+		gsl_vector_free(kktRhs[k]);
+		gsl_vector_free(kktSolution[k]);
+	}
+}
+
+
+// forget the active constraints of the last tick
+void ch_GOAlgorithm::ch_resetActiveSet()
+{
+	numActive = 0;
+	factorizationValid = false;
+	workingSetChecker = NULL;
+}
+
+
+// reset the solver counters
+void ch_GOAlgorithm::ch_resetCounters()
+{
+	numSolves = 0;
+	numFactorizations = 0;
+	numWarmSolves = 0;
+	numReleases = 0;
+	numFaceReleases = 0;
+}
+
 
 // the feedback forces according to the GO algorithm are computed here and solve for the next best GO position
 cVector3d ch_GOAlgorithm::ch_GOComputeForces(ch_segmentTriangleCollisionChecker* collision_checker, cVector3d& next_proxy_pos, const cVector3d& current_device_pos)
 {
-	// fill out the 6x6 matrix for GO position computation 
-	ch_fillGOPositionOptimisation(collision_checker, current_device_pos, next_proxy_pos);
+	cVector3d surface_point;
+	double depth;
+
+	// the segment test found no contact and no plane holds the GO, yet the device is inside the object
+	// (eg. after a dropped tick): put the GO back on the surface using the distance field
+	if (collision_checker->ch_getContacts().ch_isEmpty() && numActive == 0 && collision_checker->ch_estimatePenetration(current_device_pos, surface_point, depth))
+	{
+		next_proxy_pos.copyfrom(surface_point);
+	}
+	else
+	{
+		// fill out the 6x6 matrix for GO position computation
+		ch_fillGOPositionOptimisation(collision_checker, current_device_pos, next_proxy_pos);
+	}
 
 	// compute feedback force according to the Hooke's law
 	ch_computeStiffForce(next_proxy_pos, current_device_pos);
@@ -17,79 +85,195 @@ cVector3d ch_GOAlgorithm::ch_GOComputeForces(ch_segmentTriangleCollisionChecker*
 // fill out the 6x6 matrix for GO position computation here
 void ch_GOAlgorithm::ch_fillGOPositionOptimisation(ch_segmentTriangleCollisionChecker* collision_checker, const cVector3d& current_device_pos, cVector3d& next_proxy_pos)
 {
-	gsl_matrix_view m;
-	gsl_vector_view b;
+	const ch_contactManifold& contacts = collision_checker->ch_getContacts();
+	ch_vec3 device = ch_toVec3(current_device_pos);
+	ch_vec3 proxy = device;
 
-	// the solution vector
-	gsl_vector *x;
+	numSolves++;
 
-	int s;
-	gsl_permutation *p;
+	// the triangle indices of the working set mean nothing on other geometry, eg. a proxy of another tolerance
+	if (collision_checker != workingSetChecker)
+	{
+		ch_resetActiveSet();
+		workingSetChecker = collision_checker;
+	}
 
+	// which constraints are active? - the planes that held the GO in the last tick stay in the working
+	// set (warm start). they are infinite planes though: one only holds the GO while the GO lies on the
+	// face it came from, past the edge of the face it would hang on the extension of the plane in free
+	// space. drop those whose face the GO left
+	if (numActive > 0)
+	{
+		ch_solveWorkingSet(device, proxy);
+		for (unsigned int i = numActive; i-- > 0;)
+		{
+			if (!ch_onConstraintFace(collision_checker, proxy, i))
+			{
+				ch_removeConstraint(i);
+				numFaceReleases++;
+			}
+		}
+	}
 
+	// the planes of the triangles hit in this tick are added. coplanar triangles, eg. the two triangles
+	// of a cube face, give the same plane and are only added once. the contacts carry their planes
+	for (unsigned int i = 0; i < contacts.ch_size(); i++)
+		ch_addConstraint(contacts[i].plane, contacts[i].triangle);
 
-	// which constraints are active? - fill out values in the 6x6 matrix - see structure of matrix in the chapter
-	// on haptic rendering with the GO algorithm
+	ch_solveWorkingSet(device, proxy);
 
+	next_proxy_pos.set(proxy.x, proxy.y, proxy.z);
+}
+
+
+
+// project the device onto the working set
+void ch_GOAlgorithm::ch_solveWorkingSet(const ch_vec3& device, ch_vec3& proxy)
+{
+	double lambda[CH_GO_MAX_CONSTRAINTS];
 
-	// check for redundancy, eg. for the cube, triangles 0 and 1 are contained in the same plane,
-	// in which case we will have redundant rows and columns
-	// only the case for one redundancy is taken care of below, but we should also worry about
-	// cases in which collision_checker->collidedTriangleIndex.size() > 2
-	if (collision_checker->collidedTriangleIndex.size() == 2)
+	// minimise |x - device|^2 on the planes of the working set - see structure of the KKT matrix in the
+	// chapter on haptic rendering with the GO algorithm. a plane whose multiplier pulls the GO towards
+	// the object no longer holds it: release it and solve again
+	while (numActive > 0)
 	{
-		cVector3d plane1, plane2;
+		if (!ch_solveKKT(device, proxy, lambda))
+		{
+			// dependent planes, eg. three faces through one edge: keep the older ones
+			ch_removeConstraint(numActive - 1);
+			continue;
+		}
 
-		plane1.copyfrom(collision_checker->planesForTriangles[collision_checker->collidedTriangleIndex[0]].ch_getPlaneNormal());
-		plane2.copyfrom(collision_checker->planesForTriangles[collision_checker->collidedTriangleIndex[1]].ch_getPlaneNormal());
-		
-		if (plane1.distance(plane2) < SMALL_NUM)
+		int release = -1;
+		for (unsigned int i = 0; i < numActive; i++)
 		{
-			collision_checker->ch_popBack();
+			if (lambda[i] > SMALL_NUM && (release < 0 || lambda[i] > lambda[release]))
+				release = i;
 		}
+
+		if (release < 0)
+			break;
+
+		ch_removeConstraint(release);
+		numReleases++;
 	}
 
+	if (numActive == 0)
+		proxy = device;	// free space, the GO follows the device
+}
 
-	// which constraints are active? - fill out values in the 6x6 matrix - see structure of matrix in the chapter
-	// on haptic rendering with the GO algorithm
-	switch (collision_checker->collidedTriangleIndex.size())
-	{
-	case 1:
+
+
+// does the point of plane i lie on the face it came from?
+bool ch_GOAlgorithm::ch_onConstraintFace(ch_segmentTriangleCollisionChecker* collision_checker, const ch_vec3& point, unsigned int i)
+{
+	// the triangle of the last tick first, the GO moves little
+	if (activeTriangles[i] >= 0 && (unsigned int)activeTriangles[i] < collision_checker->ch_getNumTriangles())
 	{
-			break;
+		const ch_triangle& triangle = collision_checker->ch_getTriangle(activeTriangles[i]);
+		if (ch_distanceSq(point, ch_closestPointOnTriangle(point, triangle.v0, triangle.v1, triangle.v2)) <= CH_GO_FACE_TOLERANCE * CH_GO_FACE_TOLERANCE)
+			return true;
 	}
 
-	case 2:
+	// or another triangle of the same flat face, eg. the second triangle of a cube face
+	int neighbour = collision_checker->ch_findTriangleOnPlane(point, activePlanes[i], CH_GO_FACE_TOLERANCE);
+	if (neighbour < 0)
+		return false;
+
+	activeTriangles[i] = neighbour;
+	return true;
+}
+
+
+
+// add a plane to the working set unless it is already there
+void ch_GOAlgorithm::ch_addConstraint(const ch_vec3& plane, int triangle)
+{
+	for (unsigned int i = 0; i < numActive; i++)
 	{
-			break;
+		if (ch_distance(activePlanes[i], plane) < SMALL_NUM && fabs(activePlanes[i].w - plane.w) < SMALL_NUM)
+			return;
 	}
 
-	case 3:
+	// a point has at most three independent constraints, the oldest one makes room for a new contact
+	if (numActive == CH_GO_MAX_CONSTRAINTS)
+		ch_removeConstraint(0);
+
+	activePlanes[numActive] = plane;
+	activeTriangles[numActive] = triangle;
+	numActive++;
+	factorizationValid = false;
+}
+
+
+
+// remove a plane from the working set
+void ch_GOAlgorithm::ch_removeConstraint(unsigned int i)
+{
+	for (; i + 1 < numActive; i++)
 	{
-			break;
+		activePlanes[i] = activePlanes[i + 1];
+		activeTriangles[i] = activeTriangles[i + 1];
 	}
+	numActive--;
+	factorizationValid = false;
+}
+
+
+
+// solve the KKT system of the working set
+bool ch_GOAlgorithm::ch_solveKKT(const ch_vec3& device, ch_vec3& proxy, double* lambda)
+{
+	unsigned int k = numActive;
+	unsigned int n = 3 + k;
 
-	default:
+	// the matrix only depends on the planes, between ticks with the same working set only the right
+	// hand side changes and the factorization is reused
+	if (!factorizationValid)
 	{
-			   double a_data[] = { 1, 0, 0,
-				   0, 1, 0,
-				   0, 0, 1 };
-			   double b_data[] = { current_device_pos.x(), current_device_pos.y(), current_device_pos.z() };
+		gsl_matrix* m = kktMatrix[k];
+		int signum;
 
-			   m = gsl_matrix_view_array(a_data, 3, 3);
-			   b = gsl_vector_view_array(b_data, 3);
+		gsl_matrix_set_zero(m);
+		for (unsigned int i = 0; i < 3; i++)
+			gsl_matrix_set(m, i, i, 1.0);
+		for (unsigned int c = 0; c < k; c++)
+		{
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				gsl_matrix_set(m, i, 3 + c, activePlanes[c][i]);
+				gsl_matrix_set(m, 3 + c, i, activePlanes[c][i]);
+			}
+		}
+
+		gsl_linalg_LU_decomp(m, kktPermutation[k], &signum);
+		numFactorizations++;
 
-			   x = gsl_vector_alloc(3);
-			   p = gsl_permutation_alloc(3);
+		// a vanishing pivot means dependent planes, gsl would fail on the solve
+		for (unsigned int i = 0; i < n; i++)
+		{
+			if (fabs(gsl_matrix_get(m, i, i)) < CH_GO_MIN_PIVOT)
+				return false;
+		}
+		factorizationValid = true;
 	}
+	else
+	{
+		numWarmSolves++;
 	}
 
-	s = ((m.matrix.size1 % 2) == 0) ? 1 : -1;
+	for (unsigned int i = 0; i < 3; i++)
+		gsl_vector_set(kktRhs[k], i, device[i]);
+	for (unsigned int c = 0; c < k; c++)
+		gsl_vector_set(kktRhs[k], 3 + c, activePlanes[c].w);
+
+	gsl_linalg_LU_solve(kktMatrix[k], kktPermutation[k], kktRhs[k], kktSolution[k]);
 
-    next_proxy_pos.set(gsl_vector_get(x, 0), gsl_vector_get(x, 1), gsl_vector_get(x, 2));
+	proxy = ch_vec3(gsl_vector_get(kktSolution[k], 0), gsl_vector_get(kktSolution[k], 1), gsl_vector_get(kktSolution[k], 2));
+	for (unsigned int c = 0; c < k; c++)
+		lambda[c] = gsl_vector_get(kktSolution[k], 3 + c);
 
-	gsl_permutation_free(p);
-	gsl_vector_free(x);
+	return true;
 }
 
 
@@ -97,9 +281,9 @@ void ch_GOAlgorithm::ch_fillGOPositionOptimisation(ch_segmentTriangleCollisionCh
 // compute feedback force according to the Hooke's law
 void ch_GOAlgorithm::ch_computeStiffForce(const cVector3d& next_proxy_pos, const cVector3d& current_device_pos)
 {
-	// compute spring resistance force between the new calculated GO location and the goal	
+	// compute spring resistance force between the new calculated GO location and the goal
 	next_proxy_pos.subr(current_device_pos, return_force);
-	
+
 	// stiffness of 40 assumed here
 	return_force.mul(40);
-}
\ No newline at end of file
+}
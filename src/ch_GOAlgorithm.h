@@ -17,17 +17,23 @@ using namespace chai3d;
 using namespace std;
 //------------------------------------------------------------------------------
 
+// at most three independent planes constrain a point in 3D
+#define CH_GO_MAX_CONSTRAINTS 3
+
 
 
 class ch_GOAlgorithm
 {
 public:
 
-	// constructor 
-	ch_GOAlgorithm() {};
+	// the cached active set holds 32 byte aligned planes
+	CH_ALIGNED_OPERATOR_NEW
+
+	// constructor
+	ch_GOAlgorithm();
 
-	// destructor 
-	virtual ~ch_GOAlgorithm() {};
+	// destructor
+	virtual ~ch_GOAlgorithm();
 
 	// the feedback forces according to the GO algorithm are computed here
 	cVector3d ch_GOComputeForces(ch_segmentTriangleCollisionChecker* collision_checker, cVector3d& next_proxy_pos, const cVector3d& current_device_pos);
@@ -37,12 +43,72 @@ public:
 
 	// compute feedback force according to the Hooke's law
 	void ch_computeStiffForce(const cVector3d& next_proxy_pos, const cVector3d& current_device_pos);
-	
-	
+
+	// forget the active constraints of the last tick, eg. when the object changes. a solve with another
+	// checker than the last one does so by itself
+	void ch_resetActiveSet();
+
+	// number of planes constraining the GO after the last solve
+	inline unsigned int ch_getNumActiveConstraints() const { return numActive; }
+
+	// solver counters: position solves, solves that had to factorize the KKT matrix, solves that
+	// reused the factorization of the previous tick, constraints released by their multiplier sign, and
+	// constraints dropped because the GO left the face they came from
+	inline unsigned int ch_getNumSolves() const { return numSolves; }
+	inline unsigned int ch_getNumFactorizations() const { return numFactorizations; }
+	inline unsigned int ch_getNumWarmSolves() const { return numWarmSolves; }
+	inline unsigned int ch_getNumReleases() const { return numReleases; }
+	inline unsigned int ch_getNumFaceReleases() const { return numFaceReleases; }
+
+	// reset the solver counters
+	void ch_resetCounters();
+
+
 protected:
-	
+
+	// add a plane to the working set unless it is already there
+	void ch_addConstraint(const ch_vec3& plane, int triangle);
+
+	// remove a plane from the working set
+	void ch_removeConstraint(unsigned int i);
+
+	// project the device onto the working set, releasing the planes that pull the GO into the object
+	void ch_solveWorkingSet(const ch_vec3& device, ch_vec3& proxy);
+
+	// does the point of plane i lie on the triangle it came from, or on a coplanar one of the same face?
+	// the latter becomes the triangle of the plane
+	bool ch_onConstraintFace(ch_segmentTriangleCollisionChecker* collision_checker, const ch_vec3& point, unsigned int i);
+
+	// solve the KKT system [I N^T; N 0] [x; lambda] = [device; d] of the working set, factorizing only
+	// if the working set changed since the last factorization. returns false if the planes are dependent
+	bool ch_solveKKT(const ch_vec3& device, ch_vec3& proxy, double* lambda);
+
 	// the computed feedback force according to the Hooke's law
 	cVector3d return_force;
+
+	// working set: planes (normal, w = d) and the triangles they came from
+	ch_vec3 activePlanes[CH_GO_MAX_CONSTRAINTS + 1];
+	int activeTriangles[CH_GO_MAX_CONSTRAINTS + 1];
+	unsigned int numActive;
+
+	// the checker whose triangles the working set refers to
+	const ch_segmentTriangleCollisionChecker* workingSetChecker;
+
+	// KKT matrix, its LU factorization and the right hand side / solution per working set size
+	gsl_matrix* kktMatrix[CH_GO_MAX_CONSTRAINTS + 1];
+	gsl_permutation* kktPermutation[CH_GO_MAX_CONSTRAINTS + 1];
+	gsl_vector* kktRhs[CH_GO_MAX_CONSTRAINTS + 1];
+	gsl_vector* kktSolution[CH_GO_MAX_CONSTRAINTS + 1];
+
+	// is the factorization of the current working set valid?
+	bool factorizationValid;
+
+	// counters
+	unsigned int numSolves;
+	unsigned int numFactorizations;
+	unsigned int numWarmSolves;
+	unsigned int numReleases;
+	unsigned int numFaceReleases;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "ch_GOBatch.h"
+
+// system includes
+#include <math.h>
+
+
+// constructor
+ch_GOBatch::ch_GOBatch(const ch_triangleArray& triangles, const ch_aabbTree& tree, unsigned int numSessions) : triangles(triangles), tree(tree)
+{
+	stiffness = CH_GO_BATCH_STIFFNESS;
+	ch_setNumSessions(numSessions);
+}
+
+
+// change the number of sessions
+void ch_GOBatch::ch_setNumSessions(unsigned int numSessions)
+{
+	proxyX.resize(numSessions, 0.0);
+	proxyY.resize(numSessions, 0.0);
+	proxyZ.resize(numSessions, 0.0);
+	forceX.resize(numSessions, 0.0);
+	forceY.resize(numSessions, 0.0);
+	forceZ.resize(numSessions, 0.0);
+
+	for (unsigned int c = 0; c < CH_GO_BATCH_MAX_CONSTRAINTS; c++)
+	{
+		planeX[c].resize(numSessions, 0.0);
+		planeY[c].resize(numSessions, 0.0);
+		planeZ[c].resize(numSessions, 0.0);
+		planeW[c].resize(numSessions, 0.0);
+		planeTriangle[c].resize(numSessions, -1);
+	}
+	numActive.resize(numSessions, 0);
+}
+
+
+// put a session's GO at position and forget its constraints
+void ch_GOBatch::ch_resetSession(unsigned int session, const ch_vec3& position)
+{
+	proxyX[session] = position.x;
+	proxyY[session] = position.y;
+	proxyZ[session] = position.z;
+	forceX[session] = forceY[session] = forceZ[session] = 0.0;
+	numActive[session] = 0;
+}
+
+
+// one tick of every session
+void ch_GOBatch::ch_step(const double* deviceX, const double* deviceY, const double* deviceZ, ch_threadPool* pool)
+{
+	// the sessions only share read-only geometry, any split works
+	if (pool)
+		pool->ch_parallelFor(ch_getNumSessions(), CH_GO_BATCH_GRAIN, [this, deviceX, deviceY, deviceZ](unsigned int first, unsigned int last) { ch_stepRange(deviceX, deviceY, deviceZ, first, last); });
+	else
+		ch_stepRange(deviceX, deviceY, deviceZ, 0, ch_getNumSessions());
+}
+
+
+// one tick of sessions [first, last)
+void ch_GOBatch::ch_stepRange(const double* deviceX, const double* deviceY, const double* deviceZ, unsigned int first, unsigned int last)
+{
+	ch_treeWalk walk;
+	const unsigned int *leafFirst, *leafLast;
+	ch_vec3 point;
+	unsigned int hitTriangles[CH_GO_BATCH_MAX_HITS];
+	double hitT[CH_GO_BATCH_MAX_HITS];
+
+	for (unsigned int i = first; i < last; i++)
+	{
+		ch_vec3 device(deviceX[i], deviceY[i], deviceZ[i]);
+		ch_vec3 start(proxyX[i], proxyY[i], proxyZ[i]);
+		ch_vec3 direction = device - start;
+
+		// gather the working set of the last tick
+		ch_workingSet set;
+		set.size = numActive[i];
+		for (unsigned int c = 0; c < set.size; c++)
+		{
+			set.planes[c] = ch_vec3(planeX[c][i], planeY[c][i], planeZ[c][i]);
+			set.planes[c].w = planeW[c][i];
+			set.triangles[c] = planeTriangle[c][i];
+		}
+
+		// triangles hit by the GO-device segment, in segment order as ch_checkCollisions() reports them
+		unsigned int numHits = 0;
+		double t;
+		tree.ch_beginWalk(start, direction, walk);
+		while (tree.ch_nextLeaf(walk, 1.0, leafFirst, leafLast))
+		{
+			for (; leafFirst != leafLast; ++leafFirst)
+			{
+				if (ch_intersectSegmentTriangle(triangles[*leafFirst], start, direction, t, point) != CH_HIT)
+					continue;
+
+				// a full list drops its farthest hit
+				if (numHits == CH_GO_BATCH_MAX_HITS)
+				{
+					if (t >= hitT[numHits - 1])
+						continue;
+					numHits--;
+				}
+
+				unsigned int j = numHits++;
+				for (; j > 0 && hitT[j - 1] > t; j--)
+				{
+					hitTriangles[j] = hitTriangles[j - 1];
+					hitT[j] = hitT[j - 1];
+				}
+				hitTriangles[j] = *leafFirst;
+				hitT[j] = t;
+			}
+		}
+
+		// the planes of the last tick only hold the GO while it stays on their faces, as in
+		// ch_GOAlgorithm::ch_fillGOPositionOptimisation()
+		ch_vec3 proxy = device;
+		if (set.size > 0)
+		{
+			ch_solveSet(set, device, proxy);
+			for (unsigned int c = set.size; c-- > 0;)
+			{
+				if (!ch_onPlaneFace(set, proxy, c))
+					ch_removePlane(set, c);
+			}
+		}
+
+		for (unsigned int h = 0; h < numHits; h++)
+			ch_addPlane(set, triangles[hitTriangles[h]].normal, hitTriangles[h]);
+
+		ch_solveSet(set, device, proxy);
+
+		// scatter the state back
+		proxyX[i] = proxy.x;
+		proxyY[i] = proxy.y;
+		proxyZ[i] = proxy.z;
+		forceX[i] = stiffness * (proxy.x - device.x);
+		forceY[i] = stiffness * (proxy.y - device.y);
+		forceZ[i] = stiffness * (proxy.z - device.z);
+
+		numActive[i] = (unsigned char)set.size;
+		for (unsigned int c = 0; c < set.size; c++)
+		{
+			planeX[c][i] = set.planes[c].x;
+			planeY[c][i] = set.planes[c].y;
+			planeZ[c][i] = set.planes[c].z;
+			planeW[c][i] = set.planes[c].w;
+			planeTriangle[c][i] = set.triangles[c];
+		}
+	}
+}
+
+
+// add a plane unless it is already there
+void ch_GOBatch::ch_addPlane(ch_workingSet& set, const ch_vec3& plane, int triangle)
+{
+	// coplanar triangles, eg. the two triangles of a cube face, give the same plane
+	for (unsigned int c = 0; c < set.size; c++)
+	{
+		if (ch_distance(set.planes[c], plane) < SMALL_NUM && fabs(set.planes[c].w - plane.w) < SMALL_NUM)
+			return;
+	}
+
+	if (set.size == CH_GO_BATCH_MAX_CONSTRAINTS)
+		ch_removePlane(set, 0);
+
+	set.planes[set.size] = plane;
+	set.triangles[set.size] = triangle;
+	set.size++;
+}
+
+
+// remove plane i
+void ch_GOBatch::ch_removePlane(ch_workingSet& set, unsigned int i)
+{
+	for (; i + 1 < set.size; i++)
+	{
+		set.planes[i] = set.planes[i + 1];
+		set.triangles[i] = set.triangles[i + 1];
+	}
+	set.size--;
+}
+
+
+// solve and release
+void ch_GOBatch::ch_solveSet(ch_workingSet& set, const ch_vec3& device, ch_vec3& proxy)
+{
+	double lambda[CH_GO_BATCH_MAX_CONSTRAINTS];
+	while (set.size > 0)
+	{
+		if (!ch_solvePlanes(set, device, proxy, lambda))
+		{
+			// dependent planes: keep the older ones
+			ch_removePlane(set, set.size - 1);
+			continue;
+		}
+
+		int release = -1;
+		for (unsigned int c = 0; c < set.size; c++)
+		{
+			if (lambda[c] > SMALL_NUM && (release < 0 || lambda[c] > lambda[release]))
+				release = c;
+		}
+
+		if (release < 0)
+			break;
+
+		ch_removePlane(set, release);
+	}
+
+	if (set.size == 0)
+		proxy = device;
+}
+
+
+// does the point of plane c lie on its face?
+bool ch_GOBatch::ch_onPlaneFace(ch_workingSet& set, const ch_vec3& point, unsigned int c) const
+{
+	const ch_triangle& triangle = triangles[set.triangles[c]];
+	if (ch_distanceSq(point, ch_closestPointOnTriangle(point, triangle.v0, triangle.v1, triangle.v2)) <= CH_GO_BATCH_FACE_TOLERANCE * CH_GO_BATCH_FACE_TOLERANCE)
+		return true;
+
+	int neighbour = tree.ch_findOnPlane(triangles, point, set.planes[c], CH_GO_BATCH_FACE_TOLERANCE);
+	if (neighbour < 0)
+		return false;
+
+	set.triangles[c] = neighbour;
+	return true;
+}
+
+
+// minimise |x - device|^2 on the planes
+bool ch_GOBatch::ch_solvePlanes(const ch_workingSet& set, const ch_vec3& device, ch_vec3& proxy, double* lambda)
+{
+	const ch_vec3* n = set.planes;
+	double b[CH_GO_BATCH_MAX_CONSTRAINTS];
+	for (unsigned int c = 0; c < set.size; c++)
+		b[c] = ch_dot(n[c], device) - n[c].w;
+
+	if (set.size == 1)
+	{
+		double g = ch_dot(n[0], n[0]);
+		if (g < CH_GO_BATCH_MIN_DETERMINANT)
+			return false;
+		lambda[0] = b[0] / g;
+		proxy = device - n[0] * lambda[0];
+		return true;
+	}
+
+	double g00 = ch_dot(n[0], n[0]), g01 = ch_dot(n[0], n[1]), g11 = ch_dot(n[1], n[1]);
+
+	if (set.size == 2)
+	{
+		double det = g00 * g11 - g01 * g01;
+		if (det < CH_GO_BATCH_MIN_DETERMINANT)
+			return false;
+		lambda[0] = (g11 * b[0] - g01 * b[1]) / det;
+		lambda[1] = (g00 * b[1] - g01 * b[0]) / det;
+		proxy = device - n[0] * lambda[0] - n[1] * lambda[1];
+		return true;
+	}
+
+	// three planes: the symmetric 3x3 system by its cofactors
+	double g02 = ch_dot(n[0], n[2]), g12 = ch_dot(n[1], n[2]), g22 = ch_dot(n[2], n[2]);
+	double c00 = g11 * g22 - g12 * g12;
+	double c01 = g02 * g12 - g01 * g22;
+	double c02 = g01 * g12 - g02 * g11;
+	double c11 = g00 * g22 - g02 * g02;
+	double c12 = g01 * g02 - g00 * g12;
+	double c22 = g00 * g11 - g01 * g01;
+	double det = g00 * c00 + g01 * c01 + g02 * c02;
+	if (det < CH_GO_BATCH_MIN_DETERMINANT)
+		return false;
+
+	double inverse = 1.0 / det;
+	lambda[0] = (c00 * b[0] + c01 * b[1] + c02 * b[2]) * inverse;
+	lambda[1] = (c01 * b[0] + c11 * b[1] + c12 * b[2]) * inverse;
+	lambda[2] = (c02 * b[0] + c12 * b[1] + c22 * b[2]) * inverse;
+	proxy = device - n[0] * lambda[0] - n[1] * lambda[1] - n[2] * lambda[2];
+	return true;
+}
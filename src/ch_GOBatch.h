@@ -0,0 +1,117 @@
+#ifndef CH_GOBATCH_H
+#define CH_GOBATCH_H
+
+// CH lab
+// many independent god-object sessions stepped together, eg. for offline evaluation over recorded or
+// synthetic trajectories. the sessions share one rigid object (triangles and AABB tree, only read) and
+// keep their state in structure-of-arrays form; a step runs the segment query and the constraint solve of
+// every session, split over a thread pool. the solve is the closed form of the KKT system of at most three
+// planes, so no factorization library is needed. no CHAI3D dependency
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_aabbTree.h"
+#include "ch_geometry.h"
+#include "ch_threadPool.h"
+
+using namespace std;
+
+// at most three independent planes constrain a point in 3D
+#define CH_GO_BATCH_MAX_CONSTRAINTS 3
+
+// smallest Gram determinant of the plane normals that still counts as independent planes
+#define CH_GO_BATCH_MIN_DETERMINANT 1.0e-6
+
+// triangles hit by one GO-device segment that are turned into constraints, in segment order
+#define CH_GO_BATCH_MAX_HITS 16
+
+// sessions per chunk when a step is split over a pool
+#define CH_GO_BATCH_GRAIN 256
+
+// distance within which a GO still counts as on the face of one of its planes, as in ch_GOAlgorithm
+#define CH_GO_BATCH_FACE_TOLERANCE 1.0e-6
+
+// default spring constant between the GO and the device, as ch_GOAlgorithm::ch_computeStiffForce()
+#define CH_GO_BATCH_STIFFNESS 40.0
+
+
+class ch_GOBatch
+{
+public:
+
+	// constructor, the triangles and their tree must stay unchanged while the batch uses them
+	ch_GOBatch(const ch_triangleArray& triangles, const ch_aabbTree& tree, unsigned int numSessions = 0);
+
+	// destructor
+	virtual ~ch_GOBatch() {};
+
+	// change the number of sessions, new ones start at the origin without constraints
+	void ch_setNumSessions(unsigned int numSessions);
+	inline unsigned int ch_getNumSessions() const { return (unsigned int)proxyX.size(); }
+
+	// put a session's GO at position and forget its constraints, eg. at the start of a trajectory
+	void ch_resetSession(unsigned int session, const ch_vec3& position);
+
+	// one tick of every session towards the device positions (deviceX[i], deviceY[i], deviceZ[i]), on the
+	// pool if one is given
+	void ch_step(const double* deviceX, const double* deviceY, const double* deviceZ, ch_threadPool* pool = NULL);
+
+	// one tick of sessions [first, last)
+	void ch_stepRange(const double* deviceX, const double* deviceY, const double* deviceZ, unsigned int first, unsigned int last);
+
+	// state of a session after the last step
+	inline ch_vec3 ch_getProxy(unsigned int session) const { return ch_vec3(proxyX[session], proxyY[session], proxyZ[session]); }
+	inline ch_vec3 ch_getForce(unsigned int session) const { return ch_vec3(forceX[session], forceY[session], forceZ[session]); }
+	inline unsigned int ch_getNumActiveConstraints(unsigned int session) const { return numActive[session]; }
+
+	// spring constant of the force
+	inline void ch_setStiffness(double value) { stiffness = value; }
+
+protected:
+
+	// working set of one session while it is stepped
+	struct ch_workingSet
+	{
+		ch_vec3 planes[CH_GO_BATCH_MAX_CONSTRAINTS];
+		int triangles[CH_GO_BATCH_MAX_CONSTRAINTS];
+		unsigned int size;
+	};
+
+	// add a plane unless it is already there, the oldest one makes room
+	static void ch_addPlane(ch_workingSet& set, const ch_vec3& plane, int triangle);
+
+	// remove plane i, keeping the order of the others
+	static void ch_removePlane(ch_workingSet& set, unsigned int i);
+
+	// minimise |x - device|^2 on the planes: G lambda = N device - w, x = device - N^T lambda with the Gram
+	// matrix G = N N^T solved in closed form. returns false if the planes are dependent
+	static bool ch_solvePlanes(const ch_workingSet& set, const ch_vec3& device, ch_vec3& proxy, double* lambda);
+
+	// the active set loop of ch_GOAlgorithm: solve, release the planes that pull the GO into the object
+	static void ch_solveSet(ch_workingSet& set, const ch_vec3& device, ch_vec3& proxy);
+
+	// does the point of plane c lie on the triangle it came from, or on a coplanar one that then replaces it?
+	bool ch_onPlaneFace(ch_workingSet& set, const ch_vec3& point, unsigned int c) const;
+
+	// geometry shared by the sessions
+	const ch_triangleArray& triangles;
+	const ch_aabbTree& tree;
+
+	double stiffness;
+
+	// GO position and force per session
+	vector<double> proxyX, proxyY, proxyZ;
+	vector<double> forceX, forceY, forceZ;
+
+	// working set per session: slot c of every session in planeX[c] ... planeTriangle[c]
+	vector<double> planeX[CH_GO_BATCH_MAX_CONSTRAINTS];
+	vector<double> planeY[CH_GO_BATCH_MAX_CONSTRAINTS];
+	vector<double> planeZ[CH_GO_BATCH_MAX_CONSTRAINTS];
+	vector<double> planeW[CH_GO_BATCH_MAX_CONSTRAINTS];
+	vector<int> planeTriangle[CH_GO_BATCH_MAX_CONSTRAINTS];
+	vector<unsigned char> numActive;
+};
+
+#endif
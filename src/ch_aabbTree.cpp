@@ -0,0 +1,303 @@
+#include "ch_aabbTree.h"
+
+// system includes
+#include <algorithm>
+#include <functional>
+
+
+// orders triangle indices by the centroid coordinate along one axis
+struct ch_centroidLess
+{
+	const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >* centroids;
+	int axis;
+
+	bool operator()(unsigned int a, unsigned int b) const { return (*centroids)[a][axis] < (*centroids)[b][axis]; }
+};
+
+
+// constructor
+ch_aabbTree::ch_aabbTree()
+{
+}
+
+
+// build the tree over world space triangles
+void ch_aabbTree::ch_build(const ch_triangleArray& triangles)
+{
+	unsigned int numTriangles = (unsigned int)triangles.size();
+
+	nodes.clear();
+	leafTriangles.resize(numTriangles);
+	triangleLeaf.resize(numTriangles);
+
+	if (numTriangles == 0)
+		return;
+
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > centroids(numTriangles);
+	for (unsigned int i = 0; i < numTriangles; i++)
+	{
+		centroids[i] = (triangles[i].v0 + triangles[i].v1 + triangles[i].v2) * (1.0 / 3.0);
+		leafTriangles[i] = i;
+	}
+
+	// a binary tree with leaves of at least one triangle has fewer than 2n nodes
+	nodes.reserve(2 * (numTriangles / CH_TREE_LEAF_SIZE + 1));
+	nodes.resize(1);
+	nodes[0].parent = -1;
+	ch_buildNode(0, 0, numTriangles, centroids, triangles);
+
+	nodeDirty.assign(nodes.size(), 0);
+}
+
+
+// split the triangles leafTriangles[first, first + count) below node
+void ch_aabbTree::ch_buildNode(unsigned int node, unsigned int first, unsigned int count, const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& centroids, const ch_triangleArray& triangles)
+{
+	if (count <= CH_TREE_LEAF_SIZE)
+	{
+		nodes[node].first = first;
+		nodes[node].count = count;
+		for (unsigned int i = first; i < first + count; i++)
+			triangleLeaf[leafTriangles[i]] = node;
+		ch_computeLeafBounds(nodes[node], triangles);
+		return;
+	}
+
+	// median split along the largest extent of the centroids
+	ch_aabb centroidBounds;
+	for (unsigned int i = first; i < first + count; i++)
+		centroidBounds.ch_extend(centroids[leafTriangles[i]]);
+
+	ch_vec3 extent = centroidBounds.ch_extent();
+	ch_centroidLess less;
+	less.centroids = &centroids;
+	less.axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+
+	unsigned int half = count / 2;
+	nth_element(leafTriangles.begin() + first, leafTriangles.begin() + first + half, leafTriangles.begin() + first + count, less);
+
+	// the children go next to each other, after the parent; nodes may reallocate below
+	unsigned int child = (unsigned int)nodes.size();
+	nodes.resize(child + 2);
+	nodes[node].first = child;
+	nodes[node].count = 0;
+	nodes[child].parent = nodes[child + 1].parent = (int)node;
+
+	ch_buildNode(child, first, half, centroids, triangles);
+	ch_buildNode(child + 1, first + half, count - half, centroids, triangles);
+
+	nodes[node].bounds = nodes[child].bounds;
+	nodes[node].bounds.ch_extend(nodes[child + 1].bounds);
+}
+
+
+// bounds of a leaf from its triangles
+void ch_aabbTree::ch_computeLeafBounds(ch_aabbNode& node, const ch_triangleArray& triangles) const
+{
+	node.bounds = ch_aabb();
+	for (unsigned int i = node.first; i < node.first + node.count; i++)
+		node.bounds.ch_extend(ch_triangleBounds(triangles[leafTriangles[i]]));
+
+	// flat leaves, eg. on an axis aligned face, must not lose hits to rounding in the slab test
+	node.bounds.lo -= ch_vec3(SMALL_NUM, SMALL_NUM, SMALL_NUM);
+	node.bounds.hi += ch_vec3(SMALL_NUM, SMALL_NUM, SMALL_NUM);
+}
+
+
+// recompute the bounds of the leaves holding the given triangles and of their ancestors
+void ch_aabbTree::ch_refit(const ch_triangleArray& triangles, const unsigned int* changedTriangles, unsigned int numChanged)
+{
+	vector<unsigned int> dirty;
+
+	// mark every leaf with a changed triangle and the path to the root, stopping at marked nodes
+	for (unsigned int i = 0; i < numChanged; i++)
+	{
+		int node = (int)triangleLeaf[changedTriangles[i]];
+		while (node >= 0 && !nodeDirty[node])
+		{
+			nodeDirty[node] = 1;
+			dirty.push_back((unsigned int)node);
+			node = nodes[node].parent;
+		}
+	}
+
+	// children are stored after their parents: refit from the highest index down
+	sort(dirty.begin(), dirty.end(), greater<unsigned int>());
+
+	for (unsigned int i = 0; i < dirty.size(); i++)
+	{
+		ch_aabbNode& node = nodes[dirty[i]];
+		if (node.count > 0)
+		{
+			ch_computeLeafBounds(node, triangles);
+		}
+		else
+		{
+			node.bounds = nodes[node.first].bounds;
+			node.bounds.ch_extend(nodes[node.first + 1].bounds);
+		}
+		nodeDirty[dirty[i]] = 0;
+	}
+}
+
+
+// recompute every bound of the tree
+void ch_aabbTree::ch_refitAll(const ch_triangleArray& triangles)
+{
+	for (unsigned int i = (unsigned int)nodes.size(); i-- > 0;)
+	{
+		ch_aabbNode& node = nodes[i];
+		if (node.count > 0)
+		{
+			ch_computeLeafBounds(node, triangles);
+		}
+		else
+		{
+			node.bounds = nodes[node.first].bounds;
+			node.bounds.ch_extend(nodes[node.first + 1].bounds);
+		}
+	}
+}
+
+
+// start a traversal along the segment
+void ch_aabbTree::ch_beginWalk(const ch_vec3& start, const ch_vec3& direction, ch_treeWalk& walk) const
+{
+	walk.start = start;
+	walk.direction = direction;
+	walk.top = 0;
+
+	if (!nodes.empty())
+		walk.stack[walk.top++] = 0;
+}
+
+
+// next leaf whose bounds the segment touches
+bool ch_aabbTree::ch_nextLeaf(ch_treeWalk& walk, double tMax, const unsigned int*& first, const unsigned int*& last) const
+{
+	while (walk.top > 0)
+	{
+		const ch_aabbNode& node = nodes[walk.stack[--walk.top]];
+
+		double t0 = 0.0, t1 = tMax;
+		if (!ch_clipSegmentToBox(node.bounds, walk.start, walk.direction, t0, t1))
+			continue;
+
+		if (node.count > 0)
+		{
+			first = &leafTriangles[node.first];
+			last = first + node.count;
+			return true;
+		}
+
+		// push the farther child first, so that the nearer one is visited next
+		double near0 = ch_dot(nodes[node.first].bounds.ch_center() - walk.start, walk.direction);
+		double near1 = ch_dot(nodes[node.first + 1].bounds.ch_center() - walk.start, walk.direction);
+		unsigned int nearChild = (near0 <= near1) ? node.first : node.first + 1;
+
+		walk.stack[walk.top++] = (nearChild == node.first) ? node.first + 1 : node.first;
+		walk.stack[walk.top++] = nearChild;
+	}
+	return false;
+}
+
+
+// triangle nearest to a point
+int ch_aabbTree::ch_findClosest(const ch_triangleArray& triangles, const ch_vec3& point, double maxDistanceSq, ch_vec3& closest, double& distanceSq) const
+{
+	int found = -1;
+	distanceSq = maxDistanceSq;
+	if (nodes.empty())
+		return found;
+
+	unsigned int stack[CH_TREE_STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const ch_aabbNode& node = nodes[stack[--top]];
+
+		// a box no nearer than the best triangle holds no better one
+		if (ch_distanceSqToBox(node.bounds, point) >= distanceSq)
+			continue;
+
+		if (node.count > 0)
+		{
+			for (unsigned int k = node.first; k < node.first + node.count; k++)
+			{
+				const ch_triangle& triangle = triangles[leafTriangles[k]];
+
+				// the plane distance bounds the triangle distance from below and costs a dot product
+				double planeDistance = ch_dot(triangle.normal, point) - triangle.normal.w;
+				if (planeDistance * planeDistance >= distanceSq)
+					continue;
+
+				ch_vec3 q = ch_closestPointOnTriangle(point, triangle.v0, triangle.v1, triangle.v2);
+				double d = ch_distanceSq(point, q);
+				if (d < distanceSq)
+				{
+					distanceSq = d;
+					closest = q;
+					found = (int)leafTriangles[k];
+				}
+			}
+			continue;
+		}
+
+		// push the farther child first, so that the nearer one is searched next and shrinks the radius early.
+		// a point inside both boxes goes on with the one whose center is nearer
+		const ch_aabb& box0 = nodes[node.first].bounds;
+		const ch_aabb& box1 = nodes[node.first + 1].bounds;
+		double near0 = ch_distanceSqToBox(box0, point), near1 = ch_distanceSqToBox(box1, point);
+		if (near0 == near1)
+		{
+			near0 = ch_distanceSq(box0.ch_center(), point);
+			near1 = ch_distanceSq(box1.ch_center(), point);
+		}
+		unsigned int nearChild = (near0 <= near1) ? node.first : node.first + 1;
+
+		stack[top++] = (nearChild == node.first) ? node.first + 1 : node.first;
+		stack[top++] = nearChild;
+	}
+	return found;
+}
+
+
+// a triangle of a plane near a point
+int ch_aabbTree::ch_findOnPlane(const ch_triangleArray& triangles, const ch_vec3& point, const ch_vec3& plane, double maxDistance) const
+{
+	if (nodes.empty())
+		return -1;
+
+	double maxDistanceSq = maxDistance * maxDistance;
+	unsigned int stack[CH_TREE_STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const ch_aabbNode& node = nodes[stack[--top]];
+		if (ch_distanceSqToBox(node.bounds, point) > maxDistanceSq)
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+			continue;
+		}
+
+		for (unsigned int k = node.first; k < node.first + node.count; k++)
+		{
+			// the same plane as for the coplanar triangles of a working set
+			const ch_triangle& triangle = triangles[leafTriangles[k]];
+			if (ch_distance(triangle.normal, plane) >= SMALL_NUM || fabs(triangle.normal.w - plane.w) >= SMALL_NUM)
+				continue;
+
+			if (ch_distanceSq(point, ch_closestPointOnTriangle(point, triangle.v0, triangle.v1, triangle.v2)) <= maxDistanceSq)
+				return (int)leafTriangles[k];
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,120 @@
+#ifndef CH_AABBTREE_H
+#define CH_AABBTREE_H
+
+// CH lab
+// bounding volume hierarchy of axis aligned boxes over the triangles of an object. unlike the uniform
+// grid its bounds can be refit bottom-up when vertices move, which makes it the structure for deformable
+// objects
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_geometry.h"
+
+using namespace std;
+
+// largest number of triangles in a leaf
+#define CH_TREE_LEAF_SIZE 4
+
+// deepest traversal stack; a median split tree over 2^32 triangles stays far below
+#define CH_TREE_STACK_SIZE 64
+
+
+// node of the tree. the children of an inner node are stored next to each other, after their parent
+struct CH_ALIGN(32) ch_aabbNode
+{
+	ch_aabb bounds;
+
+	// inner node: index of the first child; leaf: first entry in the leaf triangle list
+	unsigned int first;
+
+	// number of triangles for a leaf, 0 for an inner node
+	unsigned int count;
+
+	// index of the parent, -1 for the root
+	int parent;
+};
+
+
+// state of a segment traversal, filled by ch_aabbTree::ch_beginWalk()
+struct CH_ALIGN(32) ch_treeWalk
+{
+	ch_vec3 start;
+	ch_vec3 direction;
+
+	// nodes still to visit
+	unsigned int stack[CH_TREE_STACK_SIZE];
+	int top;
+};
+
+
+class ch_aabbTree
+{
+public:
+
+	// constructor
+	ch_aabbTree();
+
+	// destructor
+	virtual ~ch_aabbTree() {};
+
+	// build the tree over world space triangles
+	void ch_build(const ch_triangleArray& triangles);
+
+	// recompute the bounds of the leaves holding the given triangles and of their ancestors, the
+	// topology of the tree is kept. triangles holds the moved geometry, same indices as in ch_build()
+	void ch_refit(const ch_triangleArray& triangles, const unsigned int* changedTriangles, unsigned int numChanged);
+
+	// recompute every bound of the tree
+	void ch_refitAll(const ch_triangleArray& triangles);
+
+	// start a traversal along the segment start + t direction
+	void ch_beginWalk(const ch_vec3& start, const ch_vec3& direction, ch_treeWalk& walk) const;
+
+	// next leaf whose bounds the segment touches for t in [0, tMax], nearer child first, with its
+	// triangle indices as [first, last). tMax may shrink between calls, eg. for nearest-hit queries
+	bool ch_nextLeaf(ch_treeWalk& walk, double tMax, const unsigned int*& first, const unsigned int*& last) const;
+
+	// triangle nearest to a point among those closer than sqrt(maxDistanceSq), with its closest point and
+	// squared distance. returns -1 if there is none. triangles is the geometry the tree was built or refit on
+	int ch_findClosest(const ch_triangleArray& triangles, const ch_vec3& point, double maxDistanceSq, ch_vec3& closest, double& distanceSq) const;
+
+	// a triangle of the plane (normal, w = d) closer than maxDistance to a point, eg. the one of a flat face
+	// that a GO constrained by the plane slid onto. returns -1 if there is none
+	int ch_findOnPlane(const ch_triangleArray& triangles, const ch_vec3& point, const ch_vec3& plane, double maxDistance) const;
+
+	// has the tree been built?
+	inline bool ch_isBuilt() const { return !nodes.empty(); }
+
+	// nodes, the root first
+	inline const vector<ch_aabbNode, ch_alignedAllocator<ch_aabbNode> >& ch_getNodes() const { return nodes; }
+
+	// triangle indices of all leaves, stored contiguously per leaf
+	inline const vector<unsigned int>& ch_getLeafTriangles() const { return leafTriangles; }
+
+	// number of nodes
+	inline unsigned int ch_getNumNodes() const { return (unsigned int)nodes.size(); }
+
+protected:
+
+	// split the triangles leafTriangles[first, first + count) below node
+	void ch_buildNode(unsigned int node, unsigned int first, unsigned int count, const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& centroids, const ch_triangleArray& triangles);
+
+	// bounds of a leaf from its triangles
+	void ch_computeLeafBounds(ch_aabbNode& node, const ch_triangleArray& triangles) const;
+
+	// nodes, the root first
+	vector<ch_aabbNode, ch_alignedAllocator<ch_aabbNode> > nodes;
+
+	// triangle indices of all leaves
+	vector<unsigned int> leafTriangles;
+
+	// leaf of every triangle
+	vector<unsigned int> triangleLeaf;
+
+	// refit marks, one per node
+	vector<unsigned char> nodeDirty;
+};
+
+#endif
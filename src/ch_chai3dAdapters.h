@@ -0,0 +1,34 @@
+#ifndef CH_CHAI3DADAPTERS_H
+#define CH_CHAI3DADAPTERS_H
+
+// CH lab
+// conversions between the CHAI3D types used by the application and the ch_math.h core types
+
+// CHAI3D includes
+#include "chai3d.h"
+
+// local includes
+#include "ch_math.h"
+
+using namespace chai3d;
+
+inline ch_vec3 ch_toVec3(const cVector3d& v)
+{
+	return ch_vec3(v.x(), v.y(), v.z());
+}
+
+inline cVector3d ch_toCVector3d(const ch_vec3& v)
+{
+	return cVector3d(v.x, v.y, v.z);
+}
+
+inline ch_mat3 ch_toMat3(const cMatrix3d& m)
+{
+	ch_mat3 r;
+	for (int row = 0; row < 3; row++)
+		for (int col = 0; col < 3; col++)
+			r(row, col) = m(row, col);
+	return r;
+}
+
+#endif
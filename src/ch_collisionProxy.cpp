@@ -0,0 +1,60 @@
+#include "ch_collisionProxy.h"
+
+
+// constructor
+ch_collisionProxy::ch_collisionProxy()
+{
+	visualObject = NULL;
+	proxyObject = NULL;
+}
+
+
+// destructor
+ch_collisionProxy::~ch_collisionProxy()
+{
+	delete proxyObject;
+}
+
+
+// decimate the visual object into the proxy
+void ch_collisionProxy::ch_build(cMultiMesh* visual, double tolerance, unsigned int minTriangles)
+{
+	cMesh* mesh = visual->getMesh(0);
+	unsigned int numVertices = mesh->getNumVertices();
+	unsigned int numTriangles = mesh->getNumTriangles();
+
+	// decimate in the frame of the mesh, rigid motions do not change distances
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > vertices(numVertices);
+	for (unsigned int v = 0; v < numVertices; v++)
+		vertices[v] = ch_toVec3(mesh->m_vertices->getLocalPos(v));
+
+	vector<unsigned int> indices(3 * numTriangles);
+	for (unsigned int i = 0; i < numTriangles; i++)
+	{
+		indices[3 * i] = mesh->m_triangles->getVertexIndex0(i);
+		indices[3 * i + 1] = mesh->m_triangles->getVertexIndex1(i);
+		indices[3 * i + 2] = mesh->m_triangles->getVertexIndex2(i);
+	}
+
+	decimator.ch_decimate(vertices, indices, tolerance, minTriangles);
+
+	const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& proxyVertices = decimator.ch_getVertices();
+	const vector<unsigned int>& proxyIndices = decimator.ch_getIndices();
+
+	cMesh* proxyMesh = new cMesh();
+	for (unsigned int v = 0; v < proxyVertices.size(); v++)
+		proxyMesh->newVertex(ch_toCVector3d(proxyVertices[v]));
+	for (unsigned int i = 0; i < decimator.ch_getNumTriangles(); i++)
+		proxyMesh->newTriangle(proxyIndices[3 * i], proxyIndices[3 * i + 1], proxyIndices[3 * i + 2]);
+
+	// the proxy is not part of the world: it takes the global pose of the visual mesh as its own
+	proxyMesh->setLocalPos(mesh->getGlobalPos());
+	proxyMesh->setLocalRot(mesh->getGlobalRot());
+
+	delete proxyObject;
+	proxyObject = new cMultiMesh();
+	proxyObject->addMesh(proxyMesh);
+	proxyObject->computeGlobalPositions();
+
+	visualObject = visual;
+}
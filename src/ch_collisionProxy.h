@@ -0,0 +1,53 @@
+#ifndef CH_COLLISIONPROXY_H
+#define CH_COLLISIONPROXY_H
+
+// CH lab
+// coarse collision mesh for a dense visual mesh. the proxy is decimated once at load time within a
+// geometric tolerance, placed where the visual mesh is and never rendered; the collision checker runs on
+// it and maps the triangles it hits back to the visual ones for highlighting
+
+// CHAI3D includes
+#include "chai3d.h"
+
+// local includes
+#include "ch_chai3dAdapters.h"
+#include "ch_meshDecimator.h"
+
+using namespace chai3d;
+using namespace std;
+
+
+class ch_collisionProxy
+{
+public:
+
+	// constructor
+	ch_collisionProxy();
+
+	// destructor
+	virtual ~ch_collisionProxy();
+
+	// decimate the first mesh of the visual object so that the surface moves by at most tolerance [m],
+	// keeping at least minTriangles triangles
+	void ch_build(cMultiMesh* visual, double tolerance, unsigned int minTriangles = 0);
+
+	// the proxy, to build the collision checker on
+	inline cMultiMesh* ch_getProxyObject() const { return proxyObject; }
+
+	// the visual object it replaces
+	inline cMultiMesh* ch_getVisualObject() const { return visualObject; }
+
+	// proxy triangle for every visual triangle and back
+	inline const ch_meshDecimator& ch_getDecimator() const { return decimator; }
+
+protected:
+
+	// decimation result and triangle mapping
+	ch_meshDecimator decimator;
+
+	// the objects
+	cMultiMesh* visualObject;
+	cMultiMesh* proxyObject;
+};
+
+#endif
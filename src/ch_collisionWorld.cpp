@@ -0,0 +1,218 @@
+#include "ch_collisionWorld.h"
+
+// system includes
+#include <algorithm>
+
+
+// constructor
+ch_collisionWorld::ch_collisionWorld()
+{
+	numObjects = 0;
+	numCandidates = 0;
+}
+
+
+// register an object with its checker
+unsigned int ch_collisionWorld::ch_addObject(ch_segmentTriangleCollisionChecker* checker)
+{
+	unsigned int object;
+	if (!freeObjects.empty())
+	{
+		object = freeObjects.back();
+		freeObjects.pop_back();
+	}
+	else
+	{
+		object = (unsigned int)objects.size();
+		objects.push_back(ch_worldObject());
+	}
+
+	objects[object].checker = checker;
+	checker->ch_setMeshId((int)object);
+	objects[object].box = sweepAndPrune.ch_addBox(checker->ch_getBounds(), false);
+
+	if (boxObject.size() <= objects[object].box)
+		boxObject.resize(objects[object].box + 1);
+	boxObject[objects[object].box] = object;
+
+	numObjects++;
+	return object;
+}
+
+
+// unregister an object
+void ch_collisionWorld::ch_removeObject(unsigned int object)
+{
+	sweepAndPrune.ch_removeBox(objects[object].box);
+
+	queriedObjects.erase(remove(queriedObjects.begin(), queriedObjects.end(), object), queriedObjects.end());
+	objects[object].checker = NULL;
+	freeObjects.push_back(object);
+	numObjects--;
+}
+
+
+// read the bounds of an object again
+void ch_collisionWorld::ch_updateObject(unsigned int object)
+{
+	sweepAndPrune.ch_updateBox(objects[object].box, objects[object].checker->ch_getBounds());
+}
+
+
+// read the bounds of every deformable object again
+void ch_collisionWorld::ch_updateDeformableObjects()
+{
+	for (unsigned int i = 0; i < objects.size(); i++)
+	{
+		if (objects[i].checker && objects[i].checker->ch_isDeformable())
+			ch_updateObject(i);
+	}
+}
+
+
+// add a tool
+unsigned int ch_collisionWorld::ch_addTool()
+{
+	// the box of a tool stays far away until its first query
+	toolBoxes.push_back(sweepAndPrune.ch_addBox(ch_aabb(), true));
+	return (unsigned int)toolBoxes.size() - 1;
+}
+
+
+// check the segment a tool moved along against the objects its box overlaps
+unsigned int ch_collisionWorld::ch_checkCollisions(unsigned int tool, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, ch_queryMode mode)
+{
+	return ch_checkTool(tool, lastDevicePosition, currentDevicePosition, intersectionPoint, mode, NULL, NULL);
+}
+
+
+// check the segment a tool moved along within a budget of triangle tests
+unsigned int ch_collisionWorld::ch_checkCollisionsBudgeted(unsigned int tool, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, unsigned int triangleBudget, bool& complete, ch_queryMode mode)
+{
+	return ch_checkTool(tool, lastDevicePosition, currentDevicePosition, intersectionPoint, mode, &triangleBudget, &complete);
+}
+
+
+// query of both variants
+unsigned int ch_collisionWorld::ch_checkTool(unsigned int tool, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, ch_queryMode mode, unsigned int* triangleBudget, bool* complete)
+{
+	if (complete)
+		*complete = true;
+
+	// the objects touched last time come first for a budgeted query
+	candidates.clear();
+	if (triangleBudget)
+	{
+		for (unsigned int i = 0; i < contacts.ch_size(); i++)
+		{
+			unsigned int object = (unsigned int)contacts[i].mesh;
+			if (objects[object].checker && find(candidates.begin(), candidates.end(), object) == candidates.end())
+				candidates.push_back(object);
+		}
+	}
+	unsigned int numPrevious = (unsigned int)candidates.size();
+
+	contacts.ch_clear();
+
+	// a tool moves a little every tick, its endpoints swap with a few neighbours at most
+	ch_aabb box;
+	box.ch_extend(ch_toVec3(lastDevicePosition));
+	box.ch_extend(ch_toVec3(currentDevicePosition));
+	box.lo -= ch_vec3(CH_WORLD_MARGIN, CH_WORLD_MARGIN, CH_WORLD_MARGIN);
+	box.hi += ch_vec3(CH_WORLD_MARGIN, CH_WORLD_MARGIN, CH_WORLD_MARGIN);
+	sweepAndPrune.ch_updateBox(toolBoxes[tool], box);
+
+	const unsigned int *first, *last;
+	sweepAndPrune.ch_getOverlaps(toolBoxes[tool], first, last);
+	numCandidates = (unsigned int)(last - first);
+
+	if (triangleBudget)
+	{
+		// a previous contact the box no longer overlaps is out of reach
+		unsigned int kept = 0;
+		for (unsigned int i = 0; i < numPrevious; i++)
+		{
+			if (find(first, last, objects[candidates[i]].box) != last)
+				candidates[kept++] = candidates[i];
+		}
+		candidates.resize(kept);
+		numPrevious = kept;
+
+		for (const unsigned int* box = first; box != last; ++box)
+		{
+			if (find(candidates.begin(), candidates.begin() + numPrevious, boxObject[*box]) == candidates.begin() + numPrevious)
+				candidates.push_back(boxObject[*box]);
+		}
+	}
+	else
+	{
+		for (; first != last; ++first)
+			candidates.push_back(boxObject[*first]);
+	}
+
+	cVector3d point;
+	for (unsigned int c = 0; c < candidates.size(); c++)
+	{
+		unsigned int object = candidates[c];
+		ch_segmentTriangleCollisionChecker* checker = objects[object].checker;
+
+		unsigned int numHits;
+		if (!triangleBudget)
+			numHits = checker->ch_checkCollisions(lastDevicePosition, currentDevicePosition, point, mode);
+		else if (*triangleBudget > 0)
+		{
+			bool objectComplete;
+			numHits = checker->ch_checkCollisionsBudgeted(lastDevicePosition, currentDevicePosition, point, *triangleBudget, objectComplete, mode);
+			*complete = *complete && objectComplete;
+		}
+		else
+		{
+			// the objects left when the budget runs out are not checked at all
+			*complete = false;
+			continue;
+		}
+
+		if (numHits == 0)
+			continue;
+
+		if (find(queriedObjects.begin(), queriedObjects.end(), object) == queriedObjects.end())
+			queriedObjects.push_back(object);
+
+		const ch_contactManifold& objectContacts = checker->ch_getContacts();
+		unsigned int firstHit = objectContacts.ch_size() - numHits;
+		if (mode == CH_QUERY_NEAREST && !contacts.ch_isEmpty())
+		{
+			// keep the nearer of the two hits, in the world and in the checkers
+			if (objectContacts[firstHit].t >= contacts[0].t)
+			{
+				checker->ch_removeLastContact();
+				continue;
+			}
+			objects[contacts[0].mesh].checker->ch_removeLastContact();
+			contacts.ch_clear();
+		}
+
+		for (unsigned int i = firstHit; i < firstHit + numHits; i++)
+			contacts.ch_add(objectContacts[i]);
+
+		if (mode == CH_QUERY_ANY)
+			break;
+	}
+
+	if (contacts.ch_isEmpty())
+		return 0;
+
+	contacts.ch_sort();
+
+	intersectionPoint = ch_toCVector3d(contacts[0].point);
+	return contacts.ch_size();
+}
+
+
+// clear the contacts of every object queried
+void ch_collisionWorld::ch_clearContacts()
+{
+	for (unsigned int i = 0; i < queriedObjects.size(); i++)
+		objects[queriedObjects[i]].checker->ch_clearContacts();
+	queriedObjects.clear();
+}
@@ -0,0 +1,121 @@
+#ifndef CH_COLLISIONWORLD_H
+#define CH_COLLISIONWORLD_H
+
+// CH lab
+// scene of many objects, each with its own segment checker. the bounds of the objects and of the device
+// segment of every tool are kept in an incremental sweep and prune, so that a query only runs the
+// checkers of the few objects whose boxes the segment overlaps
+
+// system includes
+#include <vector>
+
+// CHAI3D includes
+#include "chai3d.h"
+
+// local includes
+#include "ch_segmentTriangleCollisionChecker.h"
+#include "ch_sweepAndPrune.h"
+
+using namespace chai3d;
+using namespace std;
+
+// the box of a device segment is grown by this much [m], so that a segment ending on a face of an
+// object box still overlaps it
+#define CH_WORLD_MARGIN 1.0e-6
+
+class ch_collisionWorld
+{
+public:
+
+	// the contacts are 32 byte aligned
+	CH_ALIGNED_OPERATOR_NEW
+
+	// constructor
+	ch_collisionWorld();
+
+	// destructor, the checkers belong to the caller
+	virtual ~ch_collisionWorld() {};
+
+	// register an object with its checker, returns the handle of the object, which becomes the mesh ID of
+	// its contacts
+	unsigned int ch_addObject(ch_segmentTriangleCollisionChecker* checker);
+
+	// unregister an object
+	void ch_removeObject(unsigned int object);
+
+	// read the bounds of an object again, after it moved or deformed
+	void ch_updateObject(unsigned int object);
+
+	// read the bounds of every deformable object again
+	void ch_updateDeformableObjects();
+
+	// add a tool, eg. one per haptic device, returns its handle
+	unsigned int ch_addTool();
+
+	// check the segment a tool moved along against the objects its box overlaps. the triangles hit are
+	// appended to the contacts of their checkers and listed as contacts of the world, intersectionPoint is
+	// set to the hit nearest to lastDevicePosition. in nearest mode only the nearest hit of all objects
+	// is kept. returns the number of contacts
+	unsigned int ch_checkCollisions(unsigned int tool, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, ch_queryMode mode = CH_QUERY_ALL);
+
+	// ch_checkCollisions() within a budget of triangle tests shared by the objects, those touched by the
+	// previous query first. complete is false if the budget ran out, the contacts found so far are kept
+	unsigned int ch_checkCollisionsBudgeted(unsigned int tool, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, unsigned int triangleBudget, bool& complete, ch_queryMode mode = CH_QUERY_ALL);
+
+	// contacts of the last query, in segment order, the mesh ID of a contact is its object handle
+	inline const ch_contactManifold& ch_getContacts() const { return contacts; }
+
+	// clear the contacts of every object queried since the last call
+	void ch_clearContacts();
+
+	// checker of an object
+	inline ch_segmentTriangleCollisionChecker* ch_getChecker(unsigned int object) const { return objects[object].checker; }
+
+	// number of objects registered
+	inline unsigned int ch_getNumObjects() const { return numObjects; }
+
+	// number of checkers run by the last query
+	inline unsigned int ch_getNumCandidates() const { return numCandidates; }
+
+	// the sweep and prune, eg. for its statistics
+	inline const ch_sweepAndPrune& ch_getSweepAndPrune() const { return sweepAndPrune; }
+
+protected:
+
+	// query of both variants, budgeted if triangleBudget is not NULL
+	unsigned int ch_checkTool(unsigned int tool, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, ch_queryMode mode, unsigned int* triangleBudget, bool* complete);
+
+	// registered object
+	struct ch_worldObject
+	{
+		ch_segmentTriangleCollisionChecker* checker;
+		unsigned int box;
+	};
+
+	// objects, NULL checkers for removed handles
+	vector<ch_worldObject> objects;
+	vector<unsigned int> freeObjects;
+	unsigned int numObjects;
+
+	// object handle of every sweep and prune box of an object
+	vector<unsigned int> boxObject;
+
+	// sweep and prune box of every tool
+	vector<unsigned int> toolBoxes;
+
+	// boxes of the objects and the tools
+	ch_sweepAndPrune sweepAndPrune;
+
+	// contacts of the last query
+	ch_contactManifold contacts;
+
+	// objects queried since the contacts were last cleared
+	vector<unsigned int> queriedObjects;
+
+	// objects a budgeted query runs, in order
+	vector<unsigned int> candidates;
+
+	unsigned int numCandidates;
+};
+
+#endif
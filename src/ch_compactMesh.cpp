@@ -0,0 +1,238 @@
+#include "ch_compactMesh.h"
+
+// system includes
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+
+// float not above a double
+static float ch_floatBelow(double value)
+{
+	float result = (float)value;
+	if ((double)result > value)
+		result = nextafterf(result, -FLT_MAX);
+	return result;
+}
+
+
+// float not below a double
+static float ch_floatAbove(double value)
+{
+	float result = (float)value;
+	if ((double)result < value)
+		result = nextafterf(result, FLT_MAX);
+	return result;
+}
+
+
+// coordinate in [-1, 1] to 16 bits and back
+static unsigned int ch_quantizeUnit(double value)
+{
+	double scaled = floor((value * 0.5 + 0.5) * CH_COMPACT_QUANTUM + 0.5);
+	return (unsigned int)min(max(scaled, 0.0), CH_COMPACT_QUANTUM);
+}
+
+static double ch_dequantizeUnit(unsigned int code)
+{
+	return code * (2.0 / CH_COMPACT_QUANTUM) - 1.0;
+}
+
+
+// constructor
+ch_compactMesh::ch_compactMesh()
+{
+	maxError = 0.0;
+}
+
+
+// encode the triangles and their tree
+void ch_compactMesh::ch_build(const ch_triangleArray& fullTriangles, const ch_aabbTree& tree)
+{
+	const vector<ch_aabbNode, ch_alignedAllocator<ch_aabbNode> >& treeNodes = tree.ch_getNodes();
+	const vector<unsigned int>& leafTriangles = tree.ch_getLeafTriangles();
+
+	nodes.resize(treeNodes.size());
+	triangles.clear();
+	triangles.reserve(leafTriangles.size());
+	vertices.clear();
+	maxError = 0.0;
+
+	for (unsigned int n = 0; n < treeNodes.size(); n++)
+	{
+		const ch_aabbNode& node = treeNodes[n];
+		ch_compactNode& compact = nodes[n];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			compact.lo[axis] = ch_floatBelow(node.bounds.lo[axis]);
+			compact.hi[axis] = ch_floatAbove(node.bounds.hi[axis]);
+		}
+		compact.count = node.count;
+		compact.firstVertex = 0;
+
+		if (node.count == 0)
+		{
+			compact.first = node.first;
+			continue;
+		}
+
+		compact.first = (unsigned int)triangles.size();
+		compact.firstVertex = (unsigned int)vertices.size() / 3;
+
+		// the decoded corners are relative to the float bounds, which hold the exact ones
+		ch_aabb box = ch_getBounds(compact);
+		ch_vec3 extent = box.ch_extent();
+
+		// corners shared by triangles of the leaf are stored once
+		ch_vec3 leafVertices[3 * CH_TREE_LEAF_SIZE];
+		unsigned int numLeafVertices = 0;
+
+		for (unsigned int k = 0; k < node.count; k++)
+		{
+			unsigned int index = leafTriangles[node.first + k];
+			const ch_triangle& triangle = fullTriangles[index];
+			const ch_vec3* corners[3] = { &triangle.v0, &triangle.v1, &triangle.v2 };
+
+			ch_compactTriangle packed;
+			packed.corners = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = 0;
+				while (v < numLeafVertices && !(leafVertices[v].x == corners[c]->x && leafVertices[v].y == corners[c]->y && leafVertices[v].z == corners[c]->z))
+					v++;
+
+				if (v == numLeafVertices)
+				{
+					leafVertices[numLeafVertices++] = *corners[c];
+
+					ch_vec3 decoded;
+					for (int axis = 0; axis < 3; axis++)
+					{
+						double scaled = 0.0;
+						if (extent[axis] > 0.0)
+							scaled = floor(((*corners[c])[axis] - box.lo[axis]) / extent[axis] * CH_COMPACT_QUANTUM + 0.5);
+						unsigned short code = (unsigned short)min(max(scaled, 0.0), CH_COMPACT_QUANTUM);
+						vertices.push_back(code);
+						decoded[axis] = box.lo[axis] + code * (extent[axis] / CH_COMPACT_QUANTUM);
+					}
+					maxError = max(maxError, ch_distance(decoded, *corners[c]));
+				}
+
+				packed.corners |= v << (c * CH_COMPACT_CORNER_BITS);
+			}
+
+			packed.normal = ch_encodeNormal(triangle.normal);
+			packed.index = index;
+			triangles.push_back(packed);
+		}
+	}
+}
+
+
+// start a traversal along the segment
+void ch_compactMesh::ch_beginWalk(const ch_vec3& start, const ch_vec3& direction, ch_compactWalk& walk) const
+{
+	walk.start = start;
+	walk.direction = direction;
+	walk.top = 0;
+
+	if (!nodes.empty())
+		walk.stack[walk.top++] = 0;
+}
+
+
+// next leaf whose bounds the segment touches
+int ch_compactMesh::ch_nextLeaf(ch_compactWalk& walk, double tMax) const
+{
+	while (walk.top > 0)
+	{
+		unsigned int index = walk.stack[--walk.top];
+		const ch_compactNode& node = nodes[index];
+
+		double t0 = 0.0, t1 = tMax;
+		if (!ch_clipSegmentToBox(ch_getBounds(node), walk.start, walk.direction, t0, t1))
+			continue;
+
+		if (node.count > 0)
+			return (int)index;
+
+		// push the farther child first, so that the nearer one is visited next
+		double near0 = ch_dot(ch_getBounds(nodes[node.first]).ch_center() - walk.start, walk.direction);
+		double near1 = ch_dot(ch_getBounds(nodes[node.first + 1]).ch_center() - walk.start, walk.direction);
+		unsigned int nearChild = (near0 <= near1) ? node.first : node.first + 1;
+
+		walk.stack[walk.top++] = (nearChild == node.first) ? node.first + 1 : node.first;
+		walk.stack[walk.top++] = nearChild;
+	}
+	return -1;
+}
+
+
+// decode the triangles of a leaf
+unsigned int ch_compactMesh::ch_decodeLeaf(int leaf, ch_triangle* decoded, unsigned int* indices) const
+{
+	const ch_compactNode& node = nodes[leaf];
+	ch_aabb box = ch_getBounds(node);
+	ch_vec3 step = box.ch_extent() * (1.0 / CH_COMPACT_QUANTUM);
+
+	const unsigned int mask = (1u << CH_COMPACT_CORNER_BITS) - 1;
+	const unsigned short* leafVertices = &vertices[3 * node.firstVertex];
+
+	for (unsigned int k = 0; k < node.count; k++)
+	{
+		const ch_compactTriangle& packed = triangles[node.first + k];
+		ch_vec3* corners[3] = { &decoded[k].v0, &decoded[k].v1, &decoded[k].v2 };
+
+		for (int c = 0; c < 3; c++)
+		{
+			const unsigned short* code = leafVertices + 3 * ((packed.corners >> (c * CH_COMPACT_CORNER_BITS)) & mask);
+			*corners[c] = ch_vec3(box.lo.x + code[0] * step.x, box.lo.y + code[1] * step.y, box.lo.z + code[2] * step.z);
+		}
+
+		decoded[k].normal = ch_decodeNormal(packed.normal);
+		decoded[k].normal.w = ch_dot(decoded[k].normal, decoded[k].v0);
+		indices[k] = packed.index;
+	}
+	return node.count;
+}
+
+
+// bytes used by the compact copy
+unsigned int ch_compactMesh::ch_getMemoryUsage() const
+{
+	return (unsigned int)(nodes.size() * sizeof(ch_compactNode) + triangles.size() * sizeof(ch_compactTriangle) + vertices.size() * sizeof(unsigned short));
+}
+
+
+// octahedral encoding of a unit normal
+unsigned int ch_compactMesh::ch_encodeNormal(const ch_vec3& normal)
+{
+	// project on the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper one
+	double sum = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+	double u = (sum > 0.0) ? normal.x / sum : 0.0;
+	double v = (sum > 0.0) ? normal.y / sum : 0.0;
+	if (normal.z < 0.0)
+	{
+		double foldedU = (1.0 - fabs(v)) * (u >= 0.0 ? 1.0 : -1.0);
+		double foldedV = (1.0 - fabs(u)) * (v >= 0.0 ? 1.0 : -1.0);
+		u = foldedU;
+		v = foldedV;
+	}
+	return ch_quantizeUnit(u) | (ch_quantizeUnit(v) << 16);
+}
+
+
+// unit normal of an octahedral code
+ch_vec3 ch_compactMesh::ch_decodeNormal(unsigned int code)
+{
+	double u = ch_dequantizeUnit(code & 0xffff);
+	double v = ch_dequantizeUnit(code >> 16);
+	ch_vec3 normal(u, v, 1.0 - fabs(u) - fabs(v));
+	if (normal.z < 0.0)
+	{
+		normal.x = (1.0 - fabs(v)) * (u >= 0.0 ? 1.0 : -1.0);
+		normal.y = (1.0 - fabs(u)) * (v >= 0.0 ? 1.0 : -1.0);
+	}
+	return ch_normalize(normal);
+}
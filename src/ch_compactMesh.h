@@ -0,0 +1,122 @@
+#ifndef CH_COMPACTMESH_H
+#define CH_COMPACTMESH_H
+
+// CH lab
+// compact copy of the triangles and their AABB tree for targets with small caches: float node bounds,
+// vertices quantized to 16 bits within the bounds of their leaf, octahedral 2x16 bit normals and the
+// three corners of a triangle packed into 32 bits. a query decodes the leaves it visits on the fly; the
+// decoded geometry is within a quantization step (leaf size / 65535) of the exact one. no CHAI3D dependency
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_aabbTree.h"
+#include "ch_geometry.h"
+
+using namespace std;
+
+// bits of a leaf vertex index, three of them fill a packed corner word
+#define CH_COMPACT_CORNER_BITS 10
+
+// largest quantized coordinate
+#define CH_COMPACT_QUANTUM 65535.0
+
+
+// node of the compact tree, same topology as the ch_aabbTree it was built from
+struct ch_compactNode
+{
+	// bounds, rounded outwards
+	float lo[3];
+	float hi[3];
+
+	// inner node: index of the first child; leaf: first compact triangle
+	unsigned int first;
+
+	// number of triangles for a leaf, 0 for an inner node
+	unsigned int count;
+
+	// leaf: first quantized vertex
+	unsigned int firstVertex;
+};
+
+
+// triangle of a leaf
+struct ch_compactTriangle
+{
+	unsigned int corners;	// leaf vertex indices, CH_COMPACT_CORNER_BITS each
+	unsigned int normal;	// octahedral normal, two 16 bit coordinates
+	unsigned int index;		// index of the triangle in the full geometry
+};
+
+
+// state of a segment traversal of the compact tree
+struct CH_ALIGN(32) ch_compactWalk
+{
+	ch_vec3 start;
+	ch_vec3 direction;
+
+	// nodes still to visit
+	unsigned int stack[CH_TREE_STACK_SIZE];
+	int top;
+};
+
+
+class ch_compactMesh
+{
+public:
+
+	// constructor
+	ch_compactMesh();
+
+	// destructor
+	virtual ~ch_compactMesh() {};
+
+	// encode world space triangles and the tree built over them
+	void ch_build(const ch_triangleArray& triangles, const ch_aabbTree& tree);
+
+	// has the compact copy been built?
+	inline bool ch_isBuilt() const { return !nodes.empty(); }
+
+	// start a traversal along the segment start + t direction
+	void ch_beginWalk(const ch_vec3& start, const ch_vec3& direction, ch_compactWalk& walk) const;
+
+	// next leaf whose bounds the segment touches for t in [0, tMax], nearer child first. returns its node
+	// index, -1 when the walk is done. tMax may shrink between calls
+	int ch_nextLeaf(ch_compactWalk& walk, double tMax) const;
+
+	// decode the triangles of a leaf, at most CH_TREE_LEAF_SIZE, with their full geometry indices. returns
+	// how many were decoded
+	unsigned int ch_decodeLeaf(int leaf, ch_triangle* decoded, unsigned int* indices) const;
+
+	// bytes used by the compact copy
+	unsigned int ch_getMemoryUsage() const;
+
+	// largest distance between a vertex and its decoded position after the build
+	inline double ch_getMaxError() const { return maxError; }
+
+	// octahedral encoding of a unit normal and back
+	static unsigned int ch_encodeNormal(const ch_vec3& normal);
+	static ch_vec3 ch_decodeNormal(unsigned int code);
+
+protected:
+
+	// bounds of a node as a box
+	inline ch_aabb ch_getBounds(const ch_compactNode& node) const
+	{
+		ch_aabb box;
+		box.lo = ch_vec3(node.lo[0], node.lo[1], node.lo[2]);
+		box.hi = ch_vec3(node.hi[0], node.hi[1], node.hi[2]);
+		return box;
+	}
+
+	vector<ch_compactNode> nodes;
+	vector<ch_compactTriangle> triangles;
+
+	// quantized leaf vertices, x y z per vertex
+	vector<unsigned short> vertices;
+
+	double maxError;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef CH_CONTACTMANIFOLD_H
+#define CH_CONTACTMANIFOLD_H
+
+// CH lab
+// contacts of the collision queries in a preallocated array of fixed capacity. every contact carries what
+// the GO solver and the highlighting need, so that nobody goes back to the triangles of the query; the
+// manifold holds no pointers and can be copied as a whole, eg. into a buffer read by another thread
+
+// local includes
+#include "ch_math.h"
+
+using namespace std;
+
+// largest number of contacts, the farthest ones are dropped beyond it
+#define CH_MANIFOLD_CAPACITY 64
+
+
+// triangle hit by a segment
+struct CH_ALIGN(32) ch_contact
+{
+	ch_vec3 point;			// where the segment enters the triangle
+	ch_vec3 plane;			// plane of the triangle, normal and w = d as in ch_triangle
+	ch_vec3 barycentric;	// weights of v0, v1 and v2 at the point
+	double t;				// segment parameter of the hit
+	int triangle;			// index of the triangle in its checker
+	int mesh;				// mesh the triangle belongs to, the object handle in a ch_collisionWorld
+	int face;				// convex face of the entry, -1 if the object has no faces
+};
+
+
+class ch_contactManifold
+{
+public:
+
+	// the contacts are 32 byte aligned
+	CH_ALIGNED_OPERATOR_NEW
+
+	// constructor
+	ch_contactManifold() : size(0), numDropped(0) {}
+
+	// destructor
+	virtual ~ch_contactManifold() {}
+
+	// number of contacts
+	inline unsigned int ch_size() const { return size; }
+	inline bool ch_isEmpty() const { return size == 0; }
+
+	// contact i
+	inline const ch_contact& operator[](unsigned int i) const { return contacts[i]; }
+	inline ch_contact& operator[](unsigned int i) { return contacts[i]; }
+
+	// append a contact. a full manifold gives the farthest of contacts [first, size) up for a nearer one;
+	// returns false if the contact was dropped
+	inline bool ch_add(const ch_contact& contact, unsigned int first = 0)
+	{
+		if (size < CH_MANIFOLD_CAPACITY)
+		{
+			contacts[size++] = contact;
+			return true;
+		}
+
+		numDropped++;
+		unsigned int farthest = first;
+		for (unsigned int i = first + 1; i < size; i++)
+		{
+			if (contacts[i].t > contacts[farthest].t)
+				farthest = i;
+		}
+
+		if (farthest >= size || contacts[farthest].t <= contact.t)
+			return false;
+		contacts[farthest] = contact;
+		return true;
+	}
+
+	// forget the last contact
+	inline void ch_removeLast() { size--; }
+
+	// forget every contact
+	inline void ch_clear() { size = 0; numDropped = 0; }
+
+	// contacts dropped because the manifold was full, since the last ch_clear()
+	inline unsigned int ch_getNumDropped() const { return numDropped; }
+
+	// order contacts [first, size) along the segment, then by mesh. there are rarely more than a few
+	inline void ch_sort(unsigned int first = 0)
+	{
+		for (unsigned int i = first + 1; i < size; i++)
+		{
+			ch_contact contact = contacts[i];
+			unsigned int j = i;
+			for (; j > first && (contacts[j - 1].t > contact.t || (contacts[j - 1].t == contact.t && contacts[j - 1].mesh > contact.mesh)); j--)
+				contacts[j] = contacts[j - 1];
+			contacts[j] = contact;
+		}
+	}
+
+protected:
+
+	ch_contact contacts[CH_MANIFOLD_CAPACITY];
+	unsigned int size;
+	unsigned int numDropped;
+};
+
+#endif
@@ -0,0 +1,541 @@
+#include "ch_convexCollider.h"
+
+// system includes
+#include <algorithm>
+#include <math.h>
+
+
+// corner of a triangle in its weld cell
+struct ch_convexCorner
+{
+	long long cell[3];
+	unsigned int corner;
+
+	bool operator<(const ch_convexCorner& other) const
+	{
+		if (cell[0] != other.cell[0]) return cell[0] < other.cell[0];
+		if (cell[1] != other.cell[1]) return cell[1] < other.cell[1];
+		return cell[2] < other.cell[2];
+	}
+};
+
+
+// edge of a triangle between two welded vertices, lower index first
+struct ch_convexEdge
+{
+	unsigned int a, b;
+	unsigned int triangle;
+
+	bool operator<(const ch_convexEdge& other) const { return (a != other.a) ? (a < other.a) : (b < other.b); }
+};
+
+
+// welded vertex on an edge between two faces, lower face first
+struct ch_convexBoundaryVertex
+{
+	unsigned int f, g;
+	unsigned int vertex;
+
+	bool operator<(const ch_convexBoundaryVertex& other) const { return (f != other.f) ? (f < other.f) : (g < other.g); }
+};
+
+
+// constructor
+ch_convexCollider::ch_convexCollider()
+{
+}
+
+
+// forget the object
+void ch_convexCollider::ch_clear()
+{
+	planes.clear();
+	faceTriangleStart.clear();
+	faceTriangles.clear();
+	faceNeighbourStart.clear();
+	faceNeighbours.clear();
+	faceVertexStart.clear();
+	faceVertices.clear();
+	vertices.clear();
+	edges.clear();
+	faceEdgeStart.clear();
+	faceEdges.clear();
+	vertexEdgeStart.clear();
+	vertexEdges.clear();
+	faceAxes.clear();
+	faceGrids.clear();
+	cellStart.clear();
+	cellTriangles.clear();
+	bounds = ch_aabb();
+}
+
+
+// merge the triangles into faces
+bool ch_convexCollider::ch_build(const ch_triangleArray& triangles)
+{
+	unsigned int numTriangles = (unsigned int)triangles.size();
+
+	ch_clear();
+	if (numTriangles < 4)
+		return false;
+
+	ch_aabb box;
+	for (unsigned int i = 0; i < numTriangles; i++)
+		box.ch_extend(ch_triangleBounds(triangles[i]));
+	double tolerance = CH_CONVEX_TOLERANCE * ch_length(box.ch_extent());
+
+	// weld the corners: meshes repeat vertices per triangle, the edges have to be found between positions
+	vector<ch_convexCorner> corners(3 * numTriangles);
+	for (unsigned int i = 0; i < 3 * numTriangles; i++)
+	{
+		const ch_triangle& triangle = triangles[i / 3];
+		const ch_vec3& p = (i % 3 == 0) ? triangle.v0 : ((i % 3 == 1) ? triangle.v1 : triangle.v2);
+		for (int axis = 0; axis < 3; axis++)
+			corners[i].cell[axis] = (long long)floor(p[axis] / tolerance + 0.5);
+		corners[i].corner = i;
+	}
+	sort(corners.begin(), corners.end());
+
+	vector<unsigned int> cornerVertex(3 * numTriangles);
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > positions;
+	for (unsigned int i = 0; i < corners.size(); i++)
+	{
+		if (i == 0 || corners[i - 1] < corners[i])
+		{
+			const ch_triangle& triangle = triangles[corners[i].corner / 3];
+			unsigned int k = corners[i].corner % 3;
+			positions.push_back(k == 0 ? triangle.v0 : (k == 1 ? triangle.v1 : triangle.v2));
+		}
+		cornerVertex[corners[i].corner] = (unsigned int)positions.size() - 1;
+	}
+
+	// coplanar triangles form one face. the face plane is the area weighted mean of its triangles
+	vector<int> triangleFace(numTriangles, -1);
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > faceNormal;
+	vector<double> faceArea;
+	vector<ch_convexEdge> triangleEdges;
+	triangleEdges.reserve(3 * numTriangles);
+	for (unsigned int i = 0; i < numTriangles; i++)
+	{
+		const unsigned int* corner = &cornerVertex[3 * i];
+		if (corner[0] == corner[1] || corner[1] == corner[2] || corner[2] == corner[0])
+			continue;
+
+		const ch_triangle& triangle = triangles[i];
+		double area = 0.5 * ch_length(ch_cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0));
+		if (area < tolerance * tolerance)
+			continue;
+
+		unsigned int f = 0;
+		for (; f < planes.size(); f++)
+		{
+			if (1.0 - ch_dot(triangle.normal, planes[f]) < CH_CONVEX_COPLANAR && fabs(triangle.normal.w - planes[f].w) < tolerance)
+				break;
+		}
+		if (f == planes.size())
+		{
+			if (planes.size() == CH_CONVEX_MAX_FACES)
+			{
+				ch_clear();
+				return false;
+			}
+			planes.push_back(triangle.normal);
+			faceNormal.push_back(ch_vec3());
+			faceArea.push_back(0.0);
+		}
+		triangleFace[i] = (int)f;
+		faceNormal[f] += triangle.normal * area;
+		faceArea[f] += area;
+
+		for (int k = 0; k < 3; k++)
+		{
+			ch_convexEdge edge;
+			edge.a = min(corner[k], corner[(k + 1) % 3]);
+			edge.b = max(corner[k], corner[(k + 1) % 3]);
+			edge.triangle = i;
+			triangleEdges.push_back(edge);
+		}
+	}
+
+	unsigned int numFaces = (unsigned int)planes.size();
+	if (numFaces < 4)
+	{
+		ch_clear();
+		return false;
+	}
+
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		planes[f] = ch_normalize(faceNormal[f]);
+		planes[f].w = 0.0;
+	}
+	for (unsigned int i = 0; i < numTriangles; i++)
+	{
+		if (triangleFace[i] >= 0)
+		{
+			const ch_triangle& triangle = triangles[i];
+			double area = 0.5 * ch_length(ch_cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0));
+			planes[triangleFace[i]].w += area * ch_dot(planes[triangleFace[i]], (triangle.v0 + triangle.v1 + triangle.v2) * (1.0 / 3.0)) / faceArea[triangleFace[i]];
+		}
+	}
+
+	// a closed surface has every edge between exactly two triangles; edges between two faces link them
+	sort(triangleEdges.begin(), triangleEdges.end());
+	vector<pair<unsigned int, unsigned int> > links;
+	vector<ch_convexBoundaryVertex> boundaryVertices;
+	vector<unsigned char> onBoundary(positions.size(), 0);
+	for (unsigned int i = 0; i < triangleEdges.size(); i += 2)
+	{
+		if (i + 1 == triangleEdges.size() || triangleEdges[i] < triangleEdges[i + 1] || (i + 2 < triangleEdges.size() && !(triangleEdges[i + 1] < triangleEdges[i + 2])))
+		{
+			ch_clear();
+			return false;
+		}
+
+		unsigned int f = triangleFace[triangleEdges[i].triangle], g = triangleFace[triangleEdges[i + 1].triangle];
+		if (f != g)
+		{
+			links.push_back(make_pair(f, g));
+			links.push_back(make_pair(g, f));
+			onBoundary[triangleEdges[i].a] = onBoundary[triangleEdges[i].b] = 1;
+
+			ch_convexBoundaryVertex boundary;
+			boundary.f = min(f, g);
+			boundary.g = max(f, g);
+			boundary.vertex = triangleEdges[i].a;
+			boundaryVertices.push_back(boundary);
+			boundary.vertex = triangleEdges[i].b;
+			boundaryVertices.push_back(boundary);
+		}
+	}
+
+	// convex: no vertex lies in front of any face
+	for (unsigned int v = 0; v < positions.size(); v++)
+	{
+		for (unsigned int f = 0; f < numFaces; f++)
+		{
+			if (ch_dot(planes[f], positions[v]) - planes[f].w > tolerance)
+			{
+				ch_clear();
+				return false;
+			}
+		}
+	}
+
+	// triangles of every face
+	faceTriangleStart.assign(numFaces + 1, 0);
+	for (unsigned int i = 0; i < numTriangles; i++)
+		if (triangleFace[i] >= 0)
+			faceTriangleStart[triangleFace[i] + 1]++;
+	for (unsigned int f = 0; f < numFaces; f++)
+		faceTriangleStart[f + 1] += faceTriangleStart[f];
+	faceTriangles.resize(faceTriangleStart[numFaces]);
+	vector<unsigned int> fill(faceTriangleStart.begin(), faceTriangleStart.end() - 1);
+	for (unsigned int i = 0; i < numTriangles; i++)
+		if (triangleFace[i] >= 0)
+			faceTriangles[fill[triangleFace[i]]++] = i;
+
+	// neighbours of every face, once each
+	sort(links.begin(), links.end());
+	links.erase(unique(links.begin(), links.end()), links.end());
+	faceNeighbourStart.assign(numFaces + 1, 0);
+	for (unsigned int i = 0; i < links.size(); i++)
+	{
+		faceNeighbourStart[links[i].first + 1]++;
+		faceNeighbours.push_back(links[i].second);
+	}
+	for (unsigned int f = 0; f < numFaces; f++)
+		faceNeighbourStart[f + 1] += faceNeighbourStart[f];
+
+	// boundary vertices of every face: the corners of its triangles on edges to other faces
+	vector<unsigned int> vertexIndex(positions.size(), (unsigned int)-1);
+	faceVertexStart.assign(1, 0);
+	vector<unsigned int> faceCorners;
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		faceCorners.clear();
+		for (unsigned int j = faceTriangleStart[f]; j < faceTriangleStart[f + 1]; j++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int v = cornerVertex[3 * faceTriangles[j] + k];
+				if (onBoundary[v])
+					faceCorners.push_back(v);
+			}
+		}
+		sort(faceCorners.begin(), faceCorners.end());
+		faceCorners.erase(unique(faceCorners.begin(), faceCorners.end()), faceCorners.end());
+
+		for (unsigned int j = 0; j < faceCorners.size(); j++)
+		{
+			unsigned int v = faceCorners[j];
+			if (vertexIndex[v] == (unsigned int)-1)
+			{
+				vertexIndex[v] = (unsigned int)vertices.size();
+				vertices.push_back(positions[v]);
+			}
+			faceVertices.push_back(vertexIndex[v]);
+		}
+		faceVertexStart.push_back((unsigned int)faceVertices.size());
+	}
+
+	// edges of the polytope: the triangle edges between the same two faces lie on one line, the polytope
+	// edge runs between the outermost of their vertices
+	sort(boundaryVertices.begin(), boundaryVertices.end());
+	for (unsigned int i = 0; i < boundaryVertices.size();)
+	{
+		unsigned int f = boundaryVertices[i].f, g = boundaryVertices[i].g;
+		ch_vec3 direction = ch_cross(planes[f], planes[g]);
+		unsigned int lo = boundaryVertices[i].vertex, hi = lo;
+		double tLo = 1e300, tHi = -1e300;
+		for (; i < boundaryVertices.size() && boundaryVertices[i].f == f && boundaryVertices[i].g == g; i++)
+		{
+			double t = ch_dot(direction, positions[boundaryVertices[i].vertex]);
+			if (t < tLo) { tLo = t; lo = boundaryVertices[i].vertex; }
+			if (t > tHi) { tHi = t; hi = boundaryVertices[i].vertex; }
+		}
+
+		ch_convexFeatureEdge edge;
+		edge.vertex[0] = vertexIndex[lo];
+		edge.vertex[1] = vertexIndex[hi];
+		edge.face[0] = f;
+		edge.face[1] = g;
+
+		// across the edge, away from the other face
+		ch_vec3 along = ch_normalize(vertices[edge.vertex[1]] - vertices[edge.vertex[0]]);
+		for (int k = 0; k < 2; k++)
+		{
+			const ch_vec3& other = planes[edge.face[1 - k]];
+			edge.inward[k] = ch_normalize(ch_cross(planes[edge.face[k]], along));
+			if (ch_dot(edge.inward[k], other) > 0.0)
+				edge.inward[k] = -edge.inward[k];
+		}
+		edges.push_back(edge);
+	}
+
+	// edges of every face and of every vertex
+	faceEdgeStart.assign(numFaces + 1, 0);
+	vertexEdgeStart.assign(vertices.size() + 1, 0);
+	for (unsigned int e = 0; e < edges.size(); e++)
+	{
+		faceEdgeStart[edges[e].face[0] + 1]++;
+		faceEdgeStart[edges[e].face[1] + 1]++;
+		vertexEdgeStart[edges[e].vertex[0] + 1]++;
+		vertexEdgeStart[edges[e].vertex[1] + 1]++;
+	}
+	for (unsigned int f = 0; f < numFaces; f++)
+		faceEdgeStart[f + 1] += faceEdgeStart[f];
+	for (unsigned int v = 0; v < vertices.size(); v++)
+		vertexEdgeStart[v + 1] += vertexEdgeStart[v];
+	faceEdges.resize(faceEdgeStart[numFaces]);
+	vertexEdges.resize(vertexEdgeStart[vertices.size()]);
+	vector<unsigned int> faceFill(faceEdgeStart.begin(), faceEdgeStart.end() - 1);
+	vector<unsigned int> vertexFill(vertexEdgeStart.begin(), vertexEdgeStart.end() - 1);
+	for (unsigned int e = 0; e < edges.size(); e++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			faceEdges[faceFill[edges[e].face[k]]++] = e;
+			vertexEdges[vertexFill[edges[e].vertex[k]]++] = e;
+		}
+	}
+
+	ch_buildFaceGrids(triangles);
+
+	bounds = box;
+	return true;
+}
+
+
+// grid the triangles of the faces that have many
+void ch_convexCollider::ch_buildFaceGrids(const ch_triangleArray& triangles)
+{
+	unsigned int numFaces = (unsigned int)planes.size();
+
+	faceAxes.resize(2 * numFaces);
+	faceGrids.resize(numFaces);
+	cellStart.assign(1, 0);
+
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		ch_faceGrid& grid = faceGrids[f];
+		unsigned int count = faceTriangleStart[f + 1] - faceTriangleStart[f];
+
+		// any two axes orthogonal to the normal
+		const ch_vec3& n = planes[f];
+		ch_vec3 u = (fabs(n.x) < 0.9) ? ch_vec3(1.0, 0.0, 0.0) : ch_vec3(0.0, 1.0, 0.0);
+		u = ch_normalize(u - n * ch_dot(n, u));
+		ch_vec3 v = ch_cross(n, u);
+		faceAxes[2 * f] = u;
+		faceAxes[2 * f + 1] = v;
+
+		grid.firstCell = (unsigned int)cellStart.size() - 1;
+		grid.resolution = 0;
+		if (count <= CH_CONVEX_FACE_SCAN)
+			continue;
+
+		// about one triangle per cell
+		double uMin = 1e300, uMax = -1e300, vMin = 1e300, vMax = -1e300;
+		for (unsigned int j = faceTriangleStart[f]; j < faceTriangleStart[f + 1]; j++)
+		{
+			const ch_triangle& triangle = triangles[faceTriangles[j]];
+			const ch_vec3* corner[3] = { &triangle.v0, &triangle.v1, &triangle.v2 };
+			for (int k = 0; k < 3; k++)
+			{
+				double pu = ch_dot(u, *corner[k]), pv = ch_dot(v, *corner[k]);
+				uMin = min(uMin, pu); uMax = max(uMax, pu);
+				vMin = min(vMin, pv); vMax = max(vMax, pv);
+			}
+		}
+		grid.resolution = (unsigned int)ceil(sqrt((double)count));
+		grid.u0 = uMin;
+		grid.v0 = vMin;
+		grid.inverseCellSize = grid.resolution / max(max(uMax - uMin, vMax - vMin), SMALL_NUM);
+
+		// count, then fill the cells every triangle's box overlaps
+		unsigned int numCells = grid.resolution * grid.resolution;
+		vector<unsigned int> cellCount(numCells + 1, 0);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (unsigned int j = faceTriangleStart[f]; j < faceTriangleStart[f + 1]; j++)
+			{
+				const ch_triangle& triangle = triangles[faceTriangles[j]];
+				const ch_vec3* corner[3] = { &triangle.v0, &triangle.v1, &triangle.v2 };
+				int lo[2] = { (int)grid.resolution, (int)grid.resolution }, hi[2] = { -1, -1 };
+				for (int k = 0; k < 3; k++)
+				{
+					int cu = min((int)grid.resolution - 1, max(0, (int)((ch_dot(u, *corner[k]) - grid.u0) * grid.inverseCellSize)));
+					int cv = min((int)grid.resolution - 1, max(0, (int)((ch_dot(v, *corner[k]) - grid.v0) * grid.inverseCellSize)));
+					lo[0] = min(lo[0], cu); hi[0] = max(hi[0], cu);
+					lo[1] = min(lo[1], cv); hi[1] = max(hi[1], cv);
+				}
+				for (int cv = lo[1]; cv <= hi[1]; cv++)
+				{
+					for (int cu = lo[0]; cu <= hi[0]; cu++)
+					{
+						unsigned int cell = cv * grid.resolution + cu;
+						if (pass == 0)
+							cellCount[cell + 1]++;
+						else
+							cellTriangles[cellCount[cell]++] = faceTriangles[j];
+					}
+				}
+			}
+
+			if (pass == 0)
+			{
+				for (unsigned int c = 0; c < numCells; c++)
+					cellCount[c + 1] += cellCount[c];
+				unsigned int offset = (unsigned int)cellTriangles.size();
+				cellTriangles.resize(offset + cellCount[numCells]);
+				for (unsigned int c = 0; c < numCells; c++)
+				{
+					cellCount[c] += offset;
+					cellStart.push_back(offset + cellCount[c + 1]);
+				}
+			}
+		}
+	}
+}
+
+
+// intersect a segment with the object (Cyrus-Beck clipping against the face planes)
+bool ch_convexCollider::ch_intersectSegment(const ch_vec3& start, const ch_vec3& direction, double& t, unsigned int& face, double tMax) const
+{
+	double tEnter = -1e300, tExit = 1e300;
+	int enterFace = -1;
+	unsigned int numFaces = (unsigned int)planes.size();
+
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		const ch_vec3& plane = planes[f];
+		double distance = plane.w - ch_dot(plane, start);
+		double denominator = ch_dot(plane, direction);
+
+		if (denominator <= -SMALL_NUM)
+		{
+			// entering the half-space, the same threshold as for the triangles
+			double tFace = distance / denominator;
+			if (tFace > tEnter)
+			{
+				tEnter = tFace;
+				enterFace = (int)f;
+				if (tEnter > tMax)
+					return false;
+			}
+		}
+		else if (denominator >= SMALL_NUM)
+		{
+			// leaving the half-space
+			double tFace = distance / denominator;
+			if (tFace < tExit)
+			{
+				tExit = tFace;
+				if (tExit < 0.0)
+					return false;
+			}
+		}
+		else if (distance < 0.0)
+		{
+			// parallel to the face, in front of it
+			return false;
+		}
+	}
+
+	// a segment starting inside enters before 0, one passing by leaves a face before entering the others
+	if (enterFace < 0 || tEnter < 0.0 || tEnter > tExit)
+		return false;
+
+	t = tEnter;
+	face = (unsigned int)enterFace;
+	return true;
+}
+
+
+// signed distance to the nearest face plane
+double ch_convexCollider::ch_signedDistance(const ch_vec3& point, unsigned int& face) const
+{
+	double distance = -1e300;
+	unsigned int numFaces = (unsigned int)planes.size();
+
+	face = 0;
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		double d = ch_dot(planes[f], point) - planes[f].w;
+		if (d > distance)
+		{
+			distance = d;
+			face = f;
+		}
+	}
+	return distance;
+}
+
+
+// triangle of a face that contains a point
+unsigned int ch_convexCollider::ch_findTriangle(unsigned int face, const ch_vec3& point, const ch_triangleArray& triangles) const
+{
+	const ch_faceGrid& grid = faceGrids[face];
+	if (grid.resolution)
+	{
+		int cu = min((int)grid.resolution - 1, max(0, (int)((ch_dot(faceAxes[2 * face], point) - grid.u0) * grid.inverseCellSize)));
+		int cv = min((int)grid.resolution - 1, max(0, (int)((ch_dot(faceAxes[2 * face + 1], point) - grid.v0) * grid.inverseCellSize)));
+		unsigned int cell = grid.firstCell + cv * grid.resolution + cu;
+
+		for (unsigned int j = cellStart[cell]; j < cellStart[cell + 1]; j++)
+		{
+			const ch_triangle& triangle = triangles[cellTriangles[j]];
+			if (ch_pointInTriangle(point, triangle.v0, triangle.v1, triangle.v2))
+				return cellTriangles[j];
+		}
+	}
+
+	// small faces, or a point the rounding put outside its cell's triangles
+	for (unsigned int j = faceTriangleStart[face]; j < faceTriangleStart[face + 1]; j++)
+	{
+		const ch_triangle& triangle = triangles[faceTriangles[j]];
+		if (ch_pointInTriangle(point, triangle.v0, triangle.v1, triangle.v2))
+			return faceTriangles[j];
+	}
+	return faceTriangles[faceTriangleStart[face]];
+}
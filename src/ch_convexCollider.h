@@ -0,0 +1,168 @@
+#ifndef CH_CONVEXCOLLIDER_H
+#define CH_CONVEXCOLLIDER_H
+
+// CH lab
+// convex object as the intersection of the half-spaces behind its faces. coplanar triangles are merged
+// into one face, so a box has six planes however finely it is tessellated, and a segment or point query
+// costs one plane test per face instead of one triangle test per triangle. the faces keep their
+// neighbours, their corner vertices and the edges of the polytope, eg. for feature tracking. no CHAI3D
+// dependency
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_geometry.h"
+
+using namespace std;
+
+// objects with more faces are not worth it, the tree is as fast
+#define CH_CONVEX_MAX_FACES 256
+
+// triangles whose unit normals differ by less than this (1 - cosine) belong to the same face
+#define CH_CONVEX_COPLANAR 1.0e-6
+
+// faces with more triangles get a grid in their plane to find the triangle under a point
+#define CH_CONVEX_FACE_SCAN 8
+
+// distance tolerance relative to the object size, for merging faces, welding vertices and the convexity test
+#define CH_CONVEX_TOLERANCE 1.0e-6
+
+
+// edge of the polytope between two faces. however finely the faces are tessellated, a box has twelve
+struct CH_ALIGN(32) ch_convexFeatureEdge
+{
+	ch_vec3 inward[2];			// unit vectors in the planes of the two faces, across the edge into them
+	unsigned int vertex[2];		// end vertices
+	unsigned int face[2];		// the faces it separates
+};
+
+
+class ch_convexCollider
+{
+public:
+
+	// constructor
+	ch_convexCollider();
+
+	// destructor
+	virtual ~ch_convexCollider() {};
+
+	// merge the triangles into faces. returns false, and stays empty, unless they form a closed convex
+	// surface with at most CH_CONVEX_MAX_FACES faces
+	bool ch_build(const ch_triangleArray& triangles);
+
+	// has a convex object been built?
+	inline bool ch_isBuilt() const { return !planes.empty(); }
+
+	// intersect the segment start + t direction, t in [0, tMax], with the object. only segments entering it
+	// from outside count, as for the triangles. returns the parameter and the face of the entry point
+	bool ch_intersectSegment(const ch_vec3& start, const ch_vec3& direction, double& t, unsigned int& face, double tMax = 1.0) const;
+
+	// signed distance of a point to the nearest face plane, negative inside. inside the object, the point
+	// minus the face normal times the distance is the closest surface point
+	double ch_signedDistance(const ch_vec3& point, unsigned int& face) const;
+
+	// triangle of a face that contains a point of its plane, the first one of the face if none does
+	unsigned int ch_findTriangle(unsigned int face, const ch_vec3& point, const ch_triangleArray& triangles) const;
+
+	// faces, with the plane n.x = d in normal.w as for the triangles
+	inline unsigned int ch_getNumFaces() const { return (unsigned int)planes.size(); }
+	inline const ch_vec3& ch_getPlane(unsigned int face) const { return planes[face]; }
+
+	// triangles [first, last) merged into a face
+	inline void ch_getFaceTriangles(unsigned int face, const unsigned int*& first, const unsigned int*& last) const
+	{
+		first = &faceTriangles[0] + faceTriangleStart[face];
+		last = &faceTriangles[0] + faceTriangleStart[face + 1];
+	}
+
+	// faces [first, last) sharing an edge with a face
+	inline void ch_getFaceNeighbours(unsigned int face, const unsigned int*& first, const unsigned int*& last) const
+	{
+		first = &faceNeighbours[0] + faceNeighbourStart[face];
+		last = &faceNeighbours[0] + faceNeighbourStart[face + 1];
+	}
+
+	// vertices [first, last) on the boundary of a face
+	inline void ch_getFaceVertices(unsigned int face, const unsigned int*& first, const unsigned int*& last) const
+	{
+		first = &faceVertices[0] + faceVertexStart[face];
+		last = &faceVertices[0] + faceVertexStart[face + 1];
+	}
+
+	// edges [first, last) around a face
+	inline void ch_getFaceEdges(unsigned int face, const unsigned int*& first, const unsigned int*& last) const
+	{
+		first = &faceEdges[0] + faceEdgeStart[face];
+		last = &faceEdges[0] + faceEdgeStart[face + 1];
+	}
+
+	// boundary vertices of the faces
+	inline unsigned int ch_getNumVertices() const { return (unsigned int)vertices.size(); }
+	inline const ch_vec3& ch_getVertex(unsigned int vertex) const { return vertices[vertex]; }
+
+	// edges [first, last) ending in a vertex, none unless it is a corner of the polytope
+	inline void ch_getVertexEdges(unsigned int vertex, const unsigned int*& first, const unsigned int*& last) const
+	{
+		first = &vertexEdges[0] + vertexEdgeStart[vertex];
+		last = &vertexEdges[0] + vertexEdgeStart[vertex + 1];
+	}
+
+	// edges of the polytope
+	inline unsigned int ch_getNumEdges() const { return (unsigned int)edges.size(); }
+	inline const ch_convexFeatureEdge& ch_getEdge(unsigned int edge) const { return edges[edge]; }
+
+	// bounds of the object
+	inline const ch_aabb& ch_getBounds() const { return bounds; }
+
+protected:
+
+	// grid over the triangles of a face, in plane coordinates along two axes of the face
+	struct ch_faceGrid
+	{
+		double u0, v0;				// grid corner
+		double inverseCellSize;
+		unsigned int resolution;	// cells per side, 0 for faces that are scanned
+		unsigned int firstCell;		// first cell in cellStart
+	};
+
+	// forget the object
+	void ch_clear();
+
+	// grid the triangles of the faces that have many
+	void ch_buildFaceGrids(const ch_triangleArray& triangles);
+
+	// face planes, normal.w holds d
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > planes;
+
+	// triangles of every face
+	vector<unsigned int> faceTriangleStart;
+	vector<unsigned int> faceTriangles;
+
+	// neighbours of every face
+	vector<unsigned int> faceNeighbourStart;
+	vector<unsigned int> faceNeighbours;
+
+	// boundary vertices of every face
+	vector<unsigned int> faceVertexStart;
+	vector<unsigned int> faceVertices;
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > vertices;
+
+	// edges of the polytope, of every face and of every vertex
+	vector<ch_convexFeatureEdge, ch_alignedAllocator<ch_convexFeatureEdge> > edges;
+	vector<unsigned int> faceEdgeStart;
+	vector<unsigned int> faceEdges;
+	vector<unsigned int> vertexEdgeStart;
+	vector<unsigned int> vertexEdges;
+
+	// triangle lookup: two axes in every face plane, the grids and the triangles of their cells
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > faceAxes;
+	vector<ch_faceGrid> faceGrids;
+	vector<unsigned int> cellStart;
+	vector<unsigned int> cellTriangles;
+
+	ch_aabb bounds;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include "ch_deformableMesh.h"
+#include "ch_trace.h"
+
+// system includes
+#include <algorithm>
+
+
+// constructor
+ch_deformableMesh::ch_deformableMesh()
+{
+	stopping = false;
+	queuedVersion = publishedVersion = 0;
+	numThreads = 1;
+	numPublished = 0;
+	numRecomputedTriangles = 0;
+}
+
+
+// destructor
+ch_deformableMesh::~ch_deformableMesh()
+{
+	ch_stop();
+}
+
+
+// stop the worker thread
+void ch_deformableMesh::ch_stop()
+{
+	if (!worker.joinable())
+		return;
+
+	{
+		unique_lock<mutex> guard(updateMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+	stopping = false;
+}
+
+
+// set up the geometry and start the worker thread
+void ch_deformableMesh::ch_build(const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& vertexPositions, const vector<unsigned int>& triangleIndices, unsigned int requestedThreads)
+{
+	ch_stop();
+
+	vertices = vertexPositions;
+	workerVertices = vertexPositions;
+	indices = triangleIndices;
+	changedRanges.clear();
+	queuedVersion = publishedVersion = 0;
+
+	numThreads = (requestedThreads > 0) ? requestedThreads : max(1u, thread::hardware_concurrency());
+
+	unsigned int numVertices = (unsigned int)vertices.size();
+	unsigned int numTriangles = (unsigned int)(indices.size() / 3);
+
+	// triangles around every vertex, to find the triangles a vertex update touches
+	vertexTriangleStart.assign(numVertices + 1, 0);
+	for (unsigned int i = 0; i < 3 * numTriangles; i++)
+		vertexTriangleStart[indices[i] + 1]++;
+	for (unsigned int v = 0; v < numVertices; v++)
+		vertexTriangleStart[v + 1] += vertexTriangleStart[v];
+
+	vertexTriangles.resize(3 * numTriangles);
+	vector<unsigned int> fill(vertexTriangleStart.begin(), vertexTriangleStart.end() - 1);
+	for (unsigned int i = 0; i < 3 * numTriangles; i++)
+		vertexTriangles[fill[indices[i]]++] = i / 3;
+
+	// the same initial snapshot in all three buffers
+	ch_meshSnapshot& first = snapshots.ch_getBuffer(0);
+	first.triangles.resize(numTriangles);
+	for (unsigned int i = 0; i < numTriangles; i++)
+		ch_setTriangle(first.triangles[i], vertices[indices[3 * i]], vertices[indices[3 * i + 1]], vertices[indices[3 * i + 2]]);
+	first.tree.ch_build(first.triangles);
+	first.version = 0;
+
+	for (int s = 0; s < 3; s++)
+	{
+		if (s > 0)
+			snapshots.ch_getBuffer(s) = first;
+		pendingTriangles[s].clear();
+		pendingFlags[s].assign(numTriangles, 0);
+	}
+
+	worker = thread(&ch_deformableMesh::ch_workerLoop, this);
+}
+
+
+// move vertices
+void ch_deformableMesh::ch_setVertices(unsigned int firstVertex, unsigned int numVertices, const ch_vec3* positions)
+{
+	if (numVertices == 0 || firstVertex + numVertices > vertices.size())
+		return;
+
+	{
+		unique_lock<mutex> guard(updateMutex);
+		copy(positions, positions + numVertices, vertices.begin() + firstVertex);
+		changedRanges.push_back(make_pair(firstVertex, numVertices));
+		queuedVersion++;
+	}
+	wake.notify_one();
+}
+
+
+// wait until every update passed so far has been published
+void ch_deformableMesh::ch_flush()
+{
+	unique_lock<mutex> guard(updateMutex);
+	while (publishedVersion != queuedVersion && worker.joinable())
+		published.wait(guard);
+}
+
+
+// worker thread: apply queued vertex updates and publish snapshots
+void ch_deformableMesh::ch_workerLoop()
+{
+	vector<pair<unsigned int, unsigned int> > ranges;
+
+	ch_trace::ch_registerThread("deformable worker");
+
+	unique_lock<mutex> guard(updateMutex);
+
+	for (;;)
+	{
+		while (!stopping && changedRanges.empty())
+			wake.wait(guard);
+		if (stopping)
+			return;
+
+		// take the queued ranges and copy the moved vertices while the writers are held off
+		ranges.clear();
+		ranges.swap(changedRanges);
+		unsigned int version = queuedVersion;
+		for (unsigned int r = 0; r < ranges.size(); r++)
+			copy(vertices.begin() + ranges[r].first, vertices.begin() + ranges[r].first + ranges[r].second, workerVertices.begin() + ranges[r].first);
+		guard.unlock();
+
+		// every snapshot has to see the triangles around the moved vertices, whenever it is written next
+		for (unsigned int r = 0; r < ranges.size(); r++)
+		{
+			for (unsigned int v = ranges[r].first; v < ranges[r].first + ranges[r].second; v++)
+			{
+				for (unsigned int i = vertexTriangleStart[v]; i < vertexTriangleStart[v + 1]; i++)
+				{
+					unsigned int t = vertexTriangles[i];
+					for (int s = 0; s < 3; s++)
+					{
+						if (!pendingFlags[s][t])
+						{
+							pendingFlags[s][t] = 1;
+							pendingTriangles[s].push_back(t);
+						}
+					}
+				}
+			}
+		}
+
+		// the write buffer is never the one the haptic thread reads
+		int slot = snapshots.ch_getWriteIndex();
+		ch_meshSnapshot& snapshot = snapshots.ch_getWriteBuffer();
+		ch_updateSnapshot(snapshot, pendingTriangles[slot]);
+		for (unsigned int i = 0; i < pendingTriangles[slot].size(); i++)
+			pendingFlags[slot][pendingTriangles[slot][i]] = 0;
+		pendingTriangles[slot].clear();
+		snapshot.version = version;
+
+		snapshots.ch_publish();
+
+		guard.lock();
+		publishedVersion = version;
+		numPublished++;
+		published.notify_all();
+	}
+}
+
+
+// bring one snapshot up to date with the worker copy of the vertices
+void ch_deformableMesh::ch_updateSnapshot(ch_meshSnapshot& snapshot, vector<unsigned int>& changedTriangles)
+{
+	unsigned int numChanged = (unsigned int)changedTriangles.size();
+
+	if (numChanged == 0)
+		return;
+
+	CH_TRACE_SCOPE("deformable update");
+
+	// the planes are independent: large updates are split over several threads
+	unsigned int parts = (numChanged >= CH_DEFORM_PARALLEL_MIN) ? numThreads : 1;
+	if (parts > 1)
+	{
+		vector<thread> helpers;
+		for (unsigned int p = 1; p < parts; p++)
+			helpers.push_back(thread(&ch_deformableMesh::ch_recomputeTriangles, this, &snapshot, &changedTriangles[0], (unsigned int)((unsigned long long)numChanged * p / parts), (unsigned int)((unsigned long long)numChanged * (p + 1) / parts)));
+		ch_recomputeTriangles(&snapshot, &changedTriangles[0], 0, numChanged / parts);
+		for (unsigned int p = 0; p < helpers.size(); p++)
+			helpers[p].join();
+	}
+	else
+	{
+		ch_recomputeTriangles(&snapshot, &changedTriangles[0], 0, numChanged);
+	}
+
+	// only the leaves holding changed triangles and their ancestors
+	snapshot.tree.ch_refit(snapshot.triangles, &changedTriangles[0], numChanged);
+
+	numRecomputedTriangles += numChanged;
+}
+
+
+// recompute the planes of triangles list[first, last) of a snapshot
+void ch_deformableMesh::ch_recomputeTriangles(ch_meshSnapshot* snapshot, const unsigned int* list, unsigned int first, unsigned int last)
+{
+	ch_triangle* triangles = &snapshot->triangles[0];
+	const unsigned int* index = &indices[0];
+	const ch_vec3* positions = &workerVertices[0];
+
+	for (unsigned int i = first; i < last; i++)
+	{
+		unsigned int t = list[i];
+		ch_setTriangle(triangles[t], positions[index[3 * t]], positions[index[3 * t + 1]], positions[index[3 * t + 2]]);
+	}
+}
@@ -0,0 +1,131 @@
+#ifndef CH_DEFORMABLEMESH_H
+#define CH_DEFORMABLEMESH_H
+
+// CH lab
+// collision geometry of a deforming object. vertex updates from the graphics thread are applied by a
+// worker thread, which recomputes the planes of the touched triangles, refits the tree bottom-up and
+// publishes the result through a triple buffer: the haptic thread always reads a complete, recent
+// snapshot and never waits for an update
+
+// system includes
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// local includes
+#include "ch_aabbTree.h"
+#include "ch_geometry.h"
+#include "ch_tripleBuffer.h"
+
+using namespace std;
+
+// updates touching fewer triangles are not worth splitting over several threads
+#define CH_DEFORM_PARALLEL_MIN 8192
+
+
+// collision geometry of the object at one point in time
+struct ch_meshSnapshot
+{
+	// world space triangles with their planes
+	ch_triangleArray triangles;
+
+	// tree over the triangles
+	ch_aabbTree tree;
+
+	// number of vertex updates included
+	unsigned int version;
+};
+
+
+class ch_deformableMesh
+{
+public:
+
+	// constructor
+	ch_deformableMesh();
+
+	// destructor, stops the worker thread
+	virtual ~ch_deformableMesh();
+
+	// set up the geometry (three vertex indices per triangle) and start the worker thread. large
+	// updates are split over numThreads threads, 0 picks the number of cores
+	void ch_build(const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& vertexPositions, const vector<unsigned int>& triangleIndices, unsigned int numThreads = 0);
+
+	// move numVertices vertices starting at firstVertex, from any thread but the haptic one. returns
+	// without waiting for the update to be applied
+	void ch_setVertices(unsigned int firstVertex, unsigned int numVertices, const ch_vec3* positions);
+
+	// haptic thread: the latest published snapshot, valid until the next call
+	inline const ch_meshSnapshot& ch_acquire() { return snapshots.ch_acquire(); }
+
+	// haptic thread: the snapshot returned by the last ch_acquire()
+	inline const ch_meshSnapshot& ch_getSnapshot() const { return snapshots.ch_getReadBuffer(); }
+
+	// wait until every update passed so far has been published
+	void ch_flush();
+
+	// number of triangles
+	inline unsigned int ch_getNumTriangles() const { return (unsigned int)(indices.size() / 3); }
+
+	// number of snapshots published and of triangle planes recomputed for them
+	inline unsigned int ch_getNumPublished() const { return numPublished; }
+	inline unsigned long long ch_getNumRecomputedTriangles() const { return numRecomputedTriangles; }
+
+protected:
+
+	// stop the worker thread
+	void ch_stop();
+
+	// worker thread: apply queued vertex updates and publish snapshots
+	void ch_workerLoop();
+
+	// bring one snapshot up to date with the worker copy of the vertices
+	void ch_updateSnapshot(ch_meshSnapshot& snapshot, vector<unsigned int>& changedTriangles);
+
+	// recompute the planes of triangles list[first, last) of a snapshot
+	void ch_recomputeTriangles(ch_meshSnapshot* snapshot, const unsigned int* list, unsigned int first, unsigned int last);
+
+	// vertex positions written by ch_setVertices(), guarded by updateMutex
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > vertices;
+
+	// vertex positions used by the worker
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > workerVertices;
+
+	// three vertex indices per triangle
+	vector<unsigned int> indices;
+
+	// triangles around every vertex: vertexTriangles[vertexTriangleStart[v], vertexTriangleStart[v + 1])
+	vector<unsigned int> vertexTriangleStart;
+	vector<unsigned int> vertexTriangles;
+
+	// vertex ranges (first, count) moved since the worker last looked, guarded by updateMutex
+	vector<pair<unsigned int, unsigned int> > changedRanges;
+
+	// triangles changed since each of the three snapshots was last written, and a flag per triangle
+	vector<unsigned int> pendingTriangles[3];
+	vector<unsigned char> pendingFlags[3];
+
+	// the published snapshots
+	ch_tripleBuffer<ch_meshSnapshot> snapshots;
+
+	// worker thread and its synchronisation
+	thread worker;
+	mutex updateMutex;
+	condition_variable wake;
+	condition_variable published;
+	bool stopping;
+
+	// number of updates passed in and published, guarded by updateMutex
+	unsigned int queuedVersion;
+	unsigned int publishedVersion;
+
+	// threads used for large updates
+	unsigned int numThreads;
+
+	// counters
+	unsigned int numPublished;
+	unsigned long long numRecomputedTriangles;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "ch_deviceIO.h"
+
+
+// constructor
+ch_deviceIO::ch_deviceIO() : running(false), numTransfers(0), numErrors(0)
+{
+	current.switches = 0;
+	current.time = 0.0;
+	current.index = 0;
+	numMissedSamples = 0;
+}
+
+
+// destructor
+ch_deviceIO::~ch_deviceIO()
+{
+	ch_stop();
+}
+
+
+// start the worker
+bool ch_deviceIO::ch_start(const ch_readFunction& read, const ch_writeFunction& write)
+{
+	if (running.load() || worker.joinable())
+		return false;
+
+	readDevice = read;
+	writeDevice = write;
+
+	// no force until the haptic thread computed one
+	for (int i = 0; i < 3; i++)
+	{
+		commands.ch_getBuffer(i).force = ch_vec3();
+		commands.ch_getBuffer(i).sample = 0;
+		samples.ch_getBuffer(i) = current;
+	}
+
+	numTransfers = 0;
+	numErrors = 0;
+	numMissedSamples = 0;
+	startTime = chrono::steady_clock::now();
+
+	running = true;
+	worker = thread(&ch_deviceIO::ch_run, this);
+	return true;
+}
+
+
+// stop the worker
+void ch_deviceIO::ch_stop()
+{
+	running = false;
+	if (worker.joinable())
+		worker.join();
+}
+
+
+// the worker
+void ch_deviceIO::ch_run()
+{
+	unsigned long long index = 0;
+
+	while (running.load())
+	{
+		// the reading blocks on USB, the haptic thread works on the previous one meanwhile
+		ch_deviceSample& sample = samples.ch_getWriteBuffer();
+		if (!readDevice(sample.position, sample.switches))
+			numErrors++;
+		sample.time = ch_now();
+		sample.index = ++index;
+		samples.ch_publish();
+
+		// the newest force, the same one again if the haptic thread has not finished its tick
+		const ch_deviceCommand& command = commands.ch_acquire();
+		if (!writeDevice(command.force))
+			numErrors++;
+
+		numTransfers++;
+	}
+
+	// leave the device without force
+	writeDevice(ch_vec3());
+}
+
+
+// wait for a reading newer than the last one taken
+bool ch_deviceIO::ch_waitForSample(double timeout)
+{
+	if (!samples.ch_hasNewValue())
+	{
+		chrono::steady_clock::time_point end = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout));
+
+		// a reading takes a fraction of a millisecond, sleeping would overshoot it
+		while (!samples.ch_hasNewValue())
+		{
+			if (!running.load() || chrono::steady_clock::now() >= end)
+				return false;
+			this_thread::yield();
+		}
+	}
+
+	unsigned long long last = current.index;
+	current = samples.ch_acquire();
+	if (last > 0 && current.index > last + 1)
+		numMissedSamples += current.index - last - 1;
+	return true;
+}
+
+
+// the force computed from the current reading
+void ch_deviceIO::ch_setForce(const ch_vec3& force)
+{
+	ch_deviceCommand& command = commands.ch_getWriteBuffer();
+	command.force = force;
+	command.sample = current.index;
+	commands.ch_publish();
+}
@@ -0,0 +1,114 @@
+#ifndef CH_DEVICEIO_H
+#define CH_DEVICEIO_H
+
+// CH lab
+// device transfers on a thread of their own. reading the position and sending the force block on USB for a
+// good part of a tick; here a worker thread does nothing else, and hands every reading to the haptic thread
+// and takes its forces back through lock-free triple buffers. the collision query and the solve of tick k
+// then overlap the transfer of tick k + 1, the force of a reading goes out with the transfer after it. no
+// CHAI3D dependency, the device is reached through two callbacks
+
+// system includes
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+// local includes
+#include "ch_math.h"
+#include "ch_tripleBuffer.h"
+
+using namespace std;
+
+
+// one device reading
+struct CH_ALIGN(32) ch_deviceSample
+{
+	ch_vec3 position;			// device position [m]
+	unsigned int switches;		// user switches, one bit each
+	double time;				// when the reading completed, seconds since ch_start()
+	unsigned long long index;	// number of the transfer, from 1
+};
+
+
+// force for the device
+struct CH_ALIGN(32) ch_deviceCommand
+{
+	ch_vec3 force;				// [N]
+	unsigned long long sample;	// index of the reading it was computed from, 0 for none
+};
+
+
+class ch_deviceIO
+{
+public:
+
+	// the buffers hold 32 byte aligned values
+	CH_ALIGNED_OPERATOR_NEW
+
+	// read the device position and switches, false on a device error
+	typedef function<bool(ch_vec3& position, unsigned int& switches)> ch_readFunction;
+
+	// send a force to the device, false on a device error
+	typedef function<bool(const ch_vec3& force)> ch_writeFunction;
+
+	// constructor
+	ch_deviceIO();
+
+	// destructor, stops the worker
+	virtual ~ch_deviceIO();
+
+	// start the worker on a device that is open and calibrated. returns false if it runs already
+	bool ch_start(const ch_readFunction& read, const ch_writeFunction& write);
+
+	// stop the worker, the last transfer sends a zero force
+	void ch_stop();
+
+	// is the worker running?
+	inline bool ch_isRunning() const { return running.load(); }
+
+	// haptic thread: wait at most timeout [s] for a reading newer than the last one taken, and take it.
+	// returns false on timeout, the last reading stays current
+	bool ch_waitForSample(double timeout);
+
+	// haptic thread: the reading taken last
+	inline const ch_deviceSample& ch_getSample() const { return current; }
+
+	// haptic thread: the force computed from the current reading, sent with the next transfer
+	void ch_setForce(const ch_vec3& force);
+
+	// number of transfers, and of device errors
+	inline unsigned long long ch_getNumTransfers() const { return numTransfers.load(); }
+	inline unsigned long long ch_getNumErrors() const { return numErrors.load(); }
+
+	// readings the haptic thread never took because it was slower than the device
+	inline unsigned long long ch_getNumMissedSamples() const { return numMissedSamples; }
+
+protected:
+
+	// the worker: read, publish, send the latest force, repeat
+	void ch_run();
+
+	// seconds since ch_start()
+	inline double ch_now() const { return chrono::duration<double>(chrono::steady_clock::now() - startTime).count(); }
+
+	ch_readFunction readDevice;
+	ch_writeFunction writeDevice;
+
+	// readings from the worker, forces from the haptic thread
+	ch_tripleBuffer<ch_deviceSample> samples;
+	ch_tripleBuffer<ch_deviceCommand> commands;
+
+	// haptic thread: the reading taken last
+	ch_deviceSample current;
+	unsigned long long numMissedSamples;
+
+	atomic<bool> running;
+	atomic<unsigned long long> numTransfers;
+	atomic<unsigned long long> numErrors;
+
+	chrono::steady_clock::time_point startTime;
+	thread worker;
+};
+
+#endif
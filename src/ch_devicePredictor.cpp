@@ -0,0 +1,95 @@
+#include "ch_devicePredictor.h"
+
+
+// constructor
+ch_devicePredictor::ch_devicePredictor(double leadTime, double processNoise, double measurementNoise)
+{
+	this->leadTime = leadTime;
+	q = processNoise;
+	r = measurementNoise;
+	initialised = false;
+}
+
+
+// start over at position, at rest
+void ch_devicePredictor::ch_reset(const ch_vec3& position)
+{
+	this->position = position;
+	velocity = ch_vec3();
+	acceleration = ch_vec3();
+	measurement = position;
+
+	// the position is known as well as a reading, the motion is not known at all
+	covariance = ch_mat3();
+	covariance(0, 0) = r;
+	covariance(1, 1) = 1.0;
+	covariance(2, 2) = 100.0;
+
+	initialised = true;
+}
+
+
+// a new reading
+void ch_devicePredictor::ch_update(const ch_vec3& reading, double dt)
+{
+	if (!initialised || dt <= 0.0)
+	{
+		if (!initialised)
+			ch_reset(reading);
+		measurement = reading;
+		return;
+	}
+	measurement = reading;
+
+	// predict: x = F x with F = [1 dt dt^2/2; 0 1 dt; 0 0 1], the same for every axis
+	double dt2 = dt * dt;
+	position += velocity * dt + acceleration * (0.5 * dt2);
+	velocity += acceleration * dt;
+
+	ch_mat3 f;
+	f(0, 1) = dt;
+	f(0, 2) = 0.5 * dt2;
+	f(1, 2) = dt;
+	ch_mat3 p = f * covariance * ch_transpose(f);
+
+	// P += Q of a white-noise jerk
+	double dt3 = dt2 * dt, dt4 = dt3 * dt, dt5 = dt4 * dt;
+	p(0, 0) += q * dt5 / 20.0;
+	p(0, 1) += q * dt4 / 8.0;	p(1, 0) += q * dt4 / 8.0;
+	p(0, 2) += q * dt3 / 6.0;	p(2, 0) += q * dt3 / 6.0;
+	p(1, 1) += q * dt3 / 3.0;
+	p(1, 2) += q * dt2 / 2.0;	p(2, 1) += q * dt2 / 2.0;
+	p(2, 2) += q * dt;
+
+	// correct with the position reading: H = [1 0 0], K = P H^T / (H P H^T + r)
+	double s = p(0, 0) + r;
+	ch_vec3 gain(p(0, 0) / s, p(1, 0) / s, p(2, 0) / s);
+
+	ch_vec3 innovation = reading - position;
+	position += innovation * gain.x;
+	velocity += innovation * gain.y;
+	acceleration += innovation * gain.z;
+
+	// P = (I - K H) P
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			covariance(i, j) = p(i, j) - gain[i] * p(0, j);
+}
+
+
+// position leadTime after the last reading
+ch_vec3 ch_devicePredictor::ch_predict(double leadTime) const
+{
+	if (!initialised || leadTime <= 0.0)
+		return measurement;
+
+	ch_vec3 predicted = position + velocity * leadTime + acceleration * (0.5 * leadTime * leadTime);
+
+	// an extrapolation is only trusted close to what the device reported
+	ch_vec3 offset = predicted - measurement;
+	double distance = ch_length(offset);
+	if (distance > CH_PREDICT_MAX_DISTANCE)
+		predicted = measurement + offset * (CH_PREDICT_MAX_DISTANCE / distance);
+
+	return predicted;
+}
@@ -0,0 +1,82 @@
+#ifndef CH_DEVICEPREDICTOR_H
+#define CH_DEVICEPREDICTOR_H
+
+// CH lab
+// constant-acceleration Kalman filter on the device position. the position read from the device is already
+// a USB frame or more old and the force goes out a tick later: the filter estimates position, velocity and
+// acceleration from the readings and extrapolates them to the time the force is applied. the axes share the
+// motion model and the noise, so one 3x3 covariance serves all three. no CHAI3D dependency
+
+// local includes
+#include "ch_math.h"
+
+// default white-noise jerk density [m^2/s^5] and position noise [m^2] of the device readings
+#define CH_PREDICT_PROCESS_NOISE 1000.0
+#define CH_PREDICT_MEASUREMENT_NOISE 1.0e-10
+
+// farthest [m] a prediction may be from the last reading, so that a noisy spike never throws the GO far
+#define CH_PREDICT_MAX_DISTANCE 0.005
+
+
+class ch_devicePredictor
+{
+public:
+
+	// the state is 32 byte aligned
+	CH_ALIGNED_OPERATOR_NEW
+
+	// constructor, leadTime [s] is how far ahead ch_predict() looks by default
+	ch_devicePredictor(double leadTime = 0.0, double processNoise = CH_PREDICT_PROCESS_NOISE, double measurementNoise = CH_PREDICT_MEASUREMENT_NOISE);
+
+	// destructor
+	virtual ~ch_devicePredictor() {};
+
+	// start over at position, at rest
+	void ch_reset(const ch_vec3& position);
+
+	// a new reading, dt [s] after the previous one. the first reading resets the filter
+	void ch_update(const ch_vec3& position, double dt);
+
+	// position leadTime [s] after the last reading, at most CH_PREDICT_MAX_DISTANCE from it
+	ch_vec3 ch_predict(double leadTime) const;
+
+	// position the default lead time after the last reading, the last reading itself if it is 0
+	inline ch_vec3 ch_predict() const { return ch_predict(leadTime); }
+
+	// default lead time [s], 0 turns the prediction off
+	inline void ch_setLeadTime(double time) { leadTime = time; }
+	inline double ch_getLeadTime() const { return leadTime; }
+
+	// noise of the motion model and of the readings
+	inline void ch_setNoise(double processNoise, double measurementNoise) { q = processNoise; r = measurementNoise; }
+
+	// filtered state
+	inline const ch_vec3& ch_getPosition() const { return position; }
+	inline const ch_vec3& ch_getVelocity() const { return velocity; }
+	inline const ch_vec3& ch_getAcceleration() const { return acceleration; }
+
+	// last reading
+	inline const ch_vec3& ch_getMeasurement() const { return measurement; }
+
+protected:
+
+	// estimate of every axis
+	ch_vec3 position;
+	ch_vec3 velocity;
+	ch_vec3 acceleration;
+
+	ch_vec3 measurement;
+
+	// covariance of (position, velocity, acceleration) of one axis
+	ch_mat3 covariance;
+
+	double leadTime;
+
+	// white-noise jerk density and position noise
+	double q;
+	double r;
+
+	bool initialised;
+};
+
+#endif
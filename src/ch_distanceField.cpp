@@ -0,0 +1,245 @@
+#include "ch_distanceField.h"
+
+// system includes
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// the automatic voxel size resolves the object diagonal with this many voxels
+#define CH_FIELD_VOXELS_PER_DIAGONAL 64.0
+
+// automatic band width in voxels
+#define CH_FIELD_BAND_VOXELS 4.0
+
+// largest number of bricks along one axis that still fits the 21 bit key fields
+#define CH_FIELD_MAX_DIM 2000000
+
+
+// constructor
+ch_distanceField::ch_distanceField()
+{
+	built = false;
+	voxelSize = brickSize = bandWidth = interpolationError = 0.0;
+	dims[0] = dims[1] = dims[2] = 0;
+}
+
+
+// build the field over world space triangles
+void ch_distanceField::ch_build(const ch_triangleArray& triangles, double requestedVoxelSize, double requestedBandWidth)
+{
+	unsigned int numTriangles = (unsigned int)triangles.size();
+
+	built = false;
+	brickKeys.clear();
+	brickSamples.clear();
+	brickTable.ch_clear();
+
+	if (numTriangles == 0)
+		return;
+
+	// bounds of all triangles
+	ch_aabb bounds;
+	for (unsigned int i = 0; i < numTriangles; i++)
+		bounds.ch_extend(ch_triangleBounds(triangles[i]));
+	const ch_vec3& lo = bounds.lo;
+	const ch_vec3& hi = bounds.hi;
+
+	double diagonal = max(ch_distance(lo, hi), SMALL_NUM);
+	voxelSize = (requestedVoxelSize > 0.0) ? requestedVoxelSize : diagonal / CH_FIELD_VOXELS_PER_DIAGONAL;
+	bandWidth = (requestedBandWidth > 0.0) ? requestedBandWidth : CH_FIELD_BAND_VOXELS * voxelSize;
+
+	// coarsen the voxels if the bricks would not fit the key fields
+	for (;;)
+	{
+		brickSize = CH_BRICK_SIZE * voxelSize;
+		bool fits = true;
+		for (int axis = 0; axis < 3; axis++)
+			fits = fits && ((hi[axis] - lo[axis] + 2.0 * (bandWidth + voxelSize)) / brickSize + 1.0 < CH_FIELD_MAX_DIM);
+		if (fits)
+			break;
+		voxelSize *= 2.0;
+	}
+	bandWidth = max(bandWidth, voxelSize);
+	interpolationError = sqrt(3.0) * voxelSize;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		origin[axis] = lo[axis] - bandWidth - voxelSize;
+		dims[axis] = (int)ceil((hi[axis] + bandWidth + voxelSize - origin[axis]) / brickSize) + 1;
+	}
+
+	// every brick that the band around a triangle overlaps, with the triangles that can be nearest in it
+	vector< pair<unsigned long long, unsigned int> > references;
+	references.reserve(8 * numTriangles);
+
+	for (unsigned int i = 0; i < numTriangles; i++)
+	{
+		ch_aabb box = ch_triangleBounds(triangles[i]);
+		int first[3], last[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			first[axis] = ch_brickCoord(box.lo[axis] - bandWidth, axis);
+			last[axis] = ch_brickCoord(box.hi[axis] + bandWidth, axis);
+		}
+
+		for (int iz = first[2]; iz <= last[2]; iz++)
+			for (int iy = first[1]; iy <= last[1]; iy++)
+				for (int ix = first[0]; ix <= last[0]; ix++)
+					references.push_back(make_pair(ch_packCellKey(ix, iy, iz), i));
+	}
+	sort(references.begin(), references.end());
+
+	const unsigned int samplesPerBrick = CH_BRICK_SAMPLES * CH_BRICK_SAMPLES * CH_BRICK_SAMPLES;
+	unsigned int begin = 0;
+
+	while (begin < references.size())
+	{
+		unsigned long long key = references[begin].first;
+		unsigned int end = begin;
+		while (end < references.size() && references[end].first == key)
+			end++;
+
+		int brick[3] = { (int)(key & 0x1fffff), (int)((key >> 21) & 0x1fffff), (int)((key >> 42) & 0x1fffff) };
+		unsigned int base = (unsigned int)brickSamples.size();
+		brickKeys.push_back(key);
+		brickSamples.resize(base + samplesPerBrick);
+
+		// sample the signed distance to the nearest triangle on every voxel corner of the brick
+		for (int sz = 0; sz < CH_BRICK_SAMPLES; sz++)
+			for (int sy = 0; sy < CH_BRICK_SAMPLES; sy++)
+				for (int sx = 0; sx < CH_BRICK_SAMPLES; sx++)
+				{
+					ch_vec3 p(origin.x + (brick[0] * CH_BRICK_SIZE + sx) * voxelSize,
+						origin.y + (brick[1] * CH_BRICK_SIZE + sy) * voxelSize,
+						origin.z + (brick[2] * CH_BRICK_SIZE + sz) * voxelSize);
+
+					double bestSq = DBL_MAX, bestSide = 0.0;
+					for (unsigned int r = begin; r < end; r++)
+					{
+						const ch_triangle& triangle = triangles[references[r].second];
+						ch_vec3 q = ch_closestPointOnTriangle(p, triangle.v0, triangle.v1, triangle.v2);
+						double distSq = ch_distanceSq(p, q);
+						double side = ch_dot(p - q, triangle.normal);
+
+						// on shared edges and vertices, the triangle seen most face-on decides the sign
+						if (distSq < bestSq - SMALL_NUM || (distSq <= bestSq + SMALL_NUM && fabs(side) > fabs(bestSide)))
+						{
+							bestSq = min(bestSq, distSq);
+							bestSide = side;
+						}
+					}
+
+					double distance = min(sqrt(bestSq), bandWidth);
+					brickSamples[base + (sz * CH_BRICK_SAMPLES + sy) * CH_BRICK_SAMPLES + sx] = (float)((bestSide < 0.0) ? -distance : distance);
+				}
+
+		begin = end;
+	}
+
+	brickTable.ch_build(brickKeys);
+	built = true;
+}
+
+
+// signed distance at a point, negative inside
+bool ch_distanceField::ch_getDistance(const ch_vec3& point, double& distance) const
+{
+	if (!built)
+		return false;
+
+	int brick[3];
+	for (int axis = 0; axis < 3; axis++)
+		brick[axis] = ch_brickCoord(point[axis], axis);
+
+	if (!ch_validBrick(brick[0], brick[1], brick[2]))
+		return false;
+
+	int index = brickTable.ch_find(ch_packCellKey(brick[0], brick[1], brick[2]));
+	if (index < 0)
+		return false;
+
+	// voxel and position inside it
+	int v[3];
+	double f[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		double local = (point[axis] - origin[axis]) / voxelSize - brick[axis] * CH_BRICK_SIZE;
+		v[axis] = min(max((int)floor(local), 0), CH_BRICK_SIZE - 1);
+		f[axis] = local - v[axis];
+	}
+
+	// trilinear interpolation of the eight voxel corners
+	const float* s = &brickSamples[index * CH_BRICK_SAMPLES * CH_BRICK_SAMPLES * CH_BRICK_SAMPLES];
+	const int dy = CH_BRICK_SAMPLES, dz = CH_BRICK_SAMPLES * CH_BRICK_SAMPLES;
+	const float* c = s + v[2] * dz + v[1] * dy + v[0];
+
+	double c00 = c[0] + f[0] * (c[1] - c[0]);
+	double c10 = c[dy] + f[0] * (c[dy + 1] - c[dy]);
+	double c01 = c[dz] + f[0] * (c[dz + 1] - c[dz]);
+	double c11 = c[dz + dy] + f[0] * (c[dz + dy + 1] - c[dz + dy]);
+	double c0 = c00 + f[1] * (c10 - c00);
+	double c1 = c01 + f[1] * (c11 - c01);
+
+	distance = c0 + f[2] * (c1 - c0);
+	return true;
+}
+
+
+// lower bound of the unsigned distance from a point to the surface
+double ch_distanceField::ch_getDistanceLowerBound(const ch_vec3& point) const
+{
+	double distance;
+
+	// outside the allocated bricks the point is farther than the band from every triangle
+	if (!ch_getDistance(point, distance))
+		return bandWidth;
+
+	return max(fabs(distance) - interpolationError, 0.0);
+}
+
+
+// can a segment touch the surface?
+bool ch_distanceField::ch_segmentMayTouchSurface(const ch_vec3& segmentStart, const ch_vec3& segmentEnd) const
+{
+	if (!built)
+		return true;
+
+	// the distance changes at most as fast as the position, so no point of the segment reaches
+	// the surface if both end points are farther from it than the segment is long
+	return ch_getDistanceLowerBound(segmentStart) + ch_getDistanceLowerBound(segmentEnd) <= ch_distance(segmentStart, segmentEnd);
+}
+
+
+// estimate the closest surface point and the penetration depth from the field gradient
+bool ch_distanceField::ch_estimatePenetration(const ch_vec3& point, ch_vec3& surfacePoint, double& depth) const
+{
+	double distance;
+
+	if (!ch_getDistance(point, distance) || distance >= 0.0)
+		return false;
+
+	// central differences, one sided where a neighbour falls outside the band
+	ch_vec3 gradient;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		ch_vec3 plus = point, minus = point;
+		plus[axis] += voxelSize;
+		minus[axis] -= voxelSize;
+
+		double dPlus, dMinus;
+		if (!ch_getDistance(plus, dPlus))
+			dPlus = distance;
+		if (!ch_getDistance(minus, dMinus))
+			dMinus = distance;
+		gradient[axis] = dPlus - dMinus;
+	}
+
+	if (ch_lengthSq(gradient) < SMALL_NUM * SMALL_NUM)
+		return false;
+	gradient = ch_normalize(gradient);
+
+	// move out along the outward gradient by the penetration depth
+	depth = -distance;
+	surfacePoint = point + gradient * depth;
+	return true;
+}
@@ -0,0 +1,100 @@
+#ifndef CH_DISTANCEFIELD_H
+#define CH_DISTANCEFIELD_H
+
+// CH lab
+// sparse narrow-band signed distance field of an object, stored as a brick map. only bricks
+// within the band around a triangle are allocated, everything else is known to be at least
+// one band width away from the surface
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_geometry.h"
+#include "ch_spatialHash.h"
+
+using namespace std;
+
+// voxels along each side of a brick, samples are stored on the voxel corners
+#define CH_BRICK_SIZE 8
+#define CH_BRICK_SAMPLES (CH_BRICK_SIZE + 1)
+
+
+class ch_distanceField
+{
+public:
+
+	// constructor
+	ch_distanceField();
+
+	// destructor
+	virtual ~ch_distanceField() {};
+
+	// build the field over world space triangles with outward pointing normals. sizes <= 0 are
+	// derived from the object bounds
+	void ch_build(const ch_triangleArray& triangles, double requestedVoxelSize = 0.0, double requestedBandWidth = 0.0);
+
+	// signed distance at a point, negative inside. returns false outside the band, where the
+	// distance is only known to be larger than the band width
+	bool ch_getDistance(const ch_vec3& point, double& distance) const;
+
+	// lower bound of the unsigned distance from a point to the surface
+	double ch_getDistanceLowerBound(const ch_vec3& point) const;
+
+	// can a segment touch the surface? false means it certainly does not
+	bool ch_segmentMayTouchSurface(const ch_vec3& segmentStart, const ch_vec3& segmentEnd) const;
+
+	// if the point lies inside the object within the band, estimate the closest surface point and the
+	// penetration depth from the field gradient
+	bool ch_estimatePenetration(const ch_vec3& point, ch_vec3& surfacePoint, double& depth) const;
+
+	// has the field been built?
+	inline bool ch_isBuilt() const { return built; }
+
+	// edge length of a voxel
+	inline double ch_getVoxelSize() const { return voxelSize; }
+
+	// width of the band around the surface
+	inline double ch_getBandWidth() const { return bandWidth; }
+
+	// number of allocated bricks
+	inline unsigned int ch_getNumBricks() const { return (unsigned int)brickKeys.size(); }
+
+protected:
+
+	// brick coordinate of a position along one axis
+	inline int ch_brickCoord(double value, int axis) const { return (int)floor((value - origin[axis]) / brickSize); }
+
+	// is the brick inside the key range?
+	inline bool ch_validBrick(int ix, int iy, int iz) const
+	{
+		return ix >= 0 && iy >= 0 && iz >= 0 && ix < dims[0] && iy < dims[1] && iz < dims[2];
+	}
+
+	// has the field been built?
+	bool built;
+
+	// corner of brick (0, 0, 0)
+	ch_vec3 origin;
+
+	// edge length of a voxel and of a brick
+	double voxelSize, brickSize;
+
+	// distances are clamped to the band
+	double bandWidth;
+
+	// maximum trilinear interpolation error, the voxel diagonal
+	double interpolationError;
+
+	// number of bricks along each axis
+	int dims[3];
+
+	// keys of the allocated bricks and their samples, CH_BRICK_SAMPLES^3 per brick
+	vector<unsigned long long> brickKeys;
+	vector<float> brickSamples;
+
+	// index into brickKeys for every allocated brick
+	ch_spatialHash brickTable;
+};
+
+#endif
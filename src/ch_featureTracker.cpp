@@ -0,0 +1,292 @@
+#include "ch_featureTracker.h"
+
+// system includes
+#include <algorithm>
+#include <math.h>
+
+
+// constructor
+ch_featureTracker::ch_featureTracker(const ch_convexCollider* collider) : collider(collider)
+{
+	tracking = false;
+	type = CH_FEATURE_FACE;
+	index = 0;
+	numSteps = 0;
+	numFaceScans = 0;
+	numFallbacks = 0;
+}
+
+
+// track on another collider
+void ch_featureTracker::ch_setCollider(const ch_convexCollider* newCollider)
+{
+	collider = newCollider;
+	tracking = false;
+}
+
+
+// closest feature, walking from the last one
+bool ch_featureTracker::ch_update(const ch_vec3& point, ch_closestFeature& result)
+{
+	if (!collider || !collider->ch_isBuilt())
+		return false;
+
+	if (!tracking)
+	{
+		ch_locate(*collider, point, result);
+		type = result.type;
+		index = result.index;
+		tracking = true;
+		return true;
+	}
+
+	// every step gets nearer to the point, a walk longer than the number of features went round in circles
+	unsigned int maxSteps = collider->ch_getNumFaces() + collider->ch_getNumEdges() + collider->ch_getNumVertices();
+	const unsigned int *first, *last;
+
+	for (unsigned int step = 0; step <= maxSteps; step++)
+	{
+		if (type == CH_FEATURE_VERTEX)
+		{
+			// the vertex region ends where the point is ahead of the vertex along one of its edges
+			const ch_vec3& vertex = collider->ch_getVertex(index);
+			collider->ch_getVertexEdges(index, first, last);
+
+			double ahead = 0.0;
+			int next = -1;
+			for (const unsigned int* e = first; e != last; e++)
+			{
+				const ch_convexFeatureEdge& edge = collider->ch_getEdge(*e);
+				const ch_vec3& other = collider->ch_getVertex(edge.vertex[0] == index ? edge.vertex[1] : edge.vertex[0]);
+				double s = ch_dot(point - vertex, ch_normalize(other - vertex));
+				if (s > ahead)
+				{
+					ahead = s;
+					next = (int)*e;
+				}
+			}
+
+			if (next < 0)
+			{
+				ch_describe(*collider, point, type, index, result);
+				return true;
+			}
+			type = CH_FEATURE_EDGE;
+			index = (unsigned int)next;
+		}
+		else if (type == CH_FEATURE_EDGE)
+		{
+			// the edge region is bounded by the planes through its ends and the planes of its faces' regions
+			const ch_convexFeatureEdge& edge = collider->ch_getEdge(index);
+			const ch_vec3& a = collider->ch_getVertex(edge.vertex[0]);
+			ch_vec3 ab = collider->ch_getVertex(edge.vertex[1]) - a;
+			ch_vec3 ap = point - a;
+
+			double t = ch_dot(ap, ab);
+			double across0 = ch_dot(ap, edge.inward[0]), across1 = ch_dot(ap, edge.inward[1]);
+			if (t < 0.0)
+			{
+				type = CH_FEATURE_VERTEX;
+				index = edge.vertex[0];
+			}
+			else if (t > ch_dot(ab, ab))
+			{
+				type = CH_FEATURE_VERTEX;
+				index = edge.vertex[1];
+			}
+			else if (across0 > 0.0 || across1 > 0.0)
+			{
+				type = CH_FEATURE_FACE;
+				index = edge.face[(across0 >= across1) ? 0 : 1];
+			}
+			else
+			{
+				ch_describe(*collider, point, type, index, result);
+				return true;
+			}
+		}
+		else
+		{
+			// the face region ends at the planes through its edges, leave across the one the point is farthest beyond
+			collider->ch_getFaceEdges(index, first, last);
+
+			double beyond = 0.0;
+			int next = -1;
+			for (const unsigned int* e = first; e != last; e++)
+			{
+				const ch_convexFeatureEdge& edge = collider->ch_getEdge(*e);
+				double s = ch_dot(point - collider->ch_getVertex(edge.vertex[0]), edge.inward[edge.face[0] == index ? 0 : 1]);
+				if (s < beyond)
+				{
+					beyond = s;
+					next = (int)*e;
+				}
+			}
+
+			if (next >= 0)
+			{
+				type = CH_FEATURE_EDGE;
+				index = (unsigned int)next;
+			}
+			else
+			{
+				const ch_vec3& plane = collider->ch_getPlane(index);
+				if (ch_dot(plane, point) - plane.w >= 0.0)
+				{
+					ch_describe(*collider, point, type, index, result);
+					return true;
+				}
+
+				// behind the face: inside the object, or the device went through it. the nearest plane tells
+				numFaceScans++;
+				unsigned int face;
+				double distance = collider->ch_signedDistance(point, face);
+				if (distance <= 0.0)
+				{
+					index = face;
+					ch_describeInside(*collider, point, face, distance, result);
+					return true;
+				}
+				index = face;
+			}
+		}
+		numSteps++;
+	}
+
+	numFallbacks++;
+	ch_locate(*collider, point, result);
+	type = result.type;
+	index = result.index;
+	return true;
+}
+
+
+// closest feature by testing every one
+void ch_featureTracker::ch_locate(const ch_convexCollider& collider, const ch_vec3& point, ch_closestFeature& result)
+{
+	unsigned int face;
+	double distance = collider.ch_signedDistance(point, face);
+	if (distance <= 0.0)
+	{
+		ch_describeInside(collider, point, face, distance, result);
+		return;
+	}
+
+	ch_featureType bestType = CH_FEATURE_FACE;
+	unsigned int best = face;
+	double bestDistance = 1e300;
+	const unsigned int *first, *last;
+
+	// faces the point is in front of and whose polygon it projects into
+	for (unsigned int f = 0; f < collider.ch_getNumFaces(); f++)
+	{
+		const ch_vec3& plane = collider.ch_getPlane(f);
+		double d = ch_dot(plane, point) - plane.w;
+		if (d < 0.0 || d >= bestDistance)
+			continue;
+
+		bool above = true;
+		collider.ch_getFaceEdges(f, first, last);
+		for (const unsigned int* e = first; above && e != last; e++)
+		{
+			const ch_convexFeatureEdge& edge = collider.ch_getEdge(*e);
+			above = ch_dot(point - collider.ch_getVertex(edge.vertex[0]), edge.inward[edge.face[0] == f ? 0 : 1]) >= 0.0;
+		}
+		if (above)
+		{
+			bestDistance = d;
+			best = f;
+		}
+	}
+
+	// edges and corners, the ends of the edges
+	for (unsigned int e = 0; e < collider.ch_getNumEdges(); e++)
+	{
+		const ch_convexFeatureEdge& edge = collider.ch_getEdge(e);
+		const ch_vec3& a = collider.ch_getVertex(edge.vertex[0]);
+		const ch_vec3& b = collider.ch_getVertex(edge.vertex[1]);
+		ch_vec3 ab = b - a;
+
+		double t = ch_dot(point - a, ab);
+		if (t <= 0.0 || t >= ch_dot(ab, ab))
+		{
+			unsigned int vertex = edge.vertex[t <= 0.0 ? 0 : 1];
+			double d = ch_distance(point, collider.ch_getVertex(vertex));
+			if (d < bestDistance)
+			{
+				bestDistance = d;
+				bestType = CH_FEATURE_VERTEX;
+				best = vertex;
+			}
+			continue;
+		}
+
+		double d = ch_distance(point, a + ab * (t / ch_dot(ab, ab)));
+		if (d < bestDistance)
+		{
+			bestDistance = d;
+			bestType = CH_FEATURE_EDGE;
+			best = e;
+		}
+	}
+
+	ch_describe(collider, point, bestType, best, result);
+}
+
+
+// result for the point on a feature
+void ch_featureTracker::ch_describe(const ch_convexCollider& collider, const ch_vec3& point, ch_featureType type, unsigned int index, ch_closestFeature& result)
+{
+	result.type = type;
+	result.index = index;
+
+	if (type == CH_FEATURE_FACE)
+	{
+		const ch_vec3& plane = collider.ch_getPlane(index);
+		result.normal = ch_vec3(plane.x, plane.y, plane.z);
+		result.distance = ch_dot(plane, point) - plane.w;
+		result.point = point - result.normal * result.distance;
+		return;
+	}
+
+	// a point on the edge or the corner itself has no direction to it, the normal of an adjacent face stands in
+	unsigned int face;
+	if (type == CH_FEATURE_EDGE)
+	{
+		const ch_convexFeatureEdge& edge = collider.ch_getEdge(index);
+		const ch_vec3& a = collider.ch_getVertex(edge.vertex[0]);
+		ch_vec3 ab = collider.ch_getVertex(edge.vertex[1]) - a;
+		double t = min(max(ch_dot(point - a, ab) / ch_dot(ab, ab), 0.0), 1.0);
+		result.point = a + ab * t;
+		face = edge.face[0];
+	}
+	else
+	{
+		const unsigned int *first, *last;
+		collider.ch_getVertexEdges(index, first, last);
+		result.point = collider.ch_getVertex(index);
+		face = (first != last) ? collider.ch_getEdge(*first).face[0] : 0;
+	}
+
+	ch_vec3 offset = point - result.point;
+	result.distance = ch_length(offset);
+	if (result.distance > 0.0)
+		result.normal = offset * (1.0 / result.distance);
+	else
+	{
+		const ch_vec3& plane = collider.ch_getPlane(face);
+		result.normal = ch_vec3(plane.x, plane.y, plane.z);
+	}
+}
+
+
+// the face plane nearest to a point inside
+void ch_featureTracker::ch_describeInside(const ch_convexCollider& collider, const ch_vec3& point, unsigned int face, double distance, ch_closestFeature& result)
+{
+	const ch_vec3& plane = collider.ch_getPlane(face);
+	result.type = CH_FEATURE_FACE;
+	result.index = face;
+	result.normal = ch_vec3(plane.x, plane.y, plane.z);
+	result.distance = distance;
+	result.point = point - result.normal * distance;
+}
@@ -0,0 +1,86 @@
+#ifndef CH_FEATURETRACKER_H
+#define CH_FEATURETRACKER_H
+
+// CH lab
+// closest feature of a convex object to a moving point, in the manner of Lin and Canny. the tracker keeps
+// the face, edge or corner nearest to the device between ticks and walks to a neighbouring feature whenever
+// the point leaves its Voronoi region; the device moves little per tick, so a step or two is the rule. it
+// gives the distance, the normal and the closest point before the contact as well as the penetration
+// depth during it. no CHAI3D dependency
+
+// local includes
+#include "ch_convexCollider.h"
+
+using namespace std;
+
+
+// kinds of features
+enum ch_featureType
+{
+	CH_FEATURE_FACE,
+	CH_FEATURE_EDGE,
+	CH_FEATURE_VERTEX
+};
+
+
+// closest feature to a point
+struct CH_ALIGN(32) ch_closestFeature
+{
+	ch_vec3 point;			// closest point of the surface
+	ch_vec3 normal;			// unit, out of the object through the query point; the face normal on a face
+	double distance;		// from the surface, negative inside the object
+	ch_featureType type;
+	unsigned int index;		// face, edge or vertex of the collider
+};
+
+
+class ch_featureTracker
+{
+public:
+
+	// the collider is not copied and has to outlive the tracker
+	ch_featureTracker(const ch_convexCollider* collider = NULL);
+
+	// destructor
+	virtual ~ch_featureTracker() {};
+
+	// track on another collider
+	void ch_setCollider(const ch_convexCollider* collider);
+
+	// forget the current feature, the next update searches all of them
+	inline void ch_reset() { tracking = false; }
+
+	// closest feature to the point, starting the walk at the one of the last update. returns false if there
+	// is no convex object
+	bool ch_update(const ch_vec3& point, ch_closestFeature& result);
+
+	// closest feature by testing every one of them, as a reference and to start the tracking
+	static void ch_locate(const ch_convexCollider& collider, const ch_vec3& point, ch_closestFeature& result);
+
+	// steps between features, updates that went through every face because the point was behind the
+	// current one, and walks that did not settle and were replaced by ch_locate()
+	inline unsigned long long ch_getNumSteps() const { return numSteps; }
+	inline unsigned long long ch_getNumFaceScans() const { return numFaceScans; }
+	inline unsigned long long ch_getNumFallbacks() const { return numFallbacks; }
+
+protected:
+
+	// result for the point on a feature; the point has to lie in its Voronoi region
+	static void ch_describe(const ch_convexCollider& collider, const ch_vec3& point, ch_featureType type, unsigned int index, ch_closestFeature& result);
+
+	// the face plane nearest to a point behind all of them
+	static void ch_describeInside(const ch_convexCollider& collider, const ch_vec3& point, unsigned int face, double distance, ch_closestFeature& result);
+
+	const ch_convexCollider* collider;
+
+	// feature of the last update
+	bool tracking;
+	ch_featureType type;
+	unsigned int index;
+
+	unsigned long long numSteps;
+	unsigned long long numFaceScans;
+	unsigned long long numFallbacks;
+};
+
+#endif
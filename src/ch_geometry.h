@@ -0,0 +1,198 @@
+#ifndef CH_GEOMETRY_H
+#define CH_GEOMETRY_H
+
+// CH lab
+// header-only geometry kernels on ch_vec3, shared by the segment checker, the acceleration
+// structures and the GO solver. no CHAI3D dependency
+
+// local includes
+#include "ch_math.h"
+
+using namespace std;
+
+// result codes of ch_intersectSegmentTriangle(), same as ch_checkSegTriangleCollision()
+#define CH_HIT					1	// common point found on the segment and inside the triangle
+#define CH_MISS_PARALLEL		0	// segment (almost) parallel to the plane, or leaving through it
+#define CH_MISS_SEGMENT			-1	// plane crossed outside the segment
+#define CH_MISS_TRIANGLE		-2	// plane crossed outside the triangle
+
+
+// axis aligned bounding box
+struct CH_ALIGN(32) ch_aabb
+{
+	ch_vec3 lo, hi;
+
+	// empty box
+	CH_FORCE_INLINE ch_aabb() : lo(1e300, 1e300, 1e300), hi(-1e300, -1e300, -1e300) {}
+
+	CH_FORCE_INLINE void ch_extend(const ch_vec3& p) { lo = ch_min(lo, p); hi = ch_max(hi, p); }
+	CH_FORCE_INLINE void ch_extend(const ch_aabb& b) { lo = ch_min(lo, b.lo); hi = ch_max(hi, b.hi); }
+	CH_FORCE_INLINE bool ch_isEmpty() const { return lo.x > hi.x; }
+	CH_FORCE_INLINE ch_vec3 ch_center() const { return (lo + hi) * 0.5; }
+	CH_FORCE_INLINE ch_vec3 ch_extent() const { return hi - lo; }
+};
+
+
+// world space triangle with the plane that contains it. the normal points away from the object
+// surface for counter-clockwise triangles (as ch_plane), normal.w holds d of the plane n.x = d
+struct CH_ALIGN(32) ch_triangle
+{
+	ch_vec3 v0, v1, v2;
+	ch_vec3 normal;
+};
+
+typedef vector<ch_triangle, ch_alignedAllocator<ch_triangle> > ch_triangleArray;
+
+
+// set the vertices of a triangle and compute its plane
+CH_FORCE_INLINE void ch_setTriangle(ch_triangle& triangle, const ch_vec3& v0, const ch_vec3& v1, const ch_vec3& v2)
+{
+	triangle.v0 = v0;
+	triangle.v1 = v1;
+	triangle.v2 = v2;
+	triangle.normal = ch_normalize(ch_cross(v1 - v0, v2 - v0));
+	triangle.normal.w = ch_dot(triangle.normal, v0);
+}
+
+
+// bounding box of a triangle
+CH_FORCE_INLINE ch_aabb ch_triangleBounds(const ch_triangle& triangle)
+{
+	ch_aabb box;
+	box.lo = ch_min(triangle.v0, ch_min(triangle.v1, triangle.v2));
+	box.hi = ch_max(triangle.v0, ch_max(triangle.v1, triangle.v2));
+	return box;
+}
+
+
+// do the point and v3 lie on the same side of the line through v1 and v2?
+CH_FORCE_INLINE bool ch_sameSide(const ch_vec3& point, const ch_vec3& v3, const ch_vec3& v1, const ch_vec3& v2)
+{
+	ch_vec3 v12 = v2 - v1;
+	return ch_dot(ch_cross(v12, point - v1), ch_cross(v12, v3 - v1)) >= 0.0;
+}
+
+
+// does a point of the triangle plane lie inside the triangle?
+CH_FORCE_INLINE bool ch_pointInTriangle(const ch_vec3& point, const ch_vec3& v0, const ch_vec3& v1, const ch_vec3& v2)
+{
+	return ch_sameSide(point, v2, v0, v1) && ch_sameSide(point, v0, v1, v2) && ch_sameSide(point, v1, v2, v0);
+}
+
+
+// intersect the segment start + t direction, t in [0, tMax], with a triangle. only segments entering
+// the object through the front side count. returns one of the CH_HIT / CH_MISS_* codes
+CH_FORCE_INLINE int ch_intersectSegmentTriangle(const ch_triangle& triangle, const ch_vec3& start, const ch_vec3& direction, double& t, ch_vec3& point, double tMax = 1.0)
+{
+	double denominator = ch_dot(triangle.normal, direction);
+
+	if (-denominator < SMALL_NUM)
+		return CH_MISS_PARALLEL;
+
+	t = (triangle.normal.w - ch_dot(triangle.normal, start)) / denominator;
+
+	if (t < 0.0 || t > tMax)
+		return CH_MISS_SEGMENT;
+
+	point = start + direction * t;
+
+	return ch_pointInTriangle(point, triangle.v0, triangle.v1, triangle.v2) ? CH_HIT : CH_MISS_TRIANGLE;
+}
+
+
+// clip the segment start + t direction, t in [t0, t1], against a box (slab test)
+CH_FORCE_INLINE bool ch_clipSegmentToBox(const ch_aabb& box, const ch_vec3& start, const ch_vec3& direction, double& t0, double& t1)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (fabs(direction[axis]) < SMALL_NUM)
+		{
+			if (start[axis] < box.lo[axis] || start[axis] > box.hi[axis])
+				return false;
+		}
+		else
+		{
+			double inverse = 1.0 / direction[axis];
+			double tNear = (box.lo[axis] - start[axis]) * inverse;
+			double tFar = (box.hi[axis] - start[axis]) * inverse;
+			if (tNear > tFar)
+			{
+				double swap = tNear;
+				tNear = tFar;
+				tFar = swap;
+			}
+			t0 = (tNear > t0) ? tNear : t0;
+			t1 = (tFar < t1) ? tFar : t1;
+			if (t0 > t1)
+				return false;
+		}
+	}
+	return true;
+}
+
+
+// squared distance from a point to a box, 0 inside it
+CH_FORCE_INLINE double ch_distanceSqToBox(const ch_aabb& box, const ch_vec3& point)
+{
+	double distanceSq = 0.0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		double outside = (point[axis] < box.lo[axis]) ? box.lo[axis] - point[axis] : ((point[axis] > box.hi[axis]) ? point[axis] - box.hi[axis] : 0.0);
+		distanceSq += outside * outside;
+	}
+	return distanceSq;
+}
+
+
+// barycentric weights of a, b and c at a point p of the triangle plane, from Ericson, Real-Time Collision
+// Detection, 3.4
+inline ch_vec3 ch_barycentric(const ch_vec3& p, const ch_vec3& a, const ch_vec3& b, const ch_vec3& c)
+{
+	ch_vec3 ab = b - a, ac = c - a, ap = p - a;
+	double d00 = ch_dot(ab, ab), d01 = ch_dot(ab, ac), d11 = ch_dot(ac, ac);
+	double d20 = ch_dot(ap, ab), d21 = ch_dot(ap, ac);
+	double denominator = d00 * d11 - d01 * d01;
+	if (fabs(denominator) < SMALL_NUM * SMALL_NUM)
+		return ch_vec3(1.0, 0.0, 0.0);
+
+	double v = (d11 * d20 - d01 * d21) / denominator;
+	double w = (d00 * d21 - d01 * d20) / denominator;
+	return ch_vec3(1.0 - v - w, v, w);
+}
+
+
+// closest point to p on triangle (a, b, c), from Ericson, Real-Time Collision Detection, 5.1.5
+inline ch_vec3 ch_closestPointOnTriangle(const ch_vec3& p, const ch_vec3& a, const ch_vec3& b, const ch_vec3& c)
+{
+	ch_vec3 ab = b - a, ac = c - a, ap = p - a;
+	double d1 = ch_dot(ab, ap), d2 = ch_dot(ac, ap);
+	if (d1 <= 0.0 && d2 <= 0.0)
+		return a;
+
+	ch_vec3 bp = p - b;
+	double d3 = ch_dot(ab, bp), d4 = ch_dot(ac, bp);
+	if (d3 >= 0.0 && d4 <= d3)
+		return b;
+
+	double vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+		return a + ab * (d1 / (d1 - d3));
+
+	ch_vec3 cp = p - c;
+	double d5 = ch_dot(ab, cp), d6 = ch_dot(ac, cp);
+	if (d6 >= 0.0 && d5 <= d6)
+		return c;
+
+	double vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+		return a + ac * (d2 / (d2 - d6));
+
+	double va = d3 * d6 - d5 * d4;
+	if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	double denom = 1.0 / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+#endif
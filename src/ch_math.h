@@ -0,0 +1,175 @@
+#ifndef CH_MATH_H
+#define CH_MATH_H
+
+// CH lab
+// small header-only vector and matrix types for the collision and GO hot paths. they do not depend on
+// CHAI3D (see ch_chai3dAdapters.h for the conversions), every vector is padded to four doubles and
+// aligned to 32 bytes so that arrays of them map directly onto SSE/AVX registers
+
+// system includes
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#define CH_ALIGN(n) __declspec(align(n))
+#define CH_FORCE_INLINE __forceinline
+#else
+#define CH_ALIGN(n) __attribute__((aligned(n)))
+#define CH_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+#define SMALL_NUM  0.00000001 // anything that avoids division overflow
+
+
+// 3D vector, the fourth lane is padding or carries a scalar that belongs to the vector (eg. a plane offset)
+struct CH_ALIGN(32) ch_vec3
+{
+	double x, y, z, w;
+
+	CH_FORCE_INLINE ch_vec3() : x(0.0), y(0.0), z(0.0), w(0.0) {}
+	CH_FORCE_INLINE ch_vec3(double a_x, double a_y, double a_z) : x(a_x), y(a_y), z(a_z), w(0.0) {}
+
+	CH_FORCE_INLINE double& operator[](int i) { return (&x)[i]; }
+	CH_FORCE_INLINE double operator[](int i) const { return (&x)[i]; }
+
+	CH_FORCE_INLINE ch_vec3& operator+=(const ch_vec3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	CH_FORCE_INLINE ch_vec3& operator-=(const ch_vec3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	CH_FORCE_INLINE ch_vec3& operator*=(double s) { x *= s; y *= s; z *= s; return *this; }
+};
+
+CH_FORCE_INLINE ch_vec3 operator+(const ch_vec3& a, const ch_vec3& b) { return ch_vec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+CH_FORCE_INLINE ch_vec3 operator-(const ch_vec3& a, const ch_vec3& b) { return ch_vec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+CH_FORCE_INLINE ch_vec3 operator-(const ch_vec3& a) { return ch_vec3(-a.x, -a.y, -a.z); }
+CH_FORCE_INLINE ch_vec3 operator*(const ch_vec3& a, double s) { return ch_vec3(a.x * s, a.y * s, a.z * s); }
+CH_FORCE_INLINE ch_vec3 operator*(double s, const ch_vec3& a) { return ch_vec3(a.x * s, a.y * s, a.z * s); }
+
+CH_FORCE_INLINE double ch_dot(const ch_vec3& a, const ch_vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+CH_FORCE_INLINE ch_vec3 ch_cross(const ch_vec3& a, const ch_vec3& b) { return ch_vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+CH_FORCE_INLINE double ch_lengthSq(const ch_vec3& a) { return ch_dot(a, a); }
+CH_FORCE_INLINE double ch_length(const ch_vec3& a) { return sqrt(ch_dot(a, a)); }
+CH_FORCE_INLINE double ch_distanceSq(const ch_vec3& a, const ch_vec3& b) { return ch_lengthSq(a - b); }
+CH_FORCE_INLINE double ch_distance(const ch_vec3& a, const ch_vec3& b) { return ch_length(a - b); }
+CH_FORCE_INLINE ch_vec3 ch_min(const ch_vec3& a, const ch_vec3& b) { return ch_vec3(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z); }
+CH_FORCE_INLINE ch_vec3 ch_max(const ch_vec3& a, const ch_vec3& b) { return ch_vec3(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z); }
+
+// unit vector along a, a itself if it is (almost) zero
+CH_FORCE_INLINE ch_vec3 ch_normalize(const ch_vec3& a)
+{
+	double length = ch_length(a);
+	return (length > SMALL_NUM) ? a * (1.0 / length) : a;
+}
+
+
+// 3x3 matrix stored by rows
+struct CH_ALIGN(32) ch_mat3
+{
+	ch_vec3 row[3];
+
+	CH_FORCE_INLINE ch_mat3() { row[0] = ch_vec3(1, 0, 0); row[1] = ch_vec3(0, 1, 0); row[2] = ch_vec3(0, 0, 1); }
+
+	CH_FORCE_INLINE double operator()(int r, int c) const { return row[r][c]; }
+	CH_FORCE_INLINE double& operator()(int r, int c) { return row[r][c]; }
+};
+
+CH_FORCE_INLINE ch_vec3 operator*(const ch_mat3& m, const ch_vec3& v) { return ch_vec3(ch_dot(m.row[0], v), ch_dot(m.row[1], v), ch_dot(m.row[2], v)); }
+
+CH_FORCE_INLINE ch_mat3 ch_transpose(const ch_mat3& m)
+{
+	ch_mat3 t;
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < 3; c++)
+			t.row[r][c] = m.row[c][r];
+	return t;
+}
+
+CH_FORCE_INLINE ch_mat3 operator*(const ch_mat3& a, const ch_mat3& b)
+{
+	ch_mat3 bt = ch_transpose(b), p;
+	for (int r = 0; r < 3; r++)
+		p.row[r] = ch_vec3(ch_dot(a.row[r], bt.row[0]), ch_dot(a.row[r], bt.row[1]), ch_dot(a.row[r], bt.row[2]));
+	return p;
+}
+
+
+// index of the lowest set bit of a non-zero mask (de Bruijn multiplication, no intrinsics needed)
+CH_FORCE_INLINE int ch_lowestBitIndex(unsigned long long mask)
+{
+	static const int table[64] = {
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6 };
+	return table[((mask & (0 - mask)) * 0x03f79d71b4cb0a89ULL) >> 58];
+}
+
+
+// 32 byte aligned heap blocks
+inline void* ch_alignedMalloc(std::size_t size)
+{
+	void* p = 0;
+#if defined(_MSC_VER)
+	p = _aligned_malloc(size, 32);
+#else
+	if (posix_memalign(&p, 32, size) != 0)
+		p = 0;
+#endif
+	if (!p && size)
+		throw std::bad_alloc();
+	return p;
+}
+
+inline void ch_alignedFree(void* p)
+{
+#if defined(_MSC_VER)
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+// put in the public section of classes with aligned members that are created with new, the default
+// operator new only guarantees 8 or 16 bytes
+#define CH_ALIGNED_OPERATOR_NEW \
+	void* operator new(std::size_t size) { return ch_alignedMalloc(size); } \
+	void* operator new[](std::size_t size) { return ch_alignedMalloc(size); } \
+	void operator delete(void* p) { ch_alignedFree(p); } \
+	void operator delete[](void* p) { ch_alignedFree(p); }
+
+
+// allocator that honours the 32 byte alignment in standard containers
+template <class T>
+class ch_alignedAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template <class U> struct rebind { typedef ch_alignedAllocator<U> other; };
+
+	ch_alignedAllocator() {}
+	template <class U> ch_alignedAllocator(const ch_alignedAllocator<U>&) {}
+
+	pointer address(reference r) const { return &r; }
+	const_pointer address(const_reference r) const { return &r; }
+	size_type max_size() const { return ((size_type)-1) / sizeof(T); }
+
+	pointer allocate(size_type n, const void* = 0) { return (pointer)ch_alignedMalloc(n * sizeof(T)); }
+	void deallocate(pointer p, size_type) { ch_alignedFree(p); }
+
+	void construct(pointer p, const T& value) { new ((void*)p) T(value); }
+	void destroy(pointer p) { p->~T(); }
+
+	template <class U> bool operator==(const ch_alignedAllocator<U>&) const { return true; }
+	template <class U> bool operator!=(const ch_alignedAllocator<U>&) const { return false; }
+};
+
+#endif
@@ -0,0 +1,554 @@
+#include "ch_meshDecimator.h"
+
+// system includes
+#include <algorithm>
+
+
+// orders vertices by their weld cell
+struct ch_weldLess
+{
+	const vector<long long>* cells;
+
+	bool operator()(unsigned int a, unsigned int b) const
+	{
+		const long long* ca = &(*cells)[3 * a];
+		const long long* cb = &(*cells)[3 * b];
+		if (ca[0] != cb[0]) return ca[0] < cb[0];
+		if (ca[1] != cb[1]) return ca[1] < cb[1];
+		if (ca[2] != cb[2]) return ca[2] < cb[2];
+		return a < b;
+	}
+};
+
+
+// constructor
+ch_meshDecimator::ch_meshDecimator()
+{
+	markStamp = 0;
+	maxError = 0.0;
+	lengthWeight = 0.0;
+}
+
+
+// decimate a triangle mesh
+void ch_meshDecimator::ch_decimate(const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& vertices, const vector<unsigned int>& indices, double tolerance, unsigned int minTriangles, double weldDistance)
+{
+	unsigned int numFaces = (unsigned int)(indices.size() / 3);
+
+	ch_weld(vertices, indices, weldDistance);
+
+	unsigned int numVertices = (unsigned int)positions.size();
+	quadrics.assign(numVertices, ch_quadric());
+	for (unsigned int v = 0; v < numVertices; v++)
+	{
+		ch_quadric& q = quadrics[v];
+		q.a00 = q.a01 = q.a02 = q.a11 = q.a12 = q.a22 = q.b0 = q.b1 = q.b2 = q.c = 0.0;
+	}
+	vertexFaces.assign(numVertices, vector<unsigned int>());
+	vertexVersion.assign(numVertices, 0);
+	vertexAlive.assign(numVertices, 1);
+	mark.assign(numVertices, 0);
+	markStamp = 0;
+	faceAlive.assign(numFaces, 1);
+	faceOwner.resize(numFaces);
+	maxError = 0.0;
+
+	// every vertex starts with the planes of its triangles. triangles that the weld made degenerate are
+	// dropped, they have no proxy triangle
+	unsigned int numAlive = 0;
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		const unsigned int* corner = &faces[3 * f];
+		ch_vec3 n = ch_cross(positions[corner[1]] - positions[corner[0]], positions[corner[2]] - positions[corner[0]]);
+
+		if (corner[0] == corner[1] || corner[1] == corner[2] || corner[2] == corner[0] || ch_length(n) < SMALL_NUM * SMALL_NUM)
+		{
+			faceAlive[f] = 0;
+			faceOwner[f] = -1;
+			continue;
+		}
+
+		n = ch_normalize(n);
+		for (int k = 0; k < 3; k++)
+		{
+			ch_addPlane(quadrics[corner[k]], n, ch_dot(n, positions[corner[0]]));
+			vertexFaces[corner[k]].push_back(f);
+		}
+		faceOwner[f] = (int)f;
+		numAlive++;
+	}
+
+	// open edges get a plane across them, so that the boundary does not move inwards
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		if (!faceAlive[f])
+			continue;
+
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = faces[3 * f + k], b = faces[3 * f + (k + 1) % 3];
+			unsigned int shared = 0;
+			for (unsigned int i = 0; i < vertexFaces[a].size(); i++)
+			{
+				const unsigned int* corner = &faces[3 * vertexFaces[a][i]];
+				if (corner[0] == b || corner[1] == b || corner[2] == b)
+					shared++;
+			}
+			if (shared == 1)
+			{
+				ch_vec3 across = ch_normalize(ch_cross(positions[b] - positions[a], ch_faceNormal(f)));
+				ch_addPlane(quadrics[a], across, ch_dot(across, positions[a]));
+				ch_addPlane(quadrics[b], across, ch_dot(across, positions[a]));
+			}
+		}
+	}
+
+	// the length only breaks ties: for the longest edges it is a thousandth of the tolerance
+	ch_aabb bounds;
+	for (unsigned int v = 0; v < numVertices; v++)
+		bounds.ch_extend(positions[v]);
+	double diagonal = bounds.ch_isEmpty() ? 0.0 : ch_lengthSq(bounds.ch_extent());
+	lengthWeight = (diagonal > 0.0) ? 0.001 * tolerance * tolerance / diagonal : 0.0;
+
+	// cheapest collapse first; entries of vertices that changed since they were queued are skipped
+	vector<ch_edgeCollapse> heap;
+	for (unsigned int v = 0; v < numVertices; v++)
+		ch_pushEdges(v, heap);
+
+	double maxCost = tolerance * tolerance;
+	while (!heap.empty() && numAlive > minTriangles + 1)
+	{
+		pop_heap(heap.begin(), heap.end());
+		ch_edgeCollapse edge = heap.back();
+		heap.pop_back();
+
+		if (!vertexAlive[edge.u] || !vertexAlive[edge.v] || vertexVersion[edge.u] != edge.versionU || vertexVersion[edge.v] != edge.versionV)
+			continue;
+		if (edge.cost > maxCost)
+			continue;
+
+		ch_vec3 target;
+		ch_collapseCost(edge.u, edge.v, target);
+		if (!ch_canCollapse(edge.u, edge.v, target))
+			continue;
+
+		numAlive -= ch_collapse(edge.u, edge.v, target);
+		maxError = max(maxError, sqrt(max(edge.cost, 0.0)));
+
+		ch_pushEdges(edge.u, heap);
+	}
+
+	// compact the result
+	vector<int> vertexIndex(numVertices, -1);
+	vector<int> faceIndex(numFaces, -1);
+	proxyVertices.clear();
+	proxyIndices.clear();
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		if (!faceAlive[f])
+			continue;
+
+		faceIndex[f] = (int)(proxyIndices.size() / 3);
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = faces[3 * f + k];
+			if (vertexIndex[v] < 0)
+			{
+				vertexIndex[v] = (int)proxyVertices.size();
+				proxyVertices.push_back(positions[v]);
+			}
+			proxyIndices.push_back((unsigned int)vertexIndex[v]);
+		}
+	}
+
+	// visual to proxy triangles: the triangle that took the place of a removed one, or a neighbour of it
+	// that is closer and faces the same way (the chain of replacements drifts around sharp edges)
+	unsigned int numProxy = (unsigned int)(proxyIndices.size() / 3);
+	unsigned int numProxyVertices = (unsigned int)proxyVertices.size();
+	vector<unsigned int> ringStart(numProxyVertices + 1, 0), ring(proxyIndices.size());
+	for (unsigned int i = 0; i < proxyIndices.size(); i++)
+		ringStart[proxyIndices[i] + 1]++;
+	for (unsigned int v = 0; v < numProxyVertices; v++)
+		ringStart[v + 1] += ringStart[v];
+	vector<unsigned int> ringFill(ringStart.begin(), ringStart.end() - 1);
+	for (unsigned int i = 0; i < proxyIndices.size(); i++)
+		ring[ringFill[proxyIndices[i]]++] = i / 3;
+
+	visualToProxy.assign(numFaces, -1);
+	proxyVisualStart.assign(numProxy + 1, 0);
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		if (faceOwner[f] < 0 || faceIndex[ch_findOwner(f)] < 0)
+			continue;
+
+		const ch_vec3& a = vertices[indices[3 * f]];
+		const ch_vec3& b = vertices[indices[3 * f + 1]];
+		const ch_vec3& c = vertices[indices[3 * f + 2]];
+		ch_vec3 centroid = (a + b + c) * (1.0 / 3.0);
+		ch_vec3 normal = ch_normalize(ch_cross(b - a, c - a));
+
+		int owner = faceIndex[ch_findOwner(f)];
+		int best = owner;
+		double bestScore = 1e300;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = proxyIndices[3 * owner + k];
+			for (unsigned int i = ringStart[v]; i < ringStart[v + 1]; i++)
+			{
+				const unsigned int* corner = &proxyIndices[3 * ring[i]];
+				const ch_vec3& p0 = proxyVertices[corner[0]];
+				const ch_vec3& p1 = proxyVertices[corner[1]];
+				const ch_vec3& p2 = proxyVertices[corner[2]];
+
+				// facing the other way counts as far away
+				double score = ch_distance(centroid, ch_closestPointOnTriangle(centroid, p0, p1, p2));
+				if (ch_dot(normal, ch_normalize(ch_cross(p1 - p0, p2 - p0))) < CH_DECIMATE_MIN_NORMAL_DOT)
+					score += 1e100;
+				if (score < bestScore)
+				{
+					bestScore = score;
+					best = (int)ring[i];
+				}
+			}
+		}
+
+		visualToProxy[f] = best;
+		proxyVisualStart[best + 1]++;
+	}
+	for (unsigned int p = 0; p < numProxy; p++)
+		proxyVisualStart[p + 1] += proxyVisualStart[p];
+
+	proxyVisualTriangles.resize(proxyVisualStart[numProxy]);
+	vector<unsigned int> fill(proxyVisualStart.begin(), proxyVisualStart.end() - 1);
+	for (unsigned int f = 0; f < numFaces; f++)
+	{
+		if (visualToProxy[f] >= 0)
+			proxyVisualTriangles[fill[visualToProxy[f]]++] = f;
+	}
+
+	// the working mesh is not needed any more
+	positions.clear();
+	quadrics.clear();
+	faces.clear();
+	faceAlive.clear();
+	vertexFaces.clear();
+	vertexVersion.clear();
+	vertexAlive.clear();
+	faceOwner.clear();
+	mark.clear();
+}
+
+
+// merge vertices closer than weldDistance
+void ch_meshDecimator::ch_weld(const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& vertices, const vector<unsigned int>& indices, double weldDistance)
+{
+	unsigned int numVertices = (unsigned int)vertices.size();
+	double scale = 1.0 / max(weldDistance, SMALL_NUM * SMALL_NUM);
+
+	// vertices in the same cell of size weldDistance are merged, in practice exact copies
+	vector<long long> cells(3 * numVertices);
+	vector<unsigned int> order(numVertices);
+	for (unsigned int v = 0; v < numVertices; v++)
+	{
+		for (int k = 0; k < 3; k++)
+			cells[3 * v + k] = (long long)floor(vertices[v][k] * scale + 0.5);
+		order[v] = v;
+	}
+
+	ch_weldLess less;
+	less.cells = &cells;
+	sort(order.begin(), order.end(), less);
+
+	vector<unsigned int> welded(numVertices);
+	positions.clear();
+	for (unsigned int i = 0; i < numVertices; i++)
+	{
+		const long long* cell = &cells[3 * order[i]];
+		const long long* previous = (i > 0) ? &cells[3 * order[i - 1]] : NULL;
+		if (!previous || cell[0] != previous[0] || cell[1] != previous[1] || cell[2] != previous[2])
+			positions.push_back(vertices[order[i]]);
+		welded[order[i]] = (unsigned int)positions.size() - 1;
+	}
+
+	faces.resize(indices.size());
+	for (unsigned int i = 0; i < indices.size(); i++)
+		faces[i] = welded[indices[i]];
+}
+
+
+// add the plane n.x = d to a quadric
+void ch_meshDecimator::ch_addPlane(ch_quadric& q, const ch_vec3& n, double d)
+{
+	q.a00 += n.x * n.x; q.a01 += n.x * n.y; q.a02 += n.x * n.z;
+	q.a11 += n.y * n.y; q.a12 += n.y * n.z; q.a22 += n.z * n.z;
+	q.b0 -= d * n.x; q.b1 -= d * n.y; q.b2 -= d * n.z;
+	q.c += d * d;
+}
+
+
+// value of a quadric at x
+double ch_meshDecimator::ch_evaluate(const ch_quadric& q, const ch_vec3& x)
+{
+	return q.a00 * x.x * x.x + q.a11 * x.y * x.y + q.a22 * x.z * x.z
+		+ 2.0 * (q.a01 * x.x * x.y + q.a02 * x.x * x.z + q.a12 * x.y * x.z)
+		+ 2.0 * (q.b0 * x.x + q.b1 * x.y + q.b2 * x.z) + q.c;
+}
+
+
+// cheapest position for the collapse of edge (u, v) and its cost
+double ch_meshDecimator::ch_collapseCost(unsigned int u, unsigned int v, ch_vec3& target) const
+{
+	const ch_quadric& qu = quadrics[u];
+	const ch_quadric& qv = quadrics[v];
+	ch_quadric q;
+	q.a00 = qu.a00 + qv.a00; q.a01 = qu.a01 + qv.a01; q.a02 = qu.a02 + qv.a02;
+	q.a11 = qu.a11 + qv.a11; q.a12 = qu.a12 + qv.a12; q.a22 = qu.a22 + qv.a22;
+	q.b0 = qu.b0 + qv.b0; q.b1 = qu.b1 + qv.b1; q.b2 = qu.b2 + qv.b2;
+	q.c = qu.c + qv.c;
+
+	// the minimum of the quadric solves A x = -b, unless the planes are (almost) parallel
+	double c00 = q.a11 * q.a22 - q.a12 * q.a12;
+	double c01 = q.a02 * q.a12 - q.a01 * q.a22;
+	double c02 = q.a01 * q.a12 - q.a02 * q.a11;
+	double det = q.a00 * c00 + q.a01 * c01 + q.a02 * c02;
+	double trace = q.a00 + q.a11 + q.a22;
+
+	const ch_vec3& pu = positions[u];
+	const ch_vec3& pv = positions[v];
+	ch_vec3 mid = (pu + pv) * 0.5;
+
+	target = mid;
+	double cost = ch_evaluate(q, mid);
+
+	if (fabs(det) > 1e-6 * trace * trace * trace)
+	{
+		double c11 = q.a00 * q.a22 - q.a02 * q.a02;
+		double c12 = q.a02 * q.a01 - q.a00 * q.a12;
+		double c22 = q.a00 * q.a11 - q.a01 * q.a01;
+		double inv = -1.0 / det;
+		ch_vec3 x((c00 * q.b0 + c01 * q.b1 + c02 * q.b2) * inv, (c01 * q.b0 + c11 * q.b1 + c12 * q.b2) * inv, (c02 * q.b0 + c12 * q.b1 + c22 * q.b2) * inv);
+
+		// an optimum far off the edge comes from nearly parallel planes, the end points are safer
+		if (ch_distanceSq(x, mid) <= ch_distanceSq(pu, pv))
+		{
+			double c = ch_evaluate(q, x);
+			if (c < cost)
+			{
+				target = x;
+				cost = c;
+			}
+		}
+	}
+
+	double cu = ch_evaluate(q, pu);
+	if (cu < cost)
+	{
+		target = pu;
+		cost = cu;
+	}
+	double cv = ch_evaluate(q, pv);
+	if (cv < cost)
+	{
+		target = pv;
+		cost = cv;
+	}
+
+	return cost;
+}
+
+
+// would collapsing (u, v) onto target keep the mesh manifold and without flipped triangles?
+bool ch_meshDecimator::ch_canCollapse(unsigned int u, unsigned int v, const ch_vec3& target)
+{
+	// link condition: the vertices next to both u and v are exactly the third corners of the triangles on the edge
+	markStamp++;
+	unsigned int numEdgeFaces = 0;
+	for (unsigned int i = 0; i < vertexFaces[u].size(); i++)
+	{
+		const unsigned int* corner = &faces[3 * vertexFaces[u][i]];
+		bool onEdge = (corner[0] == v || corner[1] == v || corner[2] == v);
+		numEdgeFaces += onEdge ? 1 : 0;
+		for (int k = 0; k < 3; k++)
+			mark[corner[k]] = markStamp;
+	}
+
+	unsigned int numShared = 0;
+	markStamp++;
+	for (unsigned int i = 0; i < vertexFaces[v].size(); i++)
+	{
+		const unsigned int* corner = &faces[3 * vertexFaces[v][i]];
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int w = corner[k];
+			if (w != u && w != v && mark[w] == markStamp - 1)
+			{
+				mark[w] = markStamp;
+				numShared++;
+			}
+		}
+	}
+	if (numEdgeFaces == 0 || numShared != numEdgeFaces)
+		return false;
+
+	// the triangles that remain must not flip or collapse
+	for (int side = 0; side < 2; side++)
+	{
+		unsigned int moved = side ? v : u;
+		unsigned int other = side ? u : v;
+		for (unsigned int i = 0; i < vertexFaces[moved].size(); i++)
+		{
+			unsigned int f = vertexFaces[moved][i];
+			const unsigned int* corner = &faces[3 * f];
+			if (corner[0] == other || corner[1] == other || corner[2] == other)
+				continue;
+
+			ch_vec3 p[3];
+			for (int k = 0; k < 3; k++)
+				p[k] = (corner[k] == moved) ? target : positions[corner[k]];
+
+			ch_vec3 n = ch_cross(p[1] - p[0], p[2] - p[0]);
+			double length = ch_length(n);
+			if (length < SMALL_NUM * SMALL_NUM || ch_dot(n, ch_faceNormal(f)) < CH_DECIMATE_MIN_NORMAL_DOT * length)
+				return false;
+		}
+	}
+	return true;
+}
+
+
+// collapse v into u at target
+unsigned int ch_meshDecimator::ch_collapse(unsigned int u, unsigned int v, const ch_vec3& target)
+{
+	vector<unsigned int> removed;
+
+	// triangles on the edge disappear, the others of v move to u
+	for (unsigned int i = 0; i < vertexFaces[v].size(); i++)
+	{
+		unsigned int f = vertexFaces[v][i];
+		unsigned int* corner = &faces[3 * f];
+		if (corner[0] == u || corner[1] == u || corner[2] == u)
+		{
+			faceAlive[f] = 0;
+			removed.push_back(f);
+		}
+		else
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				if (corner[k] == v)
+					corner[k] = u;
+			}
+			vertexFaces[u].push_back(f);
+		}
+	}
+
+	vector<unsigned int> kept;
+	for (unsigned int i = 0; i < vertexFaces[u].size(); i++)
+	{
+		if (faceAlive[vertexFaces[u][i]])
+			kept.push_back(vertexFaces[u][i]);
+	}
+	vertexFaces[u].swap(kept);
+	vertexFaces[v].clear();
+
+	// the third corners of the removed triangles lose them too
+	for (unsigned int r = 0; r < removed.size(); r++)
+	{
+		const unsigned int* corner = &faces[3 * removed[r]];
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int w = corner[k];
+			if (w == u || w == v)
+				continue;
+			vector<unsigned int>& list = vertexFaces[w];
+			list.erase(remove(list.begin(), list.end(), removed[r]), list.end());
+		}
+	}
+
+	positions[u] = target;
+	ch_quadric& qu = quadrics[u];
+	const ch_quadric& qv = quadrics[v];
+	qu.a00 += qv.a00; qu.a01 += qv.a01; qu.a02 += qv.a02;
+	qu.a11 += qv.a11; qu.a12 += qv.a12; qu.a22 += qv.a22;
+	qu.b0 += qv.b0; qu.b1 += qv.b1; qu.b2 += qv.b2;
+	qu.c += qv.c;
+
+	vertexAlive[v] = 0;
+	vertexVersion[u]++;
+	vertexVersion[v]++;
+
+	// a removed triangle is represented by the remaining one around u that faces the same way
+	for (unsigned int r = 0; r < removed.size(); r++)
+	{
+		ch_vec3 n = ch_faceNormal(removed[r]);
+		int best = -1;
+		double bestDot = -2.0;
+		for (unsigned int i = 0; i < vertexFaces[u].size(); i++)
+		{
+			double d = ch_dot(n, ch_faceNormal(vertexFaces[u][i]));
+			if (d > bestDot)
+			{
+				bestDot = d;
+				best = (int)vertexFaces[u][i];
+			}
+		}
+		faceOwner[removed[r]] = (best >= 0) ? best : -1;
+	}
+
+	return (unsigned int)removed.size();
+}
+
+
+// queue the edges around a vertex
+void ch_meshDecimator::ch_pushEdges(unsigned int u, vector<ch_edgeCollapse>& heap)
+{
+	markStamp++;
+	for (unsigned int i = 0; i < vertexFaces[u].size(); i++)
+	{
+		const unsigned int* corner = &faces[3 * vertexFaces[u][i]];
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = corner[k];
+			if (v == u || mark[v] == markStamp)
+				continue;
+			mark[v] = markStamp;
+
+			ch_edgeCollapse edge;
+			ch_vec3 target;
+			edge.cost = ch_collapseCost(u, v, target);
+			edge.priority = edge.cost + lengthWeight * ch_distanceSq(positions[u], positions[v]);
+			edge.u = u;
+			edge.v = v;
+			edge.versionU = vertexVersion[u];
+			edge.versionV = vertexVersion[v];
+			heap.push_back(edge);
+			push_heap(heap.begin(), heap.end());
+		}
+	}
+}
+
+
+// unit normal of a face
+ch_vec3 ch_meshDecimator::ch_faceNormal(unsigned int f) const
+{
+	const unsigned int* corner = &faces[3 * f];
+	return ch_normalize(ch_cross(positions[corner[1]] - positions[corner[0]], positions[corner[2]] - positions[corner[0]]));
+}
+
+
+// face that took the place of a removed face
+unsigned int ch_meshDecimator::ch_findOwner(unsigned int f)
+{
+	unsigned int root = f;
+	while (!faceAlive[root] && faceOwner[root] >= 0 && (unsigned int)faceOwner[root] != root)
+		root = (unsigned int)faceOwner[root];
+
+	// shorten the chain for the next lookups
+	while (f != root)
+	{
+		unsigned int next = (unsigned int)faceOwner[f];
+		faceOwner[f] = (int)root;
+		f = next;
+	}
+	return root;
+}
@@ -0,0 +1,130 @@
+#ifndef CH_MESHDECIMATOR_H
+#define CH_MESHDECIMATOR_H
+
+// CH lab
+// load-time quadric error decimation of a visual mesh into a coarser collision proxy. vertices are welded,
+// edges are collapsed cheapest first as long as the collapsed vertex stays within the tolerance of the
+// planes it replaces, and every visual triangle is mapped to the proxy triangle that took its place, eg.
+// to highlight what the haptic point touches on the visual mesh. no CHAI3D dependency
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_geometry.h"
+#include "ch_math.h"
+
+using namespace std;
+
+// collapses must not turn a triangle by more than this (cosine between old and new normal)
+#define CH_DECIMATE_MIN_NORMAL_DOT 0.5
+
+
+class ch_meshDecimator
+{
+public:
+
+	// constructor
+	ch_meshDecimator();
+
+	// destructor
+	virtual ~ch_meshDecimator() {};
+
+	// decimate the triangles (three vertex indices each) until the next collapse would move the surface by
+	// more than tolerance or leave fewer than minTriangles triangles. vertices closer than weldDistance
+	// are merged first, visual meshes often repeat them per triangle
+	void ch_decimate(const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& vertices, const vector<unsigned int>& indices, double tolerance, unsigned int minTriangles = 0, double weldDistance = SMALL_NUM);
+
+	// the proxy mesh
+	inline const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& ch_getVertices() const { return proxyVertices; }
+	inline const vector<unsigned int>& ch_getIndices() const { return proxyIndices; }
+	inline unsigned int ch_getNumTriangles() const { return (unsigned int)(proxyIndices.size() / 3); }
+
+	// proxy triangle that replaced a visual triangle, -1 for degenerate visual triangles
+	inline int ch_getProxyTriangle(unsigned int visualTriangle) const { return visualToProxy[visualTriangle]; }
+
+	// visual triangles [first, last) replaced by a proxy triangle
+	inline void ch_getVisualTriangles(unsigned int proxyTriangle, const unsigned int*& first, const unsigned int*& last) const
+	{
+		first = &proxyVisualTriangles[0] + proxyVisualStart[proxyTriangle];
+		last = &proxyVisualTriangles[0] + proxyVisualStart[proxyTriangle + 1];
+	}
+
+	// largest surface deviation [m] estimated from the quadrics of the collapses made
+	inline double ch_getMaxError() const { return maxError; }
+
+protected:
+
+	// sum of squared distances to a set of planes: x'Ax + 2b'x + c, A symmetric
+	struct ch_quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+	};
+
+	// edge waiting to be collapsed, valid while both vertices keep their versions. the queue is ordered by
+	// the cost plus a small share of the edge length, so that flat regions collapse evenly instead of into a
+	// few vertices with thousands of triangles
+	struct ch_edgeCollapse
+	{
+		double cost;
+		double priority;
+		unsigned int u, v;
+		unsigned int versionU, versionV;
+
+		bool operator<(const ch_edgeCollapse& other) const { return priority > other.priority; }
+	};
+
+	// merge vertices closer than weldDistance
+	void ch_weld(const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& vertices, const vector<unsigned int>& indices, double weldDistance);
+
+	// add the plane n.x = d to a quadric
+	static void ch_addPlane(ch_quadric& q, const ch_vec3& n, double d);
+
+	// value of a quadric at x
+	static double ch_evaluate(const ch_quadric& q, const ch_vec3& x);
+
+	// cheapest position for the collapse of edge (u, v) and its cost
+	double ch_collapseCost(unsigned int u, unsigned int v, ch_vec3& target) const;
+
+	// would collapsing (u, v) onto target keep the mesh manifold and without flipped triangles?
+	bool ch_canCollapse(unsigned int u, unsigned int v, const ch_vec3& target);
+
+	// collapse v into u at target, returns the number of triangles removed
+	unsigned int ch_collapse(unsigned int u, unsigned int v, const ch_vec3& target);
+
+	// queue the edges around a vertex
+	void ch_pushEdges(unsigned int u, vector<ch_edgeCollapse>& heap);
+
+	// unit normal of a face
+	ch_vec3 ch_faceNormal(unsigned int f) const;
+
+	// weight of the squared edge length in the queue order
+	double lengthWeight;
+
+	// face that took the place of a removed face
+	unsigned int ch_findOwner(unsigned int f);
+
+	// working mesh
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > positions;
+	vector<ch_quadric> quadrics;
+	vector<unsigned int> faces;
+	vector<unsigned char> faceAlive;
+	vector<vector<unsigned int> > vertexFaces;
+	vector<unsigned int> vertexVersion;
+	vector<unsigned char> vertexAlive;
+	vector<int> faceOwner;
+	vector<unsigned int> mark;
+	unsigned int markStamp;
+
+	// result
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > proxyVertices;
+	vector<unsigned int> proxyIndices;
+	vector<int> visualToProxy;
+	vector<unsigned int> proxyVisualStart;
+	vector<unsigned int> proxyVisualTriangles;
+	double maxError;
+};
+
+#endif
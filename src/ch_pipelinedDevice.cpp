@@ -0,0 +1,123 @@
+#include "ch_pipelinedDevice.h"
+
+
+// constructor
+ch_pipelinedDevice::ch_pipelinedDevice(cGenericHapticDevicePtr device) : device(device)
+{
+	m_specifications = device->getSpecifications();
+}
+
+
+// destructor
+ch_pipelinedDevice::~ch_pipelinedDevice()
+{
+	io.ch_stop();
+}
+
+
+// open the device
+bool ch_pipelinedDevice::open()
+{
+	return device->open();
+}
+
+
+// calibrate the device
+bool ch_pipelinedDevice::calibrate(bool a_forceCalibration)
+{
+	if (io.ch_isRunning())
+		return C_ERROR;
+	return device->calibrate(a_forceCalibration);
+}
+
+
+// stop the worker and close the device
+bool ch_pipelinedDevice::close()
+{
+	io.ch_stop();
+	return device->close();
+}
+
+
+// start the worker
+bool ch_pipelinedDevice::ch_start()
+{
+	// the worker holds its own reference, the tool may drop the device before stopping it
+	cGenericHapticDevicePtr target = device;
+
+	ch_deviceIO::ch_readFunction read = [target](ch_vec3& position, unsigned int& switches)
+	{
+		cVector3d p;
+		bool ok = target->getPosition(p);
+		ok = target->getUserSwitches(switches) && ok;
+		position = ch_toVec3(p);
+		return ok;
+	};
+
+	ch_deviceIO::ch_writeFunction write = [target](const ch_vec3& force)
+	{
+		return target->setForce(ch_toCVector3d(force));
+	};
+
+	if (!io.ch_start(read, write))
+		return C_ERROR;
+
+	// the first reading, so that the tool never sees an empty one
+	io.ch_waitForSample(1.0);
+	return C_SUCCESS;
+}
+
+
+// position of the current reading
+bool ch_pipelinedDevice::getPosition(cVector3d& a_position)
+{
+	if (!io.ch_isRunning())
+		return device->getPosition(a_position);
+
+	a_position = ch_toCVector3d(io.ch_getSample().position);
+	return C_SUCCESS;
+}
+
+
+// the Falcon does not turn
+bool ch_pipelinedDevice::getRotation(cMatrix3d& a_rotation)
+{
+	if (!io.ch_isRunning())
+		return device->getRotation(a_rotation);
+
+	a_rotation.identity();
+	return C_SUCCESS;
+}
+
+
+// nor has it a gripper
+bool ch_pipelinedDevice::getGripperAngleRad(double& a_angle)
+{
+	if (!io.ch_isRunning())
+		return device->getGripperAngleRad(a_angle);
+
+	a_angle = 0.0;
+	return C_SUCCESS;
+}
+
+
+// switches of the current reading
+bool ch_pipelinedDevice::getUserSwitches(unsigned int& a_userSwitches)
+{
+	if (!io.ch_isRunning())
+		return device->getUserSwitches(a_userSwitches);
+
+	a_userSwitches = io.ch_getSample().switches;
+	return C_SUCCESS;
+}
+
+
+// queue the force
+bool ch_pipelinedDevice::setForceAndTorqueAndGripperForce(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce)
+{
+	if (!io.ch_isRunning())
+		return device->setForceAndTorqueAndGripperForce(a_force, a_torque, a_gripperForce);
+
+	io.ch_setForce(ch_toVec3(a_force));
+	return C_SUCCESS;
+}
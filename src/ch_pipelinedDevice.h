@@ -0,0 +1,71 @@
+#ifndef CH_PIPELINEDDEVICE_H
+#define CH_PIPELINEDDEVICE_H
+
+// CH lab
+// CHAI3D haptic device whose transfers run on a ch_deviceIO worker. it wraps the real device and is given
+// to the tool instead of it: updateFromDevice() reads the reading taken by ch_waitForSample() and
+// applyToDevice() queues the force, neither waits on USB. the Falcon has no orientation or gripper, only
+// position, switches and force go through the worker
+
+// CHAI3D includes
+#include "chai3d.h"
+
+// local includes
+#include "ch_chai3dAdapters.h"
+#include "ch_deviceIO.h"
+
+using namespace chai3d;
+using namespace std;
+
+
+class ch_pipelinedDevice : public cGenericHapticDevice
+{
+public:
+
+	// the worker buffers are 32 byte aligned
+	CH_ALIGNED_OPERATOR_NEW
+
+	// constructor, on a device the tool would otherwise use
+	ch_pipelinedDevice(cGenericHapticDevicePtr device);
+
+	// destructor
+	virtual ~ch_pipelinedDevice();
+
+	// open and calibrate the device, before ch_start()
+	virtual bool open();
+	virtual bool calibrate(bool a_forceCalibration = false);
+
+	// stop the worker and close the device
+	virtual bool close();
+
+	// start the worker. until then every call goes to the device directly
+	bool ch_start();
+
+	// is the worker running?
+	inline bool ch_isRunning() const { return io.ch_isRunning(); }
+
+	// haptic thread, once per tick: take the next reading, waiting at most timeout [s] for it
+	inline bool ch_waitForSample(double timeout) { return io.ch_waitForSample(timeout); }
+
+	// when the current reading was taken [s]
+	inline double ch_getSampleTime() const { return io.ch_getSample().time; }
+
+	// the worker, for its statistics
+	inline const ch_deviceIO& ch_getIO() const { return io; }
+
+	// the current reading
+	virtual bool getPosition(cVector3d& a_position);
+	virtual bool getRotation(cMatrix3d& a_rotation);
+	virtual bool getGripperAngleRad(double& a_angle);
+	virtual bool getUserSwitches(unsigned int& a_userSwitches);
+
+	// queue the force for the next transfer, torque and gripper force are ignored
+	virtual bool setForceAndTorqueAndGripperForce(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce);
+
+protected:
+
+	cGenericHapticDevicePtr device;
+	ch_deviceIO io;
+};
+
+#endif
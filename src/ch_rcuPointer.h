@@ -0,0 +1,144 @@
+#ifndef CH_RCUPOINTER_H
+#define CH_RCUPOINTER_H
+
+// CH lab
+// pointer to an object that a writer replaces while reader threads keep using it (read-copy-update). readers
+// never lock, wait or free: every ch_acquire() announces the current epoch and returns the latest object, which
+// stays valid until the reader's next ch_acquire(). the writer deletes a replaced object only once every reader
+// has announced an epoch after the replacement
+
+// system includes
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// number of reader threads
+#define CH_RCU_MAX_READERS 4
+
+
+template <class T>
+class ch_rcuPointer
+{
+public:
+
+	// constructor
+	ch_rcuPointer() : current((T*)0), epoch(1), numReaders(0)
+	{
+		for (int i = 0; i < CH_RCU_MAX_READERS; i++)
+			readerEpochs[i].store(OFFLINE);
+	}
+
+	// destructor, the readers must have stopped
+	virtual ~ch_rcuPointer()
+	{
+		delete current.load();
+		for (unsigned int i = 0; i < retired.size(); i++)
+			delete retired[i].object;
+	}
+
+	// register a reader thread, returns its slot or -1 if all are taken. the reader holds nothing until its
+	// first ch_acquire()
+	inline int ch_registerReader()
+	{
+		int reader = numReaders.fetch_add(1);
+		return (reader < CH_RCU_MAX_READERS) ? reader : -1;
+	}
+
+	// reader: the latest published object or NULL, valid until this reader's next ch_acquire() or
+	// ch_goOffline(). the loop only repeats if the writer published in between
+	inline T* ch_acquire(int reader)
+	{
+		unsigned long long seen = epoch.load();
+		for (;;)
+		{
+			readerEpochs[reader].store(seen);
+			unsigned long long again = epoch.load();
+			if (again == seen)
+				break;
+			seen = again;
+		}
+		return current.load();
+	}
+
+	// reader: stop holding the object, eg. when the reader thread ends
+	inline void ch_goOffline(int reader) { readerEpochs[reader].store(OFFLINE); }
+
+	// writer: replace the object, the replaced one is deleted by a later ch_publish() or ch_reclaim() once no
+	// reader can hold it. takes ownership of object
+	void ch_publish(T* object)
+	{
+		lock_guard<mutex> lock(writerMutex);
+
+		T* replaced = current.exchange(object);
+		unsigned long long retiredAt = epoch.fetch_add(1) + 1;
+		if (replaced)
+		{
+			ch_retired entry = { replaced, retiredAt };
+			retired.push_back(entry);
+		}
+		ch_reclaimLocked();
+	}
+
+	// writer: delete the replaced objects no reader can hold any more, returns the number still waiting
+	unsigned int ch_reclaim()
+	{
+		lock_guard<mutex> lock(writerMutex);
+		return ch_reclaimLocked();
+	}
+
+	// writer: the latest published object
+	inline T* ch_getCurrent() const { return current.load(); }
+
+protected:
+
+	// announced epoch of a reader that holds nothing
+	static const unsigned long long OFFLINE = ~0ull;
+
+	// a replaced object and the epoch its replacement was published in
+	struct ch_retired
+	{
+		T* object;
+		unsigned long long epoch;
+	};
+
+	// delete what every reader has moved past, writerMutex held
+	unsigned int ch_reclaimLocked()
+	{
+		// a reader that announced epoch e acquired after every replacement up to e
+		unsigned long long oldest = OFFLINE;
+		for (int i = 0; i < CH_RCU_MAX_READERS; i++)
+		{
+			unsigned long long announced = readerEpochs[i].load();
+			if (announced < oldest)
+				oldest = announced;
+		}
+
+		unsigned int kept = 0;
+		for (unsigned int i = 0; i < retired.size(); i++)
+		{
+			if (retired[i].epoch <= oldest)
+				delete retired[i].object;
+			else
+				retired[kept++] = retired[i];
+		}
+		retired.resize(kept);
+		return kept;
+	}
+
+	atomic<T*> current;
+
+	// incremented by every ch_publish()
+	atomic<unsigned long long> epoch;
+
+	// epoch each reader announced in its last ch_acquire()
+	atomic<unsigned long long> readerEpochs[CH_RCU_MAX_READERS];
+	atomic<int> numReaders;
+
+	// writer side only
+	mutex writerMutex;
+	vector<ch_retired> retired;
+};
+
+#endif
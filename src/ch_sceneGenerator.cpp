@@ -0,0 +1,314 @@
+#include "ch_sceneGenerator.h"
+
+// system includes
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <unordered_map>
+
+// not every compiler defines M_PI
+#define CH_PI 3.14159265358979323846
+
+// waves summed for the terrain
+#define CH_TERRAIN_WAVES 12
+
+// highest point of the terrain above its mean, and wall thickness of the shell [m]
+#define CH_TERRAIN_HEIGHT 0.15
+#define CH_SHELL_THICKNESS 0.01
+
+
+static const char* ch_sceneNames[CH_NUM_SCENE_TYPES] = { "icosphere", "terrain", "box", "shell", "soup" };
+
+
+// constructor
+ch_sceneGenerator::ch_sceneGenerator()
+{
+	state = 1;
+}
+
+
+// generate a mesh
+void ch_sceneGenerator::ch_generate(ch_sceneType type, unsigned int numTriangles, unsigned int seed)
+{
+	vertices.clear();
+	indices.clear();
+	state = seed;
+
+	switch (type)
+	{
+	case CH_SCENE_ICOSPHERE:	ch_generateIcosphere(numTriangles); break;
+	case CH_SCENE_TERRAIN:		ch_generateTerrain(numTriangles); break;
+	case CH_SCENE_BOX:			ch_generateBox(numTriangles); break;
+	case CH_SCENE_SHELL:		ch_generateShell(numTriangles); break;
+	case CH_SCENE_SOUP:			ch_generateSoup(numTriangles); break;
+	default: break;
+	}
+}
+
+
+// the mesh as triangles
+void ch_sceneGenerator::ch_getTriangles(ch_triangleArray& triangles) const
+{
+	triangles.resize(indices.size() / 3);
+	for (unsigned int i = 0; i < triangles.size(); i++)
+		ch_setTriangle(triangles[i], vertices[indices[3 * i]], vertices[indices[3 * i + 1]], vertices[indices[3 * i + 2]]);
+}
+
+
+// name of a type
+const char* ch_sceneGenerator::ch_getName(ch_sceneType type)
+{
+	return (type >= 0 && type < CH_NUM_SCENE_TYPES) ? ch_sceneNames[type] : "unknown";
+}
+
+
+// type of a name
+bool ch_sceneGenerator::ch_findType(const char* name, ch_sceneType& type)
+{
+	for (int i = 0; i < CH_NUM_SCENE_TYPES; i++)
+	{
+		if (strcmp(name, ch_sceneNames[i]) == 0)
+		{
+			type = (ch_sceneType)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// append a triangle facing outward
+void ch_sceneGenerator::ch_addTriangle(unsigned int a, unsigned int b, unsigned int c, const ch_vec3& outward)
+{
+	ch_vec3 normal = ch_cross(vertices[b] - vertices[a], vertices[c] - vertices[a]);
+	if (ch_dot(normal, outward) < 0.0)
+		swap(b, c);
+
+	indices.push_back(a);
+	indices.push_back(b);
+	indices.push_back(c);
+}
+
+
+// icosahedron on a sphere of radius 0.5, every triangle split in four per level: 20 4^level triangles
+void ch_sceneGenerator::ch_generateIcosphere(unsigned int numTriangles)
+{
+	// the level whose triangle count is nearest on a log scale
+	unsigned int levels = 0;
+	while (levels < 12 && 20.0 * pow(4.0, levels + 0.5) < numTriangles)
+		levels++;
+
+	const double t = (1.0 + sqrt(5.0)) / 2.0;
+	const double corners[12][3] = { { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 }, { 0, -1, t }, { 0, 1, t },
+		{ 0, -1, -t }, { 0, 1, -t }, { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+	const unsigned int faces[20][3] = { { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 }, { 1, 5, 9 }, { 5, 11, 4 },
+		{ 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 }, { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 }, { 4, 9, 5 },
+		{ 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 } };
+
+	vertices.reserve(10 * (size_t)pow(4.0, levels) + 2);
+	for (int i = 0; i < 12; i++)
+		ch_addVertex(ch_normalize(ch_vec3(corners[i][0], corners[i][1], corners[i][2])) * 0.5);
+
+	vector<unsigned int> level(faces[0], faces[0] + 60), next;
+	unordered_map<unsigned long long, unsigned int> midpoints;
+	for (unsigned int l = 0; l < levels; l++)
+	{
+		// edges are shared by two triangles, their midpoints are made once
+		midpoints.clear();
+		next.clear();
+		next.reserve(4 * level.size());
+		for (unsigned int i = 0; i < level.size(); i += 3)
+		{
+			unsigned int m[3];
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int a = level[i + k], b = level[i + (k + 1) % 3];
+				unsigned long long key = ((unsigned long long)min(a, b) << 32) | max(a, b);
+				unordered_map<unsigned long long, unsigned int>::iterator found = midpoints.find(key);
+				if (found == midpoints.end())
+					found = midpoints.insert(make_pair(key, ch_addVertex(ch_normalize(vertices[a] + vertices[b]) * 0.5))).first;
+				m[k] = found->second;
+			}
+
+			const unsigned int split[12] = { level[i], m[0], m[2], m[0], level[i + 1], m[1], m[2], m[1], level[i + 2], m[0], m[1], m[2] };
+			next.insert(next.end(), split, split + 12);
+		}
+		level.swap(next);
+	}
+
+	indices.reserve(level.size());
+	for (unsigned int i = 0; i < level.size(); i += 3)
+		ch_addTriangle(level[i], level[i + 1], level[i + 2], vertices[level[i]] + vertices[level[i + 1]] + vertices[level[i + 2]]);
+}
+
+
+// height field over [-0.5, 0.5]^2: n x n quads of two triangles, facing up
+void ch_sceneGenerator::ch_generateTerrain(unsigned int numTriangles)
+{
+	unsigned int n = max(1u, (unsigned int)floor(sqrt(numTriangles / 2.0) + 0.5));
+
+	// waves of rising frequency and falling amplitude in random directions
+	double waveX[CH_TERRAIN_WAVES], waveY[CH_TERRAIN_WAVES], phase[CH_TERRAIN_WAVES], amplitude[CH_TERRAIN_WAVES];
+	double sum = 0.0;
+	for (int k = 0; k < CH_TERRAIN_WAVES; k++)
+	{
+		double angle = 2.0 * CH_PI * ch_random01();
+		double frequency = 2.0 * CH_PI * (1.0 + 1.5 * k) * (0.75 + 0.5 * ch_random01());
+		waveX[k] = frequency * cos(angle);
+		waveY[k] = frequency * sin(angle);
+		phase[k] = 2.0 * CH_PI * ch_random01();
+		amplitude[k] = 1.0 / (1.0 + 0.5 * k);
+		sum += amplitude[k];
+	}
+
+	vertices.reserve((n + 1) * (n + 1));
+	for (unsigned int j = 0; j <= n; j++)
+	{
+		for (unsigned int i = 0; i <= n; i++)
+		{
+			double x = -0.5 + (double)i / n, y = -0.5 + (double)j / n, height = 0.0;
+			for (int k = 0; k < CH_TERRAIN_WAVES; k++)
+				height += amplitude[k] * sin(waveX[k] * x + waveY[k] * y + phase[k]);
+			ch_addVertex(ch_vec3(x, y, height * (CH_TERRAIN_HEIGHT / sum)));
+		}
+	}
+
+	const ch_vec3 up(0.0, 0.0, 1.0);
+	indices.reserve(6 * n * n);
+	for (unsigned int j = 0; j < n; j++)
+	{
+		for (unsigned int i = 0; i < n; i++)
+		{
+			unsigned int v00 = j * (n + 1) + i;
+			ch_addTriangle(v00, v00 + 1, v00 + n + 2, up);
+			ch_addTriangle(v00, v00 + n + 2, v00 + n + 1, up);
+		}
+	}
+}
+
+
+// box of edge 1, every face n x n cells with a vertex in the middle: 24 n^2 triangles, many of them in
+// one plane and all of them meeting at cell centers and corners
+void ch_sceneGenerator::ch_generateBox(unsigned int numTriangles)
+{
+	unsigned int n = max(1u, (unsigned int)floor(sqrt(numTriangles / 24.0) + 0.5));
+
+	vertices.reserve(6 * ((n + 1) * (n + 1) + n * n));
+	indices.reserve(72 * n * n);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int side = -1; side <= 1; side += 2)
+		{
+			int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			ch_vec3 outward;
+			outward[axis] = side;
+
+			// cell corners, then cell centers
+			unsigned int base = (unsigned int)vertices.size();
+			for (unsigned int j = 0; j <= n; j++)
+			{
+				for (unsigned int i = 0; i <= n; i++)
+				{
+					ch_vec3 p;
+					p[axis] = 0.5 * side;
+					p[u] = -0.5 + (double)i / n;
+					p[v] = -0.5 + (double)j / n;
+					ch_addVertex(p);
+				}
+			}
+
+			for (unsigned int j = 0; j < n; j++)
+			{
+				for (unsigned int i = 0; i < n; i++)
+				{
+					ch_vec3 p;
+					p[axis] = 0.5 * side;
+					p[u] = -0.5 + (i + 0.5) / n;
+					p[v] = -0.5 + (j + 0.5) / n;
+					unsigned int center = ch_addVertex(p);
+
+					unsigned int v00 = base + j * (n + 1) + i;
+					unsigned int corners[4] = { v00, v00 + 1, v00 + n + 2, v00 + n + 1 };
+					for (int k = 0; k < 4; k++)
+						ch_addTriangle(center, corners[k], corners[(k + 1) % 4], outward);
+				}
+			}
+		}
+	}
+}
+
+
+// bowl of radius 0.5 open at the top, the inner surface CH_SHELL_THICKNESS below the outer one and a rim
+// between them: latitude-longitude grids of m rings of 2m vertices, about 8 m^2 triangles
+void ch_sceneGenerator::ch_generateShell(unsigned int numTriangles)
+{
+	unsigned int m = max(2u, (unsigned int)floor(sqrt(numTriangles / 8.0) + 0.5));
+	unsigned int around = 2 * m;
+	const double radius[2] = { 0.5, 0.5 - CH_SHELL_THICKNESS };
+
+	// pole and rings from the bottom up to the rim, outer surface first
+	unsigned int first[2];
+	for (int s = 0; s < 2; s++)
+	{
+		first[s] = ch_addVertex(ch_vec3(0.0, 0.0, -radius[s]));
+		for (unsigned int k = 1; k <= m; k++)
+		{
+			double theta = 0.5 * CH_PI * k / m;
+			for (unsigned int i = 0; i < around; i++)
+			{
+				double phi = 2.0 * CH_PI * i / around;
+				ch_addVertex(ch_vec3(radius[s] * sin(theta) * cos(phi), radius[s] * sin(theta) * sin(phi), -radius[s] * cos(theta)));
+			}
+		}
+	}
+
+	// the outer surface faces away from the center, the inner one towards it
+	for (int s = 0; s < 2; s++)
+	{
+		double sign = (s == 0) ? 1.0 : -1.0;
+		for (unsigned int i = 0; i < around; i++)
+		{
+			unsigned int j = (i + 1) % around;
+			ch_addTriangle(first[s], first[s] + 1 + i, first[s] + 1 + j, (vertices[first[s] + 1 + i] + vertices[first[s] + 1 + j]) * sign);
+
+			for (unsigned int k = 1; k < m; k++)
+			{
+				unsigned int a = first[s] + 1 + (k - 1) * around, b = a + around;
+				ch_addTriangle(a + i, b + i, b + j, (vertices[a + i] + vertices[b + j]) * sign);
+				ch_addTriangle(a + i, b + j, a + j, (vertices[a + i] + vertices[b + j]) * sign);
+			}
+		}
+	}
+
+	// rim between the top rings, facing up
+	const ch_vec3 up(0.0, 0.0, 1.0);
+	unsigned int outer = first[0] + 1 + (m - 1) * around, inner = first[1] + 1 + (m - 1) * around;
+	for (unsigned int i = 0; i < around; i++)
+	{
+		unsigned int j = (i + 1) % around;
+		ch_addTriangle(outer + i, outer + j, inner + j, up);
+		ch_addTriangle(outer + i, inner + j, inner + i, up);
+	}
+}
+
+
+// unconnected triangles with corners around random centers, sized so that the soup is about equally
+// dense at any count
+void ch_sceneGenerator::ch_generateSoup(unsigned int numTriangles)
+{
+	double size = 0.5 / cbrt((double)max(1u, numTriangles));
+
+	vertices.reserve(3 * numTriangles);
+	indices.reserve(3 * numTriangles);
+	for (unsigned int i = 0; i < numTriangles; i++)
+	{
+		ch_vec3 center(0.9 * (ch_random01() - 0.5), 0.9 * (ch_random01() - 0.5), 0.9 * (ch_random01() - 0.5));
+		for (int k = 0; k < 3; k++)
+			ch_addVertex(center + ch_vec3(ch_random01() - 0.5, ch_random01() - 0.5, ch_random01() - 0.5) * (2.0 * size));
+
+		unsigned int a = (unsigned int)vertices.size() - 3;
+		indices.push_back(a);
+		indices.push_back(a + 1);
+		indices.push_back(a + 2);
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef CH_SCENEGENERATOR_H
+#define CH_SCENEGENERATOR_H
+
+// CH lab
+// procedural test meshes of any size, to see how the collision queries and the haptic loop scale with the
+// number of triangles and with the shape of the mesh. every mesh fits the cube of edge 1 around the origin
+// and depends on nothing but its type, size and seed, on every platform. no CHAI3D dependency
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_geometry.h"
+#include "ch_math.h"
+
+using namespace std;
+
+
+// kinds of generated meshes
+enum ch_sceneType
+{
+	CH_SCENE_ICOSPHERE,		// subdivided icosahedron on a sphere, closed and nearly convex
+	CH_SCENE_TERRAIN,		// height field of random waves, an open sheet
+	CH_SCENE_BOX,			// box whose faces are grids of cells, each a fan of four coplanar triangles
+	CH_SCENE_SHELL,			// hemispherical bowl with a thin wall, two close surfaces facing apart
+	CH_SCENE_SOUP,			// unconnected triangles at random positions and orientations
+	CH_NUM_SCENE_TYPES
+};
+
+
+class ch_sceneGenerator
+{
+public:
+
+	// constructor
+	ch_sceneGenerator();
+
+	// destructor
+	virtual ~ch_sceneGenerator() {};
+
+	// generate a mesh of about numTriangles triangles, the icosphere takes the nearest subdivision level.
+	// the seed changes the terrain and the soup
+	void ch_generate(ch_sceneType type, unsigned int numTriangles, unsigned int seed = 1);
+
+	// the mesh, three vertex indices per triangle, counter-clockwise seen from outside
+	inline const vector<ch_vec3, ch_alignedAllocator<ch_vec3> >& ch_getVertices() const { return vertices; }
+	inline const vector<unsigned int>& ch_getIndices() const { return indices; }
+	inline unsigned int ch_getNumTriangles() const { return (unsigned int)(indices.size() / 3); }
+
+	// the mesh as triangles with their planes
+	void ch_getTriangles(ch_triangleArray& triangles) const;
+
+	// name of a type, eg. for the command line, and the type of a name; false for an unknown name
+	static const char* ch_getName(ch_sceneType type);
+	static bool ch_findType(const char* name, ch_sceneType& type);
+
+protected:
+
+	// the generators
+	void ch_generateIcosphere(unsigned int numTriangles);
+	void ch_generateTerrain(unsigned int numTriangles);
+	void ch_generateBox(unsigned int numTriangles);
+	void ch_generateShell(unsigned int numTriangles);
+	void ch_generateSoup(unsigned int numTriangles);
+
+	// append a vertex, returns its index
+	inline unsigned int ch_addVertex(const ch_vec3& p)
+	{
+		vertices.push_back(p);
+		return (unsigned int)vertices.size() - 1;
+	}
+
+	// append a triangle, turned so that its normal points along outward
+	void ch_addTriangle(unsigned int a, unsigned int b, unsigned int c, const ch_vec3& outward);
+
+	// uniform random number in [0, 1), the same sequence on every platform
+	inline double ch_random01()
+	{
+		state = state * 1664525u + 1013904223u;
+		return (state >> 8) / 16777216.0;
+	}
+
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > vertices;
+	vector<unsigned int> indices;
+
+	// random generator state
+	unsigned int state;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "ch_scenePreparation.h"
+
+// system includes
+#include <stdio.h>
+
+
+// constructor
+ch_collisionScene::ch_collisionScene()
+{
+	proxy = NULL;
+	checker = NULL;
+	world = NULL;
+	tool = 0;
+}
+
+
+// destructor
+ch_collisionScene::~ch_collisionScene()
+{
+	delete world;
+	delete checker;
+	delete proxy;
+}
+
+
+// constructor
+ch_scenePreparation::ch_scenePreparation()
+{
+	stage.store(CH_PREPARE_IDLE);
+	seconds = 0.0;
+	scene = NULL;
+}
+
+
+// destructor
+ch_scenePreparation::~ch_scenePreparation()
+{
+	if (worker.joinable())
+		worker.join();
+
+	delete scene;
+}
+
+
+// start preparing the collision scene in the background
+bool ch_scenePreparation::ch_start(cMultiMesh* visual, double proxyTolerance, unsigned int numThreads)
+{
+	if (ch_isBusy())
+		return false;
+
+	// the previous preparation has finished, drop its scene if nobody took it
+	if (worker.joinable())
+		worker.join();
+	delete scene;
+	scene = NULL;
+	stage.store(CH_PREPARE_IDLE);
+
+	worker = thread(&ch_scenePreparation::ch_prepare, this, visual, proxyTolerance, numThreads);
+	return true;
+}
+
+
+// hand the prepared scene over to the caller
+ch_collisionScene* ch_scenePreparation::ch_takeScene()
+{
+	if (!ch_isReady())
+		return NULL;
+
+	ch_collisionScene* taken = scene;
+	scene = NULL;
+	return taken;
+}
+
+
+// name of a step
+const char* ch_scenePreparation::ch_getStageName(ch_preparationStage preparationStage)
+{
+	switch (preparationStage)
+	{
+	case CH_PREPARE_IDLE:		return "idle";
+	case CH_PREPARE_PROXY:		return "collision proxy";
+	case CH_PREPARE_PLANES:		return "triangle planes";
+	case CH_PREPARE_STRUCTURES:	return "acceleration structures";
+	case CH_PREPARE_BROADPHASE:	return "broadphase selection";
+	case CH_PREPARE_WORLD:		return "collision world";
+	case CH_PREPARE_READY:		return "ready";
+	}
+	return "";
+}
+
+
+// enter the next step
+void ch_scenePreparation::ch_setStage(ch_preparationStage preparationStage)
+{
+	printf("scene preparation: %s\n", ch_getStageName(preparationStage));
+
+	// ready publishes the results to the haptic thread
+	stage.store(preparationStage, memory_order_release);
+}
+
+
+// preparation thread
+void ch_scenePreparation::ch_prepare(cMultiMesh* visual, double proxyTolerance, unsigned int numThreads)
+{
+	cPrecisionClock clock;
+	clock.reset();
+	clock.start();
+
+	ch_threadPool pool(numThreads);
+
+	// built aside, the published scene is only assigned once complete
+	ch_collisionScene* prepared = new ch_collisionScene();
+
+	// the rendered mesh is denser than the haptic rendering needs: collide against a decimated proxy
+	ch_setStage(CH_PREPARE_PROXY);
+	ch_collisionProxy* proxy = prepared->proxy = new ch_collisionProxy();
+	proxy->ch_build(visual, proxyTolerance);
+	printf("collision proxy: %u of %u triangles, max. deviation %f\n", proxy->ch_getProxyObject()->getNumTriangles(), visual->getNumTriangles(), proxy->ch_getDecimator().ch_getMaxError());
+
+	ch_setStage(CH_PREPARE_PLANES);
+	ch_segmentTriangleCollisionChecker* checker = prepared->checker = new ch_segmentTriangleCollisionChecker(proxy->ch_getProxyObject(), &pool);
+	checker->ch_setVisualObject(proxy);
+
+	// everything the broadphase benchmark would otherwise build one after the other, plus the distance
+	// field for free space rejection and GO recovery
+	ch_setStage(CH_PREPARE_STRUCTURES);
+	checker->ch_prepare(&pool, true);
+
+	ch_setStage(CH_PREPARE_BROADPHASE);
+	checker->ch_benchmarkBroadphase(1000, true);
+
+	// register the object in the scene, further objects get their own checkers
+	ch_setStage(CH_PREPARE_WORLD);
+	prepared->world = new ch_collisionWorld();
+	prepared->world->ch_addObject(checker);
+	prepared->tool = prepared->world->ch_addTool();
+
+	seconds = clock.stop();
+	printf("scene prepared in %.3f s on %u threads\n", seconds, pool.ch_getNumThreads());
+
+	scene = prepared;
+
+	ch_setStage(CH_PREPARE_READY);
+}
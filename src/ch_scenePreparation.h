@@ -0,0 +1,109 @@
+#ifndef CH_SCENEPREPARATION_H
+#define CH_SCENEPREPARATION_H
+
+// CH lab
+// preparation of a collision scene in the background: collision proxy, triangle planes, acceleration
+// structures, broadphase selection and collision world, the parallel parts on a thread pool. once
+// ch_isReady() returns true the scene is complete and is never touched by the preparation again; the
+// application takes it with ch_takeScene() and publishes it to the haptic loop, at startup as well as for
+// a scene swap during the session
+
+// system includes
+#include <atomic>
+#include <thread>
+
+// CHAI3D includes
+#include "chai3d.h"
+
+// local includes
+#include "ch_collisionProxy.h"
+#include "ch_collisionWorld.h"
+#include "ch_segmentTriangleCollisionChecker.h"
+#include "ch_threadPool.h"
+
+using namespace chai3d;
+using namespace std;
+
+// steps of the preparation, reported by ch_getStage()
+enum ch_preparationStage
+{
+	CH_PREPARE_IDLE,
+	CH_PREPARE_PROXY,			// decimate the visual mesh
+	CH_PREPARE_PLANES,			// triangle planes of the proxy
+	CH_PREPARE_STRUCTURES,		// grid, tree, convex faces and distance field
+	CH_PREPARE_BROADPHASE,		// time the structures and keep the fastest
+	CH_PREPARE_WORLD,			// register the object in the collision world
+	CH_PREPARE_READY
+};
+
+
+// everything the haptic loop needs to check a tick against one object, replaced as a whole
+struct ch_collisionScene
+{
+	// constructor
+	ch_collisionScene();
+
+	// destructor, deletes the world, the checker and the proxy
+	virtual ~ch_collisionScene();
+
+	ch_collisionProxy* proxy;
+	ch_segmentTriangleCollisionChecker* checker;
+	ch_collisionWorld* world;
+	unsigned int tool;
+};
+
+
+class ch_scenePreparation
+{
+public:
+
+	// constructor
+	ch_scenePreparation();
+
+	// destructor, waits for the preparation and deletes a scene that was not taken
+	virtual ~ch_scenePreparation();
+
+	// start preparing the collision scene of an object in the background. its global positions must be up
+	// to date. numThreads workers for the parallel steps, 0 picks the number of cores. returns false while
+	// a previous preparation is still running
+	bool ch_start(cMultiMesh* visual, double proxyTolerance, unsigned int numThreads = 0);
+
+	// has everything been built? the results below are valid from then on
+	inline bool ch_isReady() const { return stage.load(memory_order_acquire) == CH_PREPARE_READY; }
+
+	// is a preparation running?
+	inline bool ch_isBusy() const { return worker.joinable() && !ch_isReady(); }
+
+	// step in progress and the share of the work done, eg. for a progress display
+	inline ch_preparationStage ch_getStage() const { return (ch_preparationStage)stage.load(memory_order_relaxed); }
+	inline double ch_getProgress() const { return (double)stage.load(memory_order_relaxed) / CH_PREPARE_READY; }
+	static const char* ch_getStageName(ch_preparationStage preparationStage);
+
+	// time the preparation took [s]
+	inline double ch_getSeconds() const { return seconds; }
+
+	// the prepared scene once ready, NULL before and after it was taken
+	inline ch_collisionScene* ch_getScene() const { return ch_isReady() ? scene : NULL; }
+
+	// hand the prepared scene over to the caller, who deletes it. NULL if not ready or already taken
+	ch_collisionScene* ch_takeScene();
+
+protected:
+
+	// preparation thread
+	void ch_prepare(cMultiMesh* visual, double proxyTolerance, unsigned int numThreads);
+
+	// enter the next step
+	void ch_setStage(ch_preparationStage preparationStage);
+
+	thread worker;
+
+	// ch_preparationStage, CH_PREPARE_READY is stored with release semantics once the results are complete
+	atomic<int> stage;
+
+	double seconds;
+
+	ch_collisionScene* scene;
+};
+
+#endif
@@ -1,97 +1,836 @@
 #include "ch_segmentTriangleCollisionChecker.h"
 
+// system includes
+#include <algorithm>
+
 
 // constructor
-ch_segmentTriangleCollisionChecker::ch_segmentTriangleCollisionChecker(cMultiMesh* obj)
+ch_segmentTriangleCollisionChecker::ch_segmentTriangleCollisionChecker(cMultiMesh* obj, ch_threadPool* pool)
 {
 	// the virtual object that we will work with
 	object = obj;
-	unsigned int multi_mesh_idx = 0;
-	
-	for (unsigned int i = 0; i < object->getNumTriangles(); i++)
-	{
-		
-		ch_plane temp_plane;
-		planesForTriangles.push_back(temp_plane);
+	visualObject = obj;
+	visualMapping = NULL;
+	numTrianglesObject = object->getNumTriangles();
+	broadphase = CH_BROADPHASE_LINEAR;
+	mailboxStamp = 0;
+	numQueries = 0;
+	numRejectedQueries = 0;
+	numIncompleteQueries = 0;
+	numSkippedQueries = 0;
+	numSkipAborts = 0;
+	maxDeviceSpeed = 0.0;
+	tickPeriod = 0.0;
+	clearance = 0.0;
+	skipTicks = 0;
+	meshId = 0;
+	deformable = NULL;
+	convexChecked = false;
+	queryTriangles = &triangles;
+	queryTree = &tree;
+
+	planesForTriangles.resize(numTrianglesObject);
+	triangles.resize(numTrianglesObject);
+	triangleMailbox.assign(numTrianglesObject, 0);
 
+	// every triangle is independent, large meshes are split over the pool
+	if (pool)
+		pool->ch_parallelFor(numTrianglesObject, CH_SETUP_GRAIN, [this](unsigned int first, unsigned int last) { ch_setupTriangles(first, last); });
+	else
+		ch_setupTriangles(0, numTrianglesObject);
+
+	for (unsigned int i = 0; i < numTrianglesObject; i++)
+		bounds.ch_extend(ch_triangleBounds(triangles[i]));
+}
+
+
+// planes and world space copies of triangles [first, last)
+void ch_segmentTriangleCollisionChecker::ch_setupTriangles(unsigned int first, unsigned int last)
+{
+	for (unsigned int i = first; i < last; i++)
+	{
 		planesForTriangles[i].ch_computePlane(i, object); //ch_plane.cpp
-		
+
+		cVector3d v0, v1, v2;
+		ch_getTriangleVertices(i, v0, v1, v2);
+		ch_setTriangle(triangles[i], ch_toVec3(v0), ch_toVec3(v1), ch_toVec3(v2));
 	}
 }
 
 
+// build every acceleration structure up front
+void ch_segmentTriangleCollisionChecker::ch_prepare(ch_threadPool* pool, bool withDistanceField)
+{
+	if (deformable)
+		return;
+
+	// the structures only read the triangles and write their own members, they are built side by side
+	unsigned int numStructures = withDistanceField ? 4 : 3;
+	pool->ch_parallelFor(numStructures, 1, [this](unsigned int first, unsigned int last)
+	{
+		for (unsigned int i = first; i < last; i++)
+		{
+			if (i == 0 && !grid.ch_isBuilt())
+				grid.ch_build(triangles);
+			else if (i == 1 && !tree.ch_isBuilt())
+				tree.ch_build(triangles);
+			else if (i == 2)
+				ch_isConvex();
+			else if (i == 3 && !distanceField.ch_isBuilt())
+				distanceField.ch_build(triangles);
+		}
+	});
+}
+
+
+// world space vertices of a triangle
+void ch_segmentTriangleCollisionChecker::ch_getTriangleVertices(const unsigned int TriangleIndex, cVector3d& v0, cVector3d& v1, cVector3d& v2)
+{
+	v0 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex0(TriangleIndex));
+	v1 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex1(TriangleIndex));
+	v2 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex2(TriangleIndex));
+
+	v0 = cAdd(object->getMesh(0)->getGlobalPos(), cMul(object->getMesh(0)->getGlobalRot(), v0));
+	v1 = cAdd(object->getMesh(0)->getGlobalPos(), cMul(object->getMesh(0)->getGlobalRot(), v1));
+	v2 = cAdd(object->getMesh(0)->getGlobalPos(), cMul(object->getMesh(0)->getGlobalRot(), v2));
+}
+
+
 // check for GO-device segment-triangle collisions
-void ch_segmentTriangleCollisionChecker::ch_checkCollisions(const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d intersectionPoint)
+unsigned int ch_segmentTriangleCollisionChecker::ch_checkCollisions(const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, ch_queryMode mode)
 {
-	unsigned int i;
+	unsigned int firstHit = contacts.ch_size();
 
-	for (i = 0; i < object->getNumTriangles(); i++)
+	numQueries++;
+	ch_beginQuery();
+
+	// convert once at the CHAI3D boundary, everything below runs on the aligned core types
+	ch_vec3 start = ch_toVec3(lastDevicePosition);
+	ch_vec3 direction = ch_toVec3(currentDevicePosition) - start;
+
+	// far from the object the clearance of an earlier query still holds
+	if (ch_skipQuery(start, start + direction))
+		return 0;
+
+	// most ticks happen in free space, where the distance field proves that no triangle is in reach
+	if (!deformable && distanceField.ch_isBuilt() && !distanceField.ch_segmentMayTouchSurface(start, start + direction))
 	{
-		int collided = -3;
+		numRejectedQueries++;
+		ch_updateClearance(start + direction);
+		return 0;
+	}
 
-		
-		//cVector3d intersectionPoint;	// intersection between segment and triangle, if it has taken place
-		collided = ch_checkSegTriangleCollision(i, lastDevicePosition, currentDevicePosition, intersectionPoint);
-	
-		if (collided == 1)
+	if (broadphase == CH_BROADPHASE_CONVEX)
+		ch_checkCollisionsConvex(start, direction, mode);
+	else if (broadphase == CH_BROADPHASE_TREE)
+		ch_checkCollisionsTree(start, direction, mode);
+	else if (broadphase == CH_BROADPHASE_COMPACT)
+		ch_checkCollisionsCompact(start, direction, mode);
+	else if (broadphase == CH_BROADPHASE_GRID)
+		ch_checkCollisionsGrid(start, direction, mode);
+	else
+		ch_checkCollisionsLinear(start, direction, mode);
+
+	unsigned int numHits = contacts.ch_size() - firstHit;
+	if (numHits == 0)
+	{
+		ch_updateClearance(start + direction);
+		return 0;
+	}
+
+	if (mode == CH_QUERY_ALL)
+		contacts.ch_sort(firstHit);
+	ch_finishContacts(firstHit, start, direction);
+
+	intersectionPoint = ch_toCVector3d(contacts[firstHit].point);
+	return numHits;
+}
+
+
+// check for collisions within a budget of triangle tests
+unsigned int ch_segmentTriangleCollisionChecker::ch_checkCollisionsBudgeted(const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, unsigned int& triangleBudget, bool& complete, ch_queryMode mode)
+{
+	ch_budgetedQuery query;
+	query.firstHit = contacts.ch_size();
+	query.start = ch_toVec3(lastDevicePosition);
+	query.direction = ch_toVec3(currentDevicePosition) - query.start;
+	query.mode = mode;
+	query.tMax = 1.0;
+	query.budget = triangleBudget;
+	query.answered = false;
+	complete = true;
+
+	numQueries++;
+	ch_beginQuery();
+
+	if (ch_skipQuery(query.start, query.start + query.direction))
+	{
+		previousContacts.clear();
+		return 0;
+	}
+
+	// the rejection costs a few lookups, far less than a triangle test
+	if (!deformable && distanceField.ch_isBuilt() && !distanceField.ch_segmentMayTouchSurface(query.start, query.start + query.direction))
+	{
+		numRejectedQueries++;
+		previousContacts.clear();
+		ch_updateClearance(query.start + query.direction);
+		return 0;
+	}
+
+	if (broadphase == CH_BROADPHASE_CONVEX)
+	{
+		// bounded by the number of faces, never cut short
+		ch_checkCollisionsConvex(query.start, query.direction, mode);
+	}
+	else
+	{
+		ch_newMailboxStamp();
+
+		// the device rarely leaves the triangles it touched a millisecond ago: a good first guess, and in
+		// nearest mode a short tMax that prunes most of the walk
+		for (unsigned int i = 0; i < previousContacts.size() && !query.answered; i++)
 		{
-			collidedTriangleIndex.push_back(i);
+			if (query.budget == 0)
+			{
+				complete = false;
+				break;
+			}
+			ch_testBudgeted(previousContacts[i], query);
 		}
+
+		if (complete && !query.answered)
+			complete = ch_walkBudgeted(query);
+
+		triangleBudget = query.budget;
+		if (!complete)
+			numIncompleteQueries++;
 	}
+
+	previousContacts.clear();
+	for (unsigned int i = query.firstHit; i < contacts.ch_size(); i++)
+		previousContacts.push_back(contacts[i].triangle);
+
+	// a cut-off query proves nothing about the clearance
+	unsigned int numHits = contacts.ch_size() - query.firstHit;
+	if (numHits == 0)
+	{
+		if (complete)
+			ch_updateClearance(query.start + query.direction);
+		return 0;
+	}
+
+	if (mode == CH_QUERY_ALL)
+		contacts.ch_sort(query.firstHit);
+	ch_finishContacts(query.firstHit, query.start, query.direction);
+
+	intersectionPoint = ch_toCVector3d(contacts[query.firstHit].point);
+	return numHits;
 }
 
 
-// called from ch_checkCollisions()
-int ch_segmentTriangleCollisionChecker::ch_checkSegTriangleCollision(const unsigned int TriangleIndex, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint)
+// test a triangle of a budgeted query
+void ch_segmentTriangleCollisionChecker::ch_testBudgeted(unsigned int TriangleIndex, ch_budgetedQuery& query)
 {
-	cVector3d v0, v1, v2;	// vertices of the triangle
-	cVector3d v01, v02;		// vectors from vertex 0 to vertices 1 and 2	
-	cVector3d ray_direction;	// direction of the segment
-	cVector3d plane_normal;
-	double d, t;
+	if (triangleMailbox[TriangleIndex] == mailboxStamp)
+		return;	// a previous contact, or in a previous grid cell
+	triangleMailbox[TriangleIndex] = mailboxStamp;
+	query.budget--;
 
-	//for (unsigned int j = 0; j < object->getNumTriangles(); j++){
-		
-		v0 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex0(TriangleIndex));
-		v1 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex1(TriangleIndex));
-		v2 = object->getVertexPos(object->getMesh(0)->m_triangles->getVertexIndex2(TriangleIndex));
-		
+	ch_vec3 point;
+	double t;
+	if (ch_intersectSegmentTriangle((*queryTriangles)[TriangleIndex], query.start, query.direction, t, point, query.tMax) == CH_HIT)
+	{
+		query.answered = ch_addHit(TriangleIndex, t, query.mode, query.firstHit);
 
-		v0 = cAdd(object->getMesh(0)->getGlobalPos(), cMul(object->getMesh(0)->getGlobalRot(), v0));
-		v1 = cAdd(object->getMesh(0)->getGlobalPos(), cMul(object->getMesh(0)->getGlobalRot(), v1));
-		v2 = cAdd(object->getMesh(0)->getGlobalPos(), cMul(object->getMesh(0)->getGlobalRot(), v2));
+		if (query.mode == CH_QUERY_NEAREST)
+			query.tMax = t;
+	}
+}
 
-		v1.subr(v0, v01);
-		v2.subr(v0, v02);
 
-		// compute the plane which contains the triangle: plane represented as ax+by+cz+d = 0
-		// first compute the plane normal
-		v02.crossr(v01, plane_normal);	// don't know if this normal points inwards or outwards from the object
-		plane_normal.normalize();	// gives a, b and c coeffs. of the plane
+// walk the broadphase for a budgeted query
+bool ch_segmentTriangleCollisionChecker::ch_walkBudgeted(ch_budgetedQuery& query)
+{
+	const unsigned int *first, *last;
 
-		// compute coeff. d 
-		d = -cDot(plane_normal, v0);
+	// the compact tree has the topology of the full one, a budgeted walk takes the exact triangles
+	if (broadphase == CH_BROADPHASE_TREE || broadphase == CH_BROADPHASE_COMPACT)
+	{
+		// nearer leaves first, in nearest mode the leaves behind the best hit are pruned
+		ch_treeWalk walk;
+		queryTree->ch_beginWalk(query.start, query.direction, walk);
+		while (queryTree->ch_nextLeaf(walk, query.tMax, first, last))
+		{
+			for (; first != last; ++first)
+			{
+				if (query.budget == 0)
+					return false;
+				ch_testBudgeted(*first, query);
+				if (query.answered)
+					return true;
+			}
+		}
+	}
+	else if (broadphase == CH_BROADPHASE_GRID)
+	{
+		// cells in segment order
+		ch_gridWalk walk;
+		if (!grid.ch_beginWalk(query.start, query.start + query.direction, walk))
+			return true;
 
-		currentDevicePosition.subr(lastDevicePosition, ray_direction);
+		while (grid.ch_nextCell(walk, first, last))
+		{
+			for (; first != last; ++first)
+			{
+				if (query.budget == 0)
+					return false;
+				ch_testBudgeted(*first, query);
+				if (query.answered)
+					return true;
+			}
+
+			if (query.mode == CH_QUERY_NEAREST && contacts.ch_size() > query.firstHit && query.tMax <= walk.tCellExit)
+				return true;
+		}
+	}
+	else
+	{
+		// no order to exploit, the triangles are tested as stored
+		for (unsigned int i = 0; i < numTrianglesObject; i++)
+		{
+			if (query.budget == 0)
+				return false;
+			ch_testBudgeted(i, query);
+			if (query.answered)
+				return true;
+		}
+	}
+
+	return true;
+}
+
+
+// fill in the geometry of the contacts of the current query
+void ch_segmentTriangleCollisionChecker::ch_finishContacts(unsigned int firstHit, const ch_vec3& start, const ch_vec3& direction)
+{
+	// only the reported hits, the triangles are still those of the query even for a deformable object
+	for (unsigned int i = firstHit; i < contacts.ch_size(); i++)
+	{
+		ch_contact& contact = contacts[i];
+		const ch_triangle& triangle = (*queryTriangles)[contact.triangle];
+		contact.point = start + direction * contact.t;
+		contact.plane = triangle.normal;
+		contact.barycentric = ch_barycentric(contact.point, triangle.v0, triangle.v1, triangle.v2);
+	}
+}
+
+
+// clip the segment against the convex faces
+void ch_segmentTriangleCollisionChecker::ch_checkCollisionsConvex(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode)
+{
+	unsigned int firstHit = contacts.ch_size();
+	unsigned int face;
+	double t;
+
+	// report the triangle under the entry point, as the triangle tests would
+	if (convex.ch_intersectSegment(start, direction, t, face))
+		ch_addHit(convex.ch_findTriangle(face, start + direction * t, triangles), t, mode, firstHit, (int)face);
+}
+
+
+// pick the geometry the next query runs on
+void ch_segmentTriangleCollisionChecker::ch_beginQuery()
+{
+	if (!deformable)
+		return;
+
+	// never waits: the worker only writes snapshots the haptic thread does not hold
+	const ch_meshSnapshot& snapshot = deformable->ch_acquire();
+	queryTriangles = &snapshot.triangles;
+	queryTree = &snapshot.tree;
+}
 
-		if (cDot(plane_normal, ray_direction) < SMALL_NUM)
-			return 0;	// no intersection because plane and ray (almost) parallel
-		else
-			t = -(cDot(plane_normal, lastDevicePosition) + d) / (cDot(plane_normal, ray_direction));
 
-		// check if t corresonds to a point on the segment or to one outside ie
-		if (t < 0 || t > 1)
-			return -1;	// no intersection because point outside segment
+// world space bounds of the geometry the next query runs on
+ch_aabb ch_segmentTriangleCollisionChecker::ch_getBounds()
+{
+	if (!deformable)
+		return bounds;
+
+	// the root of the snapshot tree bounds the deformed object
+	ch_beginQuery();
+	return queryTree->ch_isBuilt() ? queryTree->ch_getNodes()[0].bounds : bounds;
+}
+
+
+// can the proximity culling skip the query?
+bool ch_segmentTriangleCollisionChecker::ch_skipQuery(const ch_vec3& start, const ch_vec3& end)
+{
+	if (skipTicks == 0)
+		return false;
+	skipTicks--;
+
+	// the ball around the device is free of triangles, so is any segment inside it. the speed bound is
+	// only an assumption: a device outside the ball, eg. after a USB hiccup or ticks in which the world did
+	// not query this object, ends the skip
+	if (ch_distance(start, clearanceCenter) >= clearance || ch_distance(end, clearanceCenter) >= clearance)
+	{
+		skipTicks = 0;
+		numSkipAborts++;
+		return false;
+	}
+
+	numSkippedQueries++;
+	return true;
+}
+
+
+// the clearance of the segment end and the queries it lets skip
+void ch_segmentTriangleCollisionChecker::ch_updateClearance(const ch_vec3& end)
+{
+	// the surface of a deformable object may come closer by itself
+	if (maxDeviceSpeed <= 0.0 || tickPeriod <= 0.0 || deformable)
+		return;
+
+	// both are lower bounds of the distance to the surface, the field is only known within its band
+	ch_vec3 outside = ch_max(ch_max(bounds.lo - end, end - bounds.hi), ch_vec3());
+	double distance = ch_length(outside);
+	if (distanceField.ch_isBuilt())
+		distance = max(distance, distanceField.ch_getDistanceLowerBound(end));
+
+	clearanceCenter = end;
+	clearance = distance;
+	skipTicks = (unsigned int)min(floor(distance / (maxDeviceSpeed * tickPeriod)), (double)CH_PROXIMITY_MAX_SKIP);
+}
+
+
+// turn the proximity culling on or off
+void ch_segmentTriangleCollisionChecker::ch_setProximityCulling(double maxSpeed, double period)
+{
+	maxDeviceSpeed = maxSpeed;
+	tickPeriod = period;
+	skipTicks = 0;
+}
+
+
+// record a hit of the current query
+bool ch_segmentTriangleCollisionChecker::ch_addHit(unsigned int TriangleIndex, double t, ch_queryMode mode, unsigned int firstHit, int face)
+{
+	if (mode == CH_QUERY_NEAREST && contacts.ch_size() > firstHit)
+	{
+		// the caller only passes hits closer than the one kept so far
+		contacts[firstHit].triangle = TriangleIndex;
+		contacts[firstHit].t = t;
+		contacts[firstHit].face = face;
+		return false;
+	}
+
+	// point, plane and barycentrics are filled in once the query is done
+	ch_contact contact;
+	contact.triangle = TriangleIndex;
+	contact.t = t;
+	contact.mesh = meshId;
+	contact.face = face;
+	contacts.ch_add(contact, firstHit);
+
+	return (mode == CH_QUERY_ANY);
+}
+
+
+// test every triangle of the object
+void ch_segmentTriangleCollisionChecker::ch_checkCollisionsLinear(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode)
+{
+	unsigned int firstHit = contacts.ch_size();
+	const ch_triangleArray& tris = *queryTriangles;
+	ch_vec3 point;
+	double t, tMax = 1.0;
+
+	for (unsigned int i = 0; i < numTrianglesObject; i++)
+	{
+		if (ch_intersectSegmentTriangle(tris[i], start, direction, t, point, tMax) == CH_HIT)
+		{
+			if (ch_addHit(i, t, mode, firstHit))
+				return;
+
+			// in nearest mode, only closer hits matter from now on
+			if (mode == CH_QUERY_NEAREST)
+				tMax = t;
+		}
+	}
+}
+
+
+// test the triangles in the grid cells along the segment
+void ch_segmentTriangleCollisionChecker::ch_checkCollisionsGrid(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode)
+{
+	unsigned int firstHit = contacts.ch_size();
+	ch_gridWalk walk;
+	const unsigned int *first, *last;
+	ch_vec3 point;
+	double t, tMax = 1.0;
+
+	if (!grid.ch_beginWalk(start, start + direction, walk))
+		return;
+
+	ch_newMailboxStamp();
+
+	while (grid.ch_nextCell(walk, first, last))
+	{
+		for (; first != last; ++first)
+		{
+			if (triangleMailbox[*first] == mailboxStamp)
+				continue;	// already tested in a previous cell
+			triangleMailbox[*first] = mailboxStamp;
+
+			if (ch_intersectSegmentTriangle((*queryTriangles)[*first], start, direction, t, point, tMax) == CH_HIT)
+			{
+				if (ch_addHit(*first, t, mode, firstHit))
+					return;
+
+				if (mode == CH_QUERY_NEAREST)
+					tMax = t;
+			}
+		}
+
+		// the cells are visited in segment order: a hit inside the cells walked so far is closer
+		// than anything the remaining cells can contribute
+		if (mode == CH_QUERY_NEAREST && contacts.ch_size() > firstHit && tMax <= walk.tCellExit)
+			return;
+	}
+}
+
+
+// test the triangles of the tree leaves along the segment
+void ch_segmentTriangleCollisionChecker::ch_checkCollisionsTree(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode)
+{
+	unsigned int firstHit = contacts.ch_size();
+	const ch_triangleArray& tris = *queryTriangles;
+	ch_treeWalk walk;
+	const unsigned int *first, *last;
+	ch_vec3 point;
+	double t, tMax = 1.0;
+
+	// every triangle sits in exactly one leaf, no mailbox needed. in nearest mode the shrinking tMax
+	// prunes the leaves behind the best hit
+	queryTree->ch_beginWalk(start, direction, walk);
+	while (queryTree->ch_nextLeaf(walk, tMax, first, last))
+	{
+		for (; first != last; ++first)
+		{
+			if (ch_intersectSegmentTriangle(tris[*first], start, direction, t, point, tMax) == CH_HIT)
+			{
+				if (ch_addHit(*first, t, mode, firstHit))
+					return;
+
+				if (mode == CH_QUERY_NEAREST)
+					tMax = t;
+			}
+		}
+	}
+}
+
+
+// test the triangles of the compact tree leaves along the segment
+void ch_segmentTriangleCollisionChecker::ch_checkCollisionsCompact(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode)
+{
+	unsigned int firstHit = contacts.ch_size();
+	ch_compactWalk walk;
+	ch_triangle decoded[CH_TREE_LEAF_SIZE];
+	unsigned int indices[CH_TREE_LEAF_SIZE];
+	ch_vec3 point;
+	double t, tMax = 1.0;
+
+	// as ch_checkCollisionsTree(), the reported indices are those of the full triangles
+	compact.ch_beginWalk(start, direction, walk);
+	int leaf;
+	while ((leaf = compact.ch_nextLeaf(walk, tMax)) >= 0)
+	{
+		unsigned int count = compact.ch_decodeLeaf(leaf, decoded, indices);
+		for (unsigned int k = 0; k < count; k++)
+		{
+			if (ch_intersectSegmentTriangle(decoded[k], start, direction, t, point, tMax) == CH_HIT)
+			{
+				if (ch_addHit(indices[k], t, mode, firstHit))
+					return;
+
+				if (mode == CH_QUERY_NEAREST)
+					tMax = t;
+			}
+		}
+	}
+}
+
+
+// start a new mailbox query
+void ch_segmentTriangleCollisionChecker::ch_newMailboxStamp()
+{
+	if (++mailboxStamp == 0)
+	{
+		triangleMailbox.assign(numTrianglesObject, 0);
+		mailboxStamp = 1;
+	}
+}
+
+
+// hits of a batch ordered by segment, then along the segment
+static bool ch_hitBefore(const ch_segmentHit& a, const ch_segmentHit& b)
+{
+	return (a.segment != b.segment) ? (a.segment < b.segment) : (a.t < b.t);
+}
+
+
+// check a batch of segments
+unsigned int ch_segmentTriangleCollisionChecker::ch_checkCollisionsBatch(const cVector3d* segmentStarts, const cVector3d* segmentEnds, unsigned int numSegments, vector<ch_segmentHit>& hits, ch_queryMode mode)
+{
+	unsigned int firstHit = (unsigned int)hits.size();
+	ch_packet packet;
+	unsigned int next = 0;
+
+	numQueries += numSegments;
+	ch_beginQuery();
+
+	while (next < numSegments)
+	{
+		// fill a packet with the segments that the distance field cannot reject
+		packet.size = 0;
+		for (; next < numSegments && packet.size < CH_MAX_PACKET_SIZE; next++)
+		{
+			ch_vec3 start = ch_toVec3(segmentStarts[next]);
+			ch_vec3 end = ch_toVec3(segmentEnds[next]);
+
+			if (!deformable && distanceField.ch_isBuilt() && !distanceField.ch_segmentMayTouchSurface(start, end))
+			{
+				numRejectedQueries++;
+				continue;
+			}
+
+			unsigned int k = packet.size++;
+			packet.start[k] = start;
+			packet.direction[k] = end - start;
+			packet.segment[k] = next;
+			packet.tMax[k] = 1.0;
+			packet.triangle[k] = -1;
+		}
+
+		if (packet.size == 0)
+			continue;
+
+		packet.active = (packet.size == 64) ? ~0ULL : ((1ULL << packet.size) - 1);
+
+		if (broadphase == CH_BROADPHASE_CONVEX)
+			ch_checkPacketConvex(packet, mode, hits);
+		else if (broadphase == CH_BROADPHASE_TREE || broadphase == CH_BROADPHASE_COMPACT)
+			ch_checkPacketTree(packet, mode, hits);
+		else if (broadphase == CH_BROADPHASE_GRID)
+			ch_checkPacketGrid(packet, mode, hits);
 		else
+			ch_checkPacketLinear(packet, mode, hits);
+
+		// any and nearest keep their single hit in the packet
+		if (mode != CH_QUERY_ALL)
+		{
+			for (unsigned int k = 0; k < packet.size; k++)
+			{
+				if (packet.triangle[k] >= 0)
+				{
+					ch_segmentHit hit = { packet.segment[k], packet.triangle[k], packet.tMax[k] };
+					hits.push_back(hit);
+				}
+			}
+		}
+	}
+
+	if (mode == CH_QUERY_ALL)
+		sort(hits.begin() + firstHit, hits.end(), ch_hitBefore);
+
+	return (unsigned int)hits.size() - firstHit;
+}
+
+
+// test one triangle against the segments of a packet
+void ch_segmentTriangleCollisionChecker::ch_testPacket(unsigned int TriangleIndex, unsigned long long mask, ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits)
+{
+	const ch_triangle& triangle = (*queryTriangles)[TriangleIndex];
+	ch_vec3 point;
+	double t;
+
+	while (mask)
+	{
+		int k = ch_lowestBitIndex(mask);
+		mask &= mask - 1;
+
+		if (ch_intersectSegmentTriangle(triangle, packet.start[k], packet.direction[k], t, point, packet.tMax[k]) != CH_HIT)
+			continue;
+
+		if (mode == CH_QUERY_ALL)
+		{
+			ch_segmentHit hit = { packet.segment[k], (int)TriangleIndex, t };
+			hits.push_back(hit);
+			continue;
+		}
+
+		packet.triangle[k] = TriangleIndex;
+		packet.tMax[k] = t;
+		if (mode == CH_QUERY_ANY)
+			packet.active &= ~(1ULL << k);
+	}
+}
+
+
+// clip every segment of a packet against the convex faces
+void ch_segmentTriangleCollisionChecker::ch_checkPacketConvex(ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits)
+{
+	unsigned int face;
+	double t;
+
+	// a handful of planes per segment, nothing to share between the segments of the packet
+	for (unsigned int k = 0; k < packet.size; k++)
+	{
+		if (!convex.ch_intersectSegment(packet.start[k], packet.direction[k], t, face, packet.tMax[k]))
+			continue;
+
+		int triangle = (int)convex.ch_findTriangle(face, packet.start[k] + packet.direction[k] * t, triangles);
+		if (mode == CH_QUERY_ALL)
+		{
+			ch_segmentHit hit = { packet.segment[k], triangle, t };
+			hits.push_back(hit);
+			continue;
+		}
+
+		packet.triangle[k] = triangle;
+		packet.tMax[k] = t;
+	}
+}
+
+
+// run a packet through every triangle of the object
+void ch_segmentTriangleCollisionChecker::ch_checkPacketLinear(ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits)
+{
+	for (unsigned int i = 0; i < numTrianglesObject && packet.active; i++)
+		ch_testPacket(i, packet.active, packet, mode, hits);
+}
+
+
+// run a packet through the union of the grid cells its segments visit
+void ch_segmentTriangleCollisionChecker::ch_checkPacketGrid(ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits)
+{
+	ch_gridWalk walk;
+	ch_packetCell cell;
+
+	// every occupied cell on every segment, tagged with the segment bit
+	packetCells.clear();
+	for (unsigned int k = 0; k < packet.size; k++)
+	{
+		if (!grid.ch_beginWalk(packet.start[k], packet.start[k] + packet.direction[k], walk))
+			continue;
+
+		cell.mask = 1ULL << k;
+		while (grid.ch_nextCell(walk, cell.first, cell.last))
+			packetCells.push_back(cell);
+	}
+
+	// merge the visits of the same cell, the cells then also come in memory order
+	sort(packetCells.begin(), packetCells.end());
+
+	if (triangleTestedMask.size() != numTrianglesObject)
+		triangleTestedMask.assign(numTrianglesObject, 0);
+	ch_newMailboxStamp();
+
+	for (unsigned int c = 0; c < packetCells.size() && packet.active; )
+	{
+		const unsigned int* first = packetCells[c].first;
+		const unsigned int* last = packetCells[c].last;
+		unsigned long long mask = 0;
+		for (; c < packetCells.size() && packetCells[c].first == first; c++)
+			mask |= packetCells[c].mask;
+
+		for (; first != last; ++first)
 		{
-			// check if the intersection point lies inside the triangle		
-			lastDevicePosition.addr((cMul(t, ray_direction)), intersectionPoint);
+			// a triangle spanning several cells is tested once per segment
+			if (triangleMailbox[*first] != mailboxStamp)
+			{
+				triangleMailbox[*first] = mailboxStamp;
+				triangleTestedMask[*first] = 0;
+			}
 
-			if (ch_pointInTriangle(intersectionPoint, v0, v1, v2))
-				return 1;	// intersection! - common point found to lie on the segment as well as inside the triangle
-			else
-				return -2;	// no intersection because point lies outside triangle				
+			unsigned long long todo = mask & packet.active & ~triangleTestedMask[*first];
+			if (!todo)
+				continue;
+			triangleTestedMask[*first] |= todo;
+
+			ch_testPacket(*first, todo, packet, mode, hits);
 		}
+	}
+}
+
+
+// run a packet down the tree
+void ch_segmentTriangleCollisionChecker::ch_checkPacketTree(ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits)
+{
+	const vector<ch_aabbNode, ch_alignedAllocator<ch_aabbNode> >& nodes = queryTree->ch_getNodes();
+	const vector<unsigned int>& leafTriangles = queryTree->ch_getLeafTriangles();
+	unsigned int stackNode[CH_TREE_STACK_SIZE];
+	unsigned long long stackMask[CH_TREE_STACK_SIZE];
+	int top = 0;
+
+	if (nodes.empty())
+		return;
+
+	stackNode[top] = 0;
+	stackMask[top++] = packet.active;
+
+	while (top > 0 && packet.active)
+	{
+		const ch_aabbNode& node = nodes[stackNode[--top]];
+		unsigned long long candidates = stackMask[top] & packet.active;
+		unsigned long long mask = 0;
+
+		// the segments of the packet that still reach this node
+		while (candidates)
+		{
+			int k = ch_lowestBitIndex(candidates);
+			candidates &= candidates - 1;
+
+			double t0 = 0.0, t1 = packet.tMax[k];
+			if (ch_clipSegmentToBox(node.bounds, packet.start[k], packet.direction[k], t0, t1))
+				mask |= 1ULL << k;
+		}
+
+		if (!mask)
+			continue;
+
+		if (node.count > 0)
+		{
+			for (unsigned int i = node.first; i < node.first + node.count; i++)
+				ch_testPacket(leafTriangles[i], mask, packet, mode, hits);
+		}
+		else
+		{
+			stackNode[top] = node.first + 1;
+			stackMask[top++] = mask;
+			stackNode[top] = node.first;
+			stackMask[top++] = mask;
+		}
+	}
+}
+
+
+// called from ch_checkCollisions()
+int ch_segmentTriangleCollisionChecker::ch_checkSegTriangleCollision(const unsigned int TriangleIndex, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint)
+{
+	ch_vec3 start = ch_toVec3(lastDevicePosition);
+	ch_vec3 point;
+	double t;
+
+	// the plane of the triangle is cached with it, its normal points away from the object so only
+	// segments entering through the front side can hit
+	int result = ch_intersectSegmentTriangle((*queryTriangles)[TriangleIndex], start, ch_toVec3(currentDevicePosition) - start, t, point);
+
+	if (result == CH_HIT || result == CH_MISS_TRIANGLE)
+		intersectionPoint = ch_toCVector3d(point);
+
+	return result;
 }
 
 
@@ -99,20 +838,340 @@ int ch_segmentTriangleCollisionChecker::ch_checkSegTriangleCollision(const unsig
 // check if a given point lies inside a given triangle
 bool ch_segmentTriangleCollisionChecker::ch_pointInTriangle(const cVector3d& intersectionPoint, const cVector3d& vertex0, const cVector3d& vertex1, const cVector3d& vertex2)
 {
-	// check for all three sides of the triangle	
-	if (ch_sameSide(intersectionPoint, vertex2, vertex0, vertex1)	\
-		&& ch_sameSide(intersectionPoint, vertex0, vertex1, vertex2)	\
-		&& ch_sameSide(intersectionPoint, vertex1, vertex2, vertex0))
+	return ::ch_pointInTriangle(ch_toVec3(intersectionPoint), ch_toVec3(vertex0), ch_toVec3(vertex1), ch_toVec3(vertex2));
+}
+
+
+
+bool ch_segmentTriangleCollisionChecker::ch_sameSide(const cVector3d& intersectionPoint, const cVector3d& v3, const cVector3d& v1, const cVector3d& v2)
+{
+	return ::ch_sameSide(ch_toVec3(intersectionPoint), ch_toVec3(v3), ch_toVec3(v1), ch_toVec3(v2));
+}
+
+
+
+// build the narrow-band distance field
+void ch_segmentTriangleCollisionChecker::ch_buildDistanceField(double voxelSize, double bandWidth)
+{
+	distanceField.ch_build(triangles, voxelSize, bandWidth);
+}
+
+
+
+// estimate the closest surface point and the penetration depth of a point inside the object
+bool ch_segmentTriangleCollisionChecker::ch_estimatePenetration(const cVector3d& point, cVector3d& surfacePoint, double& depth) const
+{
+	ch_vec3 surface;
+
+	// the field and the faces describe the undeformed object
+	if (deformable)
+		return false;
+
+	// inside a convex object the nearest face plane holds the closest surface point
+	if (convex.ch_isBuilt())
+	{
+		unsigned int face;
+		ch_vec3 p = ch_toVec3(point);
+		double distance = convex.ch_signedDistance(p, face);
+		if (distance > 0.0)
+			return false;
+
+		depth = -distance;
+		surfacePoint = ch_toCVector3d(p + convex.ch_getPlane(face) * depth);
 		return true;
-	else
+	}
+
+	if (!distanceField.ch_estimatePenetration(ch_toVec3(point), surface, depth))
 		return false;
+
+	surfacePoint = ch_toCVector3d(surface);
+	return true;
 }
 
 
 
-bool ch_segmentTriangleCollisionChecker::ch_sameSide(const cVector3d& intersectionPoint, const cVector3d& v3, const cVector3d& v1, const cVector3d& v2)
+// closest surface point within a radius, through the tree
+bool ch_segmentTriangleCollisionChecker::ch_findClosestPoint(const cVector3d& point, double radius, cVector3d& closestPoint, double& distance, int& TriangleIndex)
 {
-	return false;
+	// a deformable object keeps the snapshot of the last collision query, so that the contacts of a tick
+	// and the closest points asked for with them come from the same geometry
+	if (!deformable)
+		ch_getTree();
+
+	ch_vec3 closest;
+	double distanceSq;
+	TriangleIndex = queryTree->ch_findClosest(*queryTriangles, ch_toVec3(point), radius * radius, closest, distanceSq);
+	if (TriangleIndex < 0)
+		return false;
+
+	closestPoint = ch_toCVector3d(closest);
+	distance = sqrt(distanceSq);
+	return true;
+}
+
+
+// a triangle of a plane near a point
+int ch_segmentTriangleCollisionChecker::ch_findTriangleOnPlane(const ch_vec3& point, const ch_vec3& plane, double maxDistance)
+{
+	// the snapshot of the last collision query, the planes of the GO came from it
+	if (!deformable)
+		ch_getTree();
+
+	return queryTree->ch_findOnPlane(*queryTriangles, point, plane, maxDistance);
+}
+
+
+// closest surface point within a radius, every triangle
+bool ch_segmentTriangleCollisionChecker::ch_findClosestPointLinear(const cVector3d& point, double radius, cVector3d& closestPoint, double& distance, int& TriangleIndex)
+{
+	ch_vec3 p = ch_toVec3(point), closest;
+	double distanceSq = radius * radius;
+	TriangleIndex = -1;
+	for (unsigned int i = 0; i < queryTriangles->size(); i++)
+	{
+		const ch_triangle& triangle = (*queryTriangles)[i];
+		ch_vec3 q = ch_closestPointOnTriangle(p, triangle.v0, triangle.v1, triangle.v2);
+		double d = ch_distanceSq(p, q);
+		if (d < distanceSq)
+		{
+			distanceSq = d;
+			closest = q;
+			TriangleIndex = (int)i;
+		}
+	}
+	if (TriangleIndex < 0)
+		return false;
+
+	closestPoint = ch_toCVector3d(closest);
+	distance = sqrt(distanceSq);
+	return true;
+}
+
+
+
+// choose the acceleration structure
+void ch_segmentTriangleCollisionChecker::ch_setBroadphase(ch_broadphaseType type)
+{
+	// the grid cannot follow moving vertices
+	if (deformable)
+		type = CH_BROADPHASE_TREE;
+
+	if (type == CH_BROADPHASE_GRID && !grid.ch_isBuilt())
+		grid.ch_build(triangles);
+
+	if ((type == CH_BROADPHASE_TREE || type == CH_BROADPHASE_COMPACT) && !tree.ch_isBuilt())
+		tree.ch_build(triangles);
+
+	if (type == CH_BROADPHASE_COMPACT && !compact.ch_isBuilt())
+		compact.ch_build(triangles, tree);
+
+	if (type == CH_BROADPHASE_CONVEX && !ch_isConvex())
+		return;
+
+	broadphase = type;
+}
+
+
+
+// AABB tree over the triangles of a rigid object
+const ch_aabbTree& ch_segmentTriangleCollisionChecker::ch_getTree()
+{
+	if (!tree.ch_isBuilt())
+		tree.ch_build(triangles);
+	return tree;
+}
+
+
+
+// quantized copy of the triangles and the tree of a rigid object
+const ch_compactMesh& ch_segmentTriangleCollisionChecker::ch_getCompactMesh()
+{
+	if (!compact.ch_isBuilt())
+		compact.ch_build(triangles, ch_getTree());
+	return compact;
+}
+
+
+
+// is the object a closed convex solid?
+bool ch_segmentTriangleCollisionChecker::ch_isConvex()
+{
+	if (!convexChecked && !deformable)
+		convex.ch_build(triangles);
+	convexChecked = true;
+
+	return convex.ch_isBuilt();
+}
+
+
+
+// time every broadphase on random segments through the object and report which one wins
+ch_broadphaseType ch_segmentTriangleCollisionChecker::ch_benchmarkBroadphase(const unsigned int numSegments, bool selectWinner)
+{
+	const int maxTypes = 4;
+	const char* names[maxTypes] = { "linear", "grid", "tree", "convex" };
+	double seconds[maxTypes];
+	unsigned int hits[maxTypes];
+	ch_broadphaseType previous = broadphase;
+
+	// a deformable object has no choice
+	if (numTrianglesObject == 0 || numSegments == 0 || deformable)
+		return broadphase;
+
+	// the faces only compete on convex objects
+	int numTypes = ch_isConvex() ? 4 : 3;
+
+	// the segments start anywhere around the object
+	cVector3d lo = ch_toCVector3d(bounds.lo), hi = ch_toCVector3d(bounds.hi);
+	double diagonal = lo.distance(hi);
+
+	// deterministic segments about as long as a fast device step, 5% of the object size
+	vector <cVector3d> starts(numSegments), ends(numSegments);
+	unsigned int seed = 12345;
+	for (unsigned int i = 0; i < numSegments; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			double u = (seed >> 8) / 16777216.0;
+			seed = seed * 1664525u + 1013904223u;
+			double w = (seed >> 8) / 16777216.0;
+
+			starts[i](axis) = lo(axis) - 0.1 * diagonal + u * (hi(axis) - lo(axis) + 0.2 * diagonal);
+			ends[i](axis) = starts[i](axis) + (w - 0.5) * 0.1 * diagonal;
+		}
+	}
+
+	ch_contactManifold saved(contacts);
+
+	// every segment is a query of its own, none may be skipped
+	double savedSpeed = maxDeviceSpeed;
+	maxDeviceSpeed = 0.0;
+	skipTicks = 0;
+	vector <vector <int> > results[maxTypes];
+	cVector3d intersectionPt;
+	cPrecisionClock clock;
+
+	for (int type = 0; type < numTypes; type++)
+	{
+		ch_setBroadphase((ch_broadphaseType)type);
+		results[type].resize(numSegments);
+		hits[type] = 0;
+
+		clock.reset();
+		clock.start();
+		for (unsigned int i = 0; i < numSegments; i++)
+		{
+			contacts.ch_clear();
+			ch_checkCollisions(starts[i], ends[i], intersectionPt);
+			hits[type] += contacts.ch_size();
+			for (unsigned int k = 0; k < contacts.ch_size(); k++)
+				results[type][i].push_back(contacts[k].triangle);
+		}
+		seconds[type] = clock.stop();
+	}
+	contacts = saved;
+	maxDeviceSpeed = savedSpeed;
+
+	// every structure has to report the same triangles as the linear scan for every segment
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < numSegments; i++)
+	{
+		sort(results[0][i].begin(), results[0][i].end());
+		for (int type = 1; type < numTypes; type++)
+		{
+			sort(results[type][i].begin(), results[type][i].end());
+			if (results[0][i] != results[type][i])
+				mismatches++;
+		}
+	}
+
+	int winner = 0, second = -1;
+	for (int type = 1; type < numTypes; type++)
+	{
+		if (seconds[type] < seconds[winner])
+		{
+			second = winner;
+			winner = type;
+		}
+		else if (second < 0 || seconds[type] < seconds[second])
+		{
+			second = type;
+		}
+	}
+
+	printf("\nbroadphase benchmark: %u triangles, %u segments\n", numTrianglesObject, numSegments);
+	printf("grid: cell size %lf, %u occupied cells, %u triangle references\n", grid.ch_getCellSize(), grid.ch_getNumOccupiedCells(), grid.ch_getNumReferences());
+	printf("tree: %u nodes\n", tree.ch_getNumNodes());
+	if (compact.ch_isBuilt())
+		printf("compact: %.1lf bytes/triangle, largest vertex error %lg\n", (double)compact.ch_getMemoryUsage() / numTrianglesObject, compact.ch_getMaxError());
+	if (convex.ch_isBuilt())
+		printf("convex: %u faces\n", convex.ch_getNumFaces());
+	for (int type = 0; type < numTypes; type++)
+		printf("%-8s %10.1lf ns/query %8u hits\n", names[type], 1.0e9 * seconds[type] / numSegments, hits[type]);
+	printf("winner: %s (%.2lfx over %s)%s\n", names[winner], seconds[second] / cMax(seconds[winner], 1.0e-12), names[second],
+		mismatches ? " - WARNING: structures disagree" : "");
+	if (mismatches)
+		printf("%u segments with different results\n", mismatches);
+
+	ch_setBroadphase(selectWinner ? (ch_broadphaseType)winner : previous);
+	return (ch_broadphaseType)winner;
+}
+
+
+
+// let the object deform
+void ch_segmentTriangleCollisionChecker::ch_enableDeformation(unsigned int numThreads)
+{
+	if (deformable)
+		return;
+
+	cMesh* mesh = object->getMesh(0);
+	unsigned int numVertices = mesh->getNumVertices();
+
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > positions(numVertices);
+	for (unsigned int v = 0; v < numVertices; v++)
+		positions[v] = ch_toVec3(cAdd(mesh->getGlobalPos(), cMul(mesh->getGlobalRot(), object->getVertexPos(v))));
+
+	vector<unsigned int> indices(3 * numTrianglesObject);
+	for (unsigned int i = 0; i < numTrianglesObject; i++)
+	{
+		indices[3 * i] = mesh->m_triangles->getVertexIndex0(i);
+		indices[3 * i + 1] = mesh->m_triangles->getVertexIndex1(i);
+		indices[3 * i + 2] = mesh->m_triangles->getVertexIndex2(i);
+	}
+
+	deformable = new ch_deformableMesh();
+	deformable->ch_build(positions, indices, numThreads);
+
+	// a clearance of the rigid object no longer holds
+	skipTicks = 0;
+	ch_setBroadphase(CH_BROADPHASE_TREE);
+	ch_beginQuery();
+}
+
+
+// vertices of the mesh have moved
+void ch_segmentTriangleCollisionChecker::ch_updateDeformedVertices(unsigned int firstVertex, unsigned int numVertices)
+{
+	if (!deformable || numVertices == 0)
+		return;
+
+	cMesh* mesh = object->getMesh(0);
+	vector<ch_vec3, ch_alignedAllocator<ch_vec3> > positions(numVertices);
+	for (unsigned int v = 0; v < numVertices; v++)
+		positions[v] = ch_toVec3(cAdd(mesh->getGlobalPos(), cMul(mesh->getGlobalRot(), object->getVertexPos(firstVertex + v))));
+
+	deformable->ch_setVertices(firstVertex, numVertices, &positions[0]);
+}
+
+
+
+// the checker runs on a collision proxy
+void ch_segmentTriangleCollisionChecker::ch_setVisualObject(const ch_collisionProxy* proxy)
+{
+	visualObject = proxy->ch_getVisualObject();
+	visualMapping = &proxy->ch_getDecimator();
 }
 
 
@@ -120,26 +1179,31 @@ bool ch_segmentTriangleCollisionChecker::ch_sameSide(const cVector3d& intersecti
 // highlight the collided triangles
 void ch_segmentTriangleCollisionChecker::ch_highlightTriangles()
 {
-	vector<int>::iterator it;
-	it = collidedTriangleIndex.begin();
-
-	if (collidedTriangleIndex.size() > 0)
+	if (!contacts.ch_isEmpty())
 	{
-		while (it != collidedTriangleIndex.end())
+		cMesh* mesh = visualObject->getMesh(0);
+
+		for (unsigned int i = 0; i < contacts.ch_size(); i++)
 		{
-						
-			int vertex0 = object->getMesh(0)->m_triangles->getVertexIndex0(*it);
-			int vertex1 = object->getMesh(0)->m_triangles->getVertexIndex1(*it);
-			int vertex2 = object->getMesh(0)->m_triangles->getVertexIndex2(*it);
+			// a proxy triangle stands for several visual ones
+			unsigned int single = (unsigned int)contacts[i].triangle;
+			const unsigned int* first = &single;
+			const unsigned int* last = first + 1;
+			if (visualMapping)
+				visualMapping->ch_getVisualTriangles(single, first, last);
 
-			
-			object->getMesh(0)->m_triangles->m_vertices->setColor(vertex0, 1.0, 0.0, 0.0);
-			object->getMesh(0)->m_triangles->m_vertices->setColor(vertex1, 1.0, 0.0, 0.0);
-			object->getMesh(0)->m_triangles->m_vertices->setColor(vertex2, 1.0, 0.0, 0.0);
+			for (; first != last; ++first)
+			{
+				int vertex0 = mesh->m_triangles->getVertexIndex0(*first);
+				int vertex1 = mesh->m_triangles->getVertexIndex1(*first);
+				int vertex2 = mesh->m_triangles->getVertexIndex2(*first);
 
-			++it;
+				mesh->m_triangles->m_vertices->setColor(vertex0, 1.0, 0.0, 0.0);
+				mesh->m_triangles->m_vertices->setColor(vertex1, 1.0, 0.0, 0.0);
+				mesh->m_triangles->m_vertices->setColor(vertex2, 1.0, 0.0, 0.0);
+			}
 		}
-		collidedTriangleIndex.clear();
+		ch_clearContacts();
 	}
 }
 
@@ -147,15 +1211,15 @@ void ch_segmentTriangleCollisionChecker::ch_highlightTriangles()
 void ch_segmentTriangleCollisionChecker::ch_unHighlightTriangles()
 {
 	// reset colors 
-	for (unsigned int i = 0; i < object->getNumVertices(); i++)
+	for (unsigned int i = 0; i < visualObject->getNumVertices(); i++)
 	{
 		cColorb color;
 		color.set(
-			GLuint(0xff * (1.0 + object->getMesh(0)->m_vertices->getLocalPos(i).x()) / (2.0 * 1.0)),
-			GLuint(0xff * (1.0 + object->getMesh(0)->m_vertices->getLocalPos(i).y()) / (2.0 * 1.0)),
-			GLuint(0xff * object->getMesh(0)->m_vertices->getLocalPos(i).z() / 2 * 1.0)
+			GLuint(0xff * (1.0 + visualObject->getMesh(0)->m_vertices->getLocalPos(i).x()) / (2.0 * 1.0)),
+			GLuint(0xff * (1.0 + visualObject->getMesh(0)->m_vertices->getLocalPos(i).y()) / (2.0 * 1.0)),
+			GLuint(0xff * visualObject->getMesh(0)->m_vertices->getLocalPos(i).z() / 2 * 1.0)
 			);
-		object->getMesh(0)->m_vertices->setColor(i, color);
+		visualObject->getMesh(0)->m_vertices->setColor(i, color);
 		
 	}
 
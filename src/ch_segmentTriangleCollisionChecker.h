@@ -11,32 +11,90 @@
 #include "chai3d.h"
 
 // local includes
+#include "ch_aabbTree.h"
+#include "ch_compactMesh.h"
+#include "ch_contactManifold.h"
+#include "ch_chai3dAdapters.h"
+#include "ch_collisionProxy.h"
+#include "ch_convexCollider.h"
+#include "ch_deformableMesh.h"
+#include "ch_geometry.h"
 #include "ch_plane.h"
+#include "ch_threadPool.h"
+#include "ch_uniformGrid.h"
+#include "ch_distanceField.h"
 
 using namespace chai3d;
 using namespace std;
 
-#define SMALL_NUM  0.00000001 // anything that avoids division overflow	
+// acceleration structure used to find the triangles a segment can touch
+enum ch_broadphaseType
+{
+	CH_BROADPHASE_LINEAR,	// test every triangle of the object
+	CH_BROADPHASE_GRID,		// walk the hashed uniform grid with 3D-DDA
+	CH_BROADPHASE_TREE,		// walk the AABB tree, the only one that follows deformations
+	CH_BROADPHASE_CONVEX,	// clip against the face planes, closed convex objects only
+	CH_BROADPHASE_COMPACT	// walk the quantized copy of the tree, rigid objects only; hits within a quantization step
+};
 
-class ch_segmentTriangleCollisionChecker
+// what a collision query has to find
+enum ch_queryMode
 {
+	CH_QUERY_ANY,		// stop at the first triangle hit, eg. to test for contact
+	CH_QUERY_NEAREST,	// only the hit closest to the segment start, eg. to advance the GO
+	CH_QUERY_ALL		// every triangle hit, sorted along the segment, eg. for highlighting
+};
+
+// triangles per chunk when the planes are computed on a thread pool
+#define CH_SETUP_GRAIN 4096
+
+// largest number of segments traversed together by ch_checkCollisionsBatch(), one bit each in a mask
+#define CH_MAX_PACKET_SIZE 64
 
-	friend class ch_GOAlgorithm;
+// most queries skipped in a row by the proximity culling, however far the device is
+#define CH_PROXIMITY_MAX_SKIP 1000
 
+// triangle hit by one segment of a batch query
+struct ch_segmentHit
+{
+	unsigned int segment;	// index of the segment in the batch
+	int triangle;			// index of the triangle hit
+	double t;				// segment parameter of the hit
+};
+
+class ch_segmentTriangleCollisionChecker
+{
 public:
 
-	// constructor
-	ch_segmentTriangleCollisionChecker(cMultiMesh* obj);
+	// the grid and the distance field hold 32 byte aligned members
+	CH_ALIGNED_OPERATOR_NEW
+
+	// constructor, computes the triangle planes, on the pool if one is given
+	ch_segmentTriangleCollisionChecker(cMultiMesh* obj, ch_threadPool* pool = NULL);
 
 	// destructor
-	virtual ~ch_segmentTriangleCollisionChecker() {};
+	virtual ~ch_segmentTriangleCollisionChecker() { delete deformable; };
+
+	// check for GO-device segment-triangle collisions. the triangles hit are appended to the contacts and
+	// intersectionPoint is set to the hit nearest to lastDevicePosition. returns the number of contacts
+	// this query added
+	unsigned int ch_checkCollisions(const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, ch_queryMode mode = CH_QUERY_ALL);
 
-	// check for GO-device segment-triangle collisions
-	void ch_checkCollisions(const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d intersectionPoint);
+	// ch_checkCollisions() for ticks that must not overrun: at most triangleBudget triangle tests, the
+	// contacts of the previous budgeted query first, then the broadphase cells or leaves in segment order.
+	// the tests done are subtracted from triangleBudget. complete is false if the budget ran out before
+	// the query was answered, the hits found so far are reported as usual
+	unsigned int ch_checkCollisionsBudgeted(const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint, unsigned int& triangleBudget, bool& complete, ch_queryMode mode = CH_QUERY_ALL);
 
 	// called from ch_checkCollisions()
 	int ch_checkSegTriangleCollision(const unsigned int TriangleIndex, const cVector3d& lastDevicePosition, const cVector3d& currentDevicePosition, cVector3d& intersectionPoint);
 
+	// check a batch of segments, eg. the points of a multi-point tool or the sub-steps of a fast device
+	// move. the acceleration structure is traversed and every triangle loaded once per packet of up to
+	// CH_MAX_PACKET_SIZE segments. hits are appended to hits grouped by segment, in segment order along
+	// each segment; the collided triangles are not touched. returns the number of hits appended
+	unsigned int ch_checkCollisionsBatch(const cVector3d* segmentStarts, const cVector3d* segmentEnds, unsigned int numSegments, vector<ch_segmentHit>& hits, ch_queryMode mode = CH_QUERY_ALL);
+
 	// check if a given point lies inside a given triangle
 	bool ch_pointInTriangle(const cVector3d& intersectionPoint, const cVector3d& vertex0, const cVector3d& vertex1, const cVector3d& vertex2);
 
@@ -44,30 +102,306 @@ public:
 	// formed by the first two vertices
 	bool ch_sameSide(const cVector3d& intersectionPoint, const cVector3d& third_vertex, const cVector3d& first_vertex, const cVector3d& second_vertex);
 
+	// choose the acceleration structure, the grid, the tree, the convex faces and the compact tree are built
+	// on first use. deformable objects always use the tree, objects that are not convex keep the current
+	// structure
+	void ch_setBroadphase(ch_broadphaseType type);
+
+	// return the acceleration structure in use
+	inline ch_broadphaseType ch_getBroadphase() const { return broadphase; }
+
+	// time every exact broadphase on random segments through the object, print which one wins and
+	// optionally switch to it. the compact tree does not compete, its hits may differ near triangle edges
+	ch_broadphaseType ch_benchmarkBroadphase(const unsigned int numSegments, bool selectWinner);
+
+	// build the grid, the tree, the convex faces and optionally the distance field at once on a pool,
+	// eg. at load time, instead of on first use
+	void ch_prepare(ch_threadPool* pool, bool withDistanceField = true);
+
+	// build the narrow-band distance field used to reject segments far from the surface before any
+	// triangle test. sizes <= 0 are derived from the object bounds. not used for deformable objects
+	void ch_buildDistanceField(double voxelSize = 0.0, double bandWidth = 0.0);
+
+	// has the distance field been built?
+	inline bool ch_hasDistanceField() const { return distanceField.ch_isBuilt(); }
+
+	// estimate the closest surface point and the penetration depth of a point inside the object,
+	// eg. to recover the GO when the segment test missed the surface; needs the distance field, or the
+	// convex faces which give the exact answer
+	bool ch_estimatePenetration(const cVector3d& point, cVector3d& surfacePoint, double& depth) const;
+
+	// closest surface point to a point among the triangles closer than radius [m], eg. for a proxy radius,
+	// a force field before contact, putting a lost GO back on the surface or highlighting what lies under
+	// the cursor. searches the tree, nearer boxes first, and skips boxes and triangle planes farther than
+	// the best triangle so far. returns false if no triangle is that close. a deformable object is searched
+	// in the snapshot of its last collision query, only the ch_checkCollisions() calls pick a newer one
+	bool ch_findClosestPoint(const cVector3d& point, double radius, cVector3d& closestPoint, double& distance, int& TriangleIndex);
+
+	// ch_findClosestPoint() by testing every triangle, the reference for it
+	bool ch_findClosestPointLinear(const cVector3d& point, double radius, cVector3d& closestPoint, double& distance, int& TriangleIndex);
+
+	// a triangle of the plane (normal, w = d) closer than maxDistance to a point, eg. the one of a flat face
+	// that a GO constrained by the plane slid onto; -1 if there is none
+	int ch_findTriangleOnPlane(const ch_vec3& point, const ch_vec3& plane, double maxDistance);
+
+	// let the object deform: from now on the queries run on snapshots of the geometry that a worker
+	// thread keeps up to date with ch_updateDeformedVertices(). large updates are split over numThreads
+	// threads, 0 picks the number of cores
+	void ch_enableDeformation(unsigned int numThreads = 0);
+
+	// is the object a closed convex solid? builds the faces on first call
+	bool ch_isConvex();
+
+	// faces of a convex object, empty unless ch_isConvex()
+	inline const ch_convexCollider& ch_getConvexCollider() const { return convex; }
+
+	// is the object deformable?
+	inline bool ch_isDeformable() const { return deformable != NULL; }
+
+	// graphics thread: vertices [firstVertex, firstVertex + numVertices) of the mesh have moved. returns
+	// at once, the haptic thread sees the change a few hundred microseconds later
+	void ch_updateDeformedVertices(unsigned int firstVertex, unsigned int numVertices);
+
+	// deformable geometry, eg. to wait for pending updates with ch_flush(); NULL for rigid objects
+	inline ch_deformableMesh* ch_getDeformableMesh() { return deformable; }
+
+	// world space bounds of the geometry the next query runs on
+	ch_aabb ch_getBounds();
+
+	// world space triangle as seen by the last query
+	inline const ch_triangle& ch_getTriangle(unsigned int TriangleIndex) const { return (*queryTriangles)[TriangleIndex]; }
+	inline unsigned int ch_getNumTriangles() const { return (unsigned int)queryTriangles->size(); }
+
+	// world space triangles of a rigid object, eg. to share them with a ch_GOBatch
+	inline const ch_triangleArray& ch_getTriangles() const { return triangles; }
+
+	// AABB tree over the triangles of a rigid object, built on first call
+	const ch_aabbTree& ch_getTree();
+
+	// quantized copy of the triangles and the tree of a rigid object, built on first call
+	const ch_compactMesh& ch_getCompactMesh();
+
+	// number of collision queries, and how many of them the distance field rejected
+	inline unsigned int ch_getNumQueries() const { return numQueries; }
+	inline unsigned int ch_getNumRejectedQueries() const { return numRejectedQueries; }
+
+	// number of budgeted queries that ran out of budget
+	inline unsigned int ch_getNumIncompleteQueries() const { return numIncompleteQueries; }
+
+	// conservative proximity culling: a query without contact computes the clearance of the device, its
+	// distance to the object bounds or, within the band of the distance field, to the surface, and the next
+	// clearance / (maxSpeed * tickPeriod) queries return at once. a device found outside the clearance, ie.
+	// faster than maxSpeed [m/s], ends the skip early. tickPeriod [s] is the time between queries, a maxSpeed
+	// of 0 turns the culling off. not used for deformable objects
+	void ch_setProximityCulling(double maxSpeed, double tickPeriod);
+
+	// number of queries skipped by the proximity culling, and of skips ended by a too fast device
+	inline unsigned int ch_getNumSkippedQueries() const { return numSkippedQueries; }
+	inline unsigned int ch_getNumSkipAborts() const { return numSkipAborts; }
+
+	// queries left to skip, and the clearance [m] they rely on
+	inline unsigned int ch_getSkipTicks() const { return skipTicks; }
+	inline double ch_getClearance() const { return clearance; }
+
+	// the checker runs on the proxy, highlight the visual triangles it replaces
+	void ch_setVisualObject(const ch_collisionProxy* proxy);
+
 	// highlight the collided triangles
 	void ch_highlightTriangles();
 
 	// 'un'-highlight the collided triangles after some time
 	void ch_unHighlightTriangles();
 
-	// delete last element of the vector
-	inline void ch_popBack() { collidedTriangleIndex.pop_back(); }
+	// contacts found since the last ch_clearContacts(), those of every query in segment order
+	inline const ch_contactManifold& ch_getContacts() const { return contacts; }
+
+	// forget the last contact, eg. when a nearer hit on another object wins
+	inline void ch_removeLastContact() { contacts.ch_removeLast(); }
 
-	// clear the collidedTriangleIndex vector
-	inline void ch_clearCollidedTriangleIndex() { collidedTriangleIndex.clear(); }
+	// forget every contact
+	inline void ch_clearContacts() { contacts.ch_clear(); }
+
+	// mesh ID written into the contacts, set by ch_collisionWorld to the object handle
+	inline void ch_setMeshId(int id) { meshId = id; }
+	inline int ch_getMeshId() const { return meshId; }
 
 protected:
+	// planes and world space copies of triangles [first, last)
+	void ch_setupTriangles(unsigned int first, unsigned int last);
+
+	// world space vertices of a triangle
+	void ch_getTriangleVertices(const unsigned int TriangleIndex, cVector3d& v0, cVector3d& v1, cVector3d& v2);
+
+	// test every triangle of the object against the segment start + t direction
+	void ch_checkCollisionsLinear(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode);
+
+	// test the triangles in the grid cells along the segment start + t direction, in segment order
+	void ch_checkCollisionsGrid(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode);
+
+	// segments of a batch query that are traversed together
+	struct ch_packet
+	{
+		ch_vec3 start[CH_MAX_PACKET_SIZE];
+		ch_vec3 direction[CH_MAX_PACKET_SIZE];
+		unsigned int segment[CH_MAX_PACKET_SIZE];	// index in the batch
+		double tMax[CH_MAX_PACKET_SIZE];			// end of the segment, or nearest hit so far
+		int triangle[CH_MAX_PACKET_SIZE];			// nearest / first hit, -1 if none
+		unsigned int size;
+		unsigned long long active;					// segments that still need triangle tests
+	};
+
+	// occupied grid cell visited by some segments of a packet
+	struct ch_packetCell
+	{
+		const unsigned int* first;
+		const unsigned int* last;
+		unsigned long long mask;
+
+		bool operator<(const ch_packetCell& other) const { return first < other.first; }
+	};
+
+	// state of a budgeted query
+	struct ch_budgetedQuery
+	{
+		ch_vec3 start;
+		ch_vec3 direction;
+		ch_queryMode mode;
+		unsigned int firstHit;
+		double tMax;				// end of the segment, or nearest hit so far
+		unsigned int budget;		// triangle tests left
+		bool answered;				// any mode found its hit
+	};
+
+	// test a triangle of a budgeted query unless it was tested before in this query
+	void ch_testBudgeted(unsigned int TriangleIndex, ch_budgetedQuery& query);
+
+	// walk the broadphase for a budgeted query, returns false if the budget ran out
+	bool ch_walkBudgeted(ch_budgetedQuery& query);
+
+	// start a new mailbox query, resets the mailbox when the stamp wraps around
+	void ch_newMailboxStamp();
+
+	// test one triangle against the segments of a packet selected by mask
+	void ch_testPacket(unsigned int TriangleIndex, unsigned long long mask, ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits);
+
+	// clip every segment of a packet against the convex faces
+	void ch_checkPacketConvex(ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits);
+
+	// run a packet through every triangle of the object
+	void ch_checkPacketLinear(ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits);
+
+	// run a packet through the union of the grid cells its segments visit
+	void ch_checkPacketGrid(ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits);
+
+	// run a packet down the tree, each node tested against the segments that reached it
+	void ch_checkPacketTree(ch_packet& packet, ch_queryMode mode, vector<ch_segmentHit>& hits);
+
+	// test the triangles of the tree leaves along the segment start + t direction, nearer leaves first
+	void ch_checkCollisionsTree(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode);
+
+	// test the triangles of the compact tree leaves along the segment start + t direction, decoded leaf by leaf
+	void ch_checkCollisionsCompact(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode);
+
+	// clip the segment start + t direction against the convex faces; it enters at most once
+	void ch_checkCollisionsConvex(const ch_vec3& start, const ch_vec3& direction, ch_queryMode mode);
+
+	// pick the geometry the next query runs on: the latest snapshot of a deformable object
+	void ch_beginQuery();
+
+	// can the proximity culling skip the query of the segment [start, end]?
+	bool ch_skipQuery(const ch_vec3& start, const ch_vec3& end);
+
+	// after a query without contact: the clearance of the segment end and the queries it lets skip
+	void ch_updateClearance(const ch_vec3& end);
+
+	// record a hit of the current query; in nearest mode it replaces a farther one. returns true
+	// if the query is complete
+	bool ch_addHit(unsigned int TriangleIndex, double t, ch_queryMode mode, unsigned int firstHit, int face = -1);
+
+	// fill in point, plane and barycentrics of the contacts of the current query, from the geometry it ran on
+	void ch_finishContacts(unsigned int firstHit, const ch_vec3& start, const ch_vec3& direction);
+
 	// the cMesh object for which we will check collisions
 	cMultiMesh *object;
 
+	// the object that is highlighted, object itself unless it is a collision proxy
+	cMultiMesh* visualObject;
+
+	// visual triangles of every proxy triangle, NULL without a proxy
+	const ch_meshDecimator* visualMapping;
+
 	// number of triangles on the current object
 	unsigned int numTrianglesObject;
 
-	// indices of triangles collided
-	vector <int> collidedTriangleIndex;
+	// contacts of the queries since the last ch_clearContacts()
+	ch_contactManifold contacts;
+
+	// mesh ID of the contacts
+	int meshId;
 
 	// planes corresponding to the triangles
 	vector <ch_plane> planesForTriangles;
+
+	// world space triangles with their planes, the copy of the mesh that the queries run on
+	ch_triangleArray triangles;
+
+	// bounds of the triangles
+	ch_aabb bounds;
+
+	// geometry of the current query: triangles and tree, or the latest deformable snapshot
+	const ch_triangleArray* queryTriangles;
+	const ch_aabbTree* queryTree;
+
+	// acceleration structure in use
+	ch_broadphaseType broadphase;
+
+	// hashed uniform grid over the triangles
+	ch_uniformGrid grid;
+
+	// AABB tree over the triangles
+	ch_aabbTree tree;
+
+	// quantized copy of the triangles and the tree
+	ch_compactMesh compact;
+
+	// faces of a convex object
+	ch_convexCollider convex;
+
+	// the faces have been tried, whether the object turned out convex or not
+	bool convexChecked;
+
+	// deformable geometry, NULL for rigid objects
+	ch_deformableMesh* deformable;
+
+	// narrow-band signed distance field of the object, optional
+	ch_distanceField distanceField;
+
+	// query counters
+	unsigned int numQueries;
+	unsigned int numRejectedQueries;
+	unsigned int numIncompleteQueries;
+	unsigned int numSkippedQueries;
+	unsigned int numSkipAborts;
+
+	// proximity culling: speed bound and query period, the clearance ball and the queries left to skip
+	double maxDeviceSpeed;
+	double tickPeriod;
+	ch_vec3 clearanceCenter;
+	double clearance;
+	unsigned int skipTicks;
+
+	// triangles hit by the previous budgeted query, tested first by the next one
+	vector <int> previousContacts;
+
+	// query stamp per triangle, so that a triangle spanning several grid cells is tested once per query
+	vector <unsigned int> triangleMailbox;
+	unsigned int mailboxStamp;
+
+	// for packets: the segments a triangle has already been tested against, valid with the stamp
+	vector <unsigned long long> triangleTestedMask;
+
+	// cells visited by the current packet
+	vector <ch_packetCell> packetCells;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "ch_sharedState.h"
+
+// system includes
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// constructor
+ch_sharedState::ch_sharedState()
+{
+	block = NULL;
+	owner = false;
+	segmentName[0] = '\0';
+	mapping = NULL;
+}
+
+
+// destructor
+ch_sharedState::~ch_sharedState()
+{
+	ch_close();
+}
+
+
+// writer: create the segment
+bool ch_sharedState::ch_create(const char* name)
+{
+	if (!ch_map(name, true))
+		return false;
+
+	// a fresh segment is zero filled; one left behind by a writer that died during an update has an odd sequence
+	block->version = CH_STATE_VERSION;
+	block->sequence.store(block->sequence.load() & ~1u);
+	return true;
+}
+
+
+// reader: map an existing segment
+bool ch_sharedState::ch_open(const char* name)
+{
+	if (!ch_map(name, false))
+		return false;
+
+	if (block->version != CH_STATE_VERSION)
+	{
+		ch_close();
+		return false;
+	}
+	return true;
+}
+
+
+// map the segment, creating it if requested
+bool ch_sharedState::ch_map(const char* name, bool create)
+{
+	ch_close();
+
+#if defined(_WIN32)
+	_snprintf(segmentName, sizeof(segmentName) - 1, "Local\\%s", name);
+	segmentName[sizeof(segmentName) - 1] = '\0';
+
+	HANDLE handle = create ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(ch_sharedStateBlock), segmentName)
+		: OpenFileMappingA(FILE_MAP_READ, FALSE, segmentName);
+	if (!handle)
+		return false;
+
+	void* view = MapViewOfFile(handle, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(ch_sharedStateBlock));
+	if (!view)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+	mapping = handle;
+#else
+	snprintf(segmentName, sizeof(segmentName), "/%s", name);
+
+	int fd = create ? shm_open(segmentName, O_CREAT | O_RDWR, 0644) : shm_open(segmentName, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+
+	if (create && ftruncate(fd, sizeof(ch_sharedStateBlock)) != 0)
+	{
+		close(fd);
+		shm_unlink(segmentName);
+		return false;
+	}
+
+	// readers map the segment read only, they cannot disturb the writer
+	void* view = mmap(NULL, sizeof(ch_sharedStateBlock), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+	{
+		if (create)
+			shm_unlink(segmentName);
+		return false;
+	}
+#endif
+
+	block = (ch_sharedStateBlock*)view;
+	owner = create;
+	return true;
+}
+
+
+// unmap the segment
+void ch_sharedState::ch_close()
+{
+	if (!block)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(block);
+	CloseHandle((HANDLE)mapping);
+	mapping = NULL;
+#else
+	munmap(block, sizeof(ch_sharedStateBlock));
+	if (owner)
+		shm_unlink(segmentName);
+#endif
+
+	block = NULL;
+	owner = false;
+}
+
+
+// writer: publish one state
+void ch_sharedState::ch_publish(const ch_hapticState& state)
+{
+	if (!block)
+		return;
+
+	// odd sequence while the state is written, readers that see it or see it change copy again
+	unsigned int sequence = block->sequence.load(memory_order_relaxed);
+	block->sequence.store(sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	memcpy(&block->state, &state, sizeof(ch_hapticState));
+
+	block->sequence.store(sequence + 2, memory_order_release);
+}
+
+
+// reader: copy a consistent state
+bool ch_sharedState::ch_read(ch_hapticState& state, unsigned int maxAttempts) const
+{
+	if (!block)
+		return false;
+
+	for (unsigned int attempt = 0; attempt < maxAttempts; attempt++)
+	{
+		unsigned int before = block->sequence.load(memory_order_acquire);
+		if (before & 1)
+			continue;
+
+		memcpy(&state, &block->state, sizeof(ch_hapticState));
+
+		atomic_thread_fence(memory_order_acquire);
+		if (block->sequence.load(memory_order_relaxed) == before)
+			return true;
+	}
+	return false;
+}
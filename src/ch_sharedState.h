@@ -0,0 +1,116 @@
+#ifndef CH_SHAREDSTATE_H
+#define CH_SHAREDSTATE_H
+
+// CH lab
+// state of the haptic loop in a named shared memory segment (POSIX shm, a file mapping on Windows), for
+// dashboards, loggers and visualizers in other processes. the haptic thread writes it every tick under a
+// seqlock: the writer never waits and never takes a lock, readers copy the state and retry if the
+// writer was in the middle of an update
+
+// system includes
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+// default name of the segment
+#define CH_STATE_NAME "ch_haptic_state"
+
+// contacts published per tick, further ones are counted but not listed
+#define CH_STATE_MAX_CONTACTS 16
+
+// layout version, increase when ch_hapticState changes
+#define CH_STATE_VERSION 2
+
+
+// one tick of the haptic loop, plain data with a fixed layout
+struct ch_hapticState
+{
+	// tick number and time since the loop started [s]
+	unsigned long long tick;
+	double time;
+
+	// proxy (GO) and device positions [m], force sent to the device [N]
+	double proxyPos[3];
+	double devicePos[3];
+	double force[3];
+
+	// triangles in contact, the first CH_STATE_MAX_CONTACTS of numContacts are listed
+	unsigned int numContacts;
+	int contacts[CH_STATE_MAX_CONTACTS];
+
+	// collision queries of the current object, how many of them the proximity culling skipped, and the
+	// queries it will skip next on the clearance [m] of the device
+	unsigned long long numQueries;
+	unsigned long long numSkippedQueries;
+	unsigned int skipTicks;
+	double clearance;
+
+	// loop statistics: last, mean and longest tick period [s], ticks longer than 1 ms
+	double tickPeriod;
+	double meanTickPeriod;
+	double maxTickPeriod;
+	unsigned long long numOverruns;
+};
+
+
+// what the segment holds
+struct ch_sharedStateBlock
+{
+	// CH_STATE_VERSION of the writer
+	unsigned int version;
+
+	// odd while the writer updates state
+	atomic<unsigned int> sequence;
+
+	ch_hapticState state;
+};
+
+
+class ch_sharedState
+{
+public:
+
+	// constructor
+	ch_sharedState();
+
+	// destructor, unmaps the segment (and removes it if it was created here)
+	virtual ~ch_sharedState();
+
+	// writer: create the segment, or reuse it if it exists. returns false on failure
+	bool ch_create(const char* name = CH_STATE_NAME);
+
+	// reader: map an existing segment. returns false if there is none or its layout differs
+	bool ch_open(const char* name = CH_STATE_NAME);
+
+	// unmap the segment
+	void ch_close();
+
+	// is a segment mapped?
+	inline bool ch_isOpen() const { return block != NULL; }
+
+	// writer: publish one state, never waits
+	void ch_publish(const ch_hapticState& state);
+
+	// reader: copy a consistent state. returns false if the writer kept updating for maxAttempts tries
+	bool ch_read(ch_hapticState& state, unsigned int maxAttempts = 1000) const;
+
+protected:
+
+	// map the segment, creating it if requested
+	bool ch_map(const char* name, bool create);
+
+	// the mapped segment
+	ch_sharedStateBlock* block;
+
+	// the segment was created here
+	bool owner;
+
+	// name of the segment
+	char segmentName[64];
+
+	// handle of the file mapping (Windows)
+	void* mapping;
+};
+
+#endif
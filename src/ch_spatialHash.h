@@ -0,0 +1,86 @@
+#ifndef CH_SPATIALHASH_H
+#define CH_SPATIALHASH_H
+
+// CH lab
+// open addressing table from packed 3D cell keys to indices, shared by the grid and the distance field
+
+// system includes
+#include <vector>
+
+using namespace std;
+
+// pack cell coordinates (21 bits each) into a key
+inline unsigned long long ch_packCellKey(int ix, int iy, int iz)
+{
+	return (unsigned long long)ix | ((unsigned long long)iy << 21) | ((unsigned long long)iz << 42);
+}
+
+
+class ch_spatialHash
+{
+public:
+
+	// constructor
+	ch_spatialHash() { mask = 0; };
+
+	// destructor
+	virtual ~ch_spatialHash() {};
+
+	// build the table over unique keys, key i maps to index i
+	void ch_build(const vector<unsigned long long>& keys)
+	{
+		// table at most half full
+		unsigned int tableSize = 1;
+		while (tableSize < 2 * keys.size())
+			tableSize <<= 1;
+		mask = tableSize - 1;
+		slotKeys.assign(tableSize, 0);
+		slotIndices.assign(tableSize, -1);
+
+		for (unsigned int i = 0; i < keys.size(); i++)
+		{
+			unsigned int slot = ch_hash(keys[i]) & mask;
+			while (slotIndices[slot] != -1)
+				slot = (slot + 1) & mask;
+			slotKeys[slot] = keys[i];
+			slotIndices[slot] = (int)i;
+		}
+	}
+
+	// index stored for the key, -1 if the key is not in the table
+	inline int ch_find(unsigned long long key) const
+	{
+		if (slotIndices.empty())
+			return -1;
+
+		unsigned int slot = ch_hash(key) & mask;
+		while (slotIndices[slot] != -1)
+		{
+			if (slotKeys[slot] == key)
+				return slotIndices[slot];
+			slot = (slot + 1) & mask;
+		}
+		return -1;
+	}
+
+	// remove all keys
+	inline void ch_clear() { slotKeys.clear(); slotIndices.clear(); mask = 0; }
+
+protected:
+
+	// hash of a packed cell key
+	static inline unsigned int ch_hash(unsigned long long key)
+	{
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		return (unsigned int)key;
+	}
+
+	// keys and indices per slot, -1 marks a free slot
+	vector<unsigned long long> slotKeys;
+	vector<int> slotIndices;
+	unsigned int mask;
+};
+
+#endif
@@ -0,0 +1,259 @@
+#include "ch_sweepAndPrune.h"
+
+// system includes
+#include <algorithm>
+
+// where new and removed boxes sit, beyond everything in the scene
+#define CH_SAP_FAR 1e300
+
+
+// constructor
+ch_sweepAndPrune::ch_sweepAndPrune()
+{
+	numSwaps = 0;
+}
+
+
+// add the box of an object or of a tool
+unsigned int ch_sweepAndPrune::ch_addBox(const ch_aabb& box, bool tool)
+{
+	unsigned int handle;
+	if (!freeBoxes.empty())
+	{
+		handle = freeBoxes.back();
+		freeBoxes.pop_back();
+	}
+	else
+	{
+		handle = (unsigned int)boxes.size();
+		boxes.push_back(ch_box());
+	}
+
+	ch_box& b = boxes[handle];
+	b.used = true;
+	b.tool = -1;
+	if (tool)
+	{
+		if (!freeTools.empty())
+		{
+			b.tool = (int)freeTools.back();
+			freeTools.pop_back();
+		}
+		else
+		{
+			b.tool = (int)toolOverlaps.size();
+			toolOverlaps.push_back(vector<unsigned int>());
+		}
+		toolOverlaps[b.tool].clear();
+	}
+
+	// the box starts far away at the end of every axis and is moved in like any other box
+	for (int axis = 0; axis < 3; axis++)
+	{
+		b.lo[axis] = b.hi[axis] = CH_SAP_FAR;
+		for (unsigned int isMax = 0; isMax < 2; isMax++)
+		{
+			ch_endpoint e = { CH_SAP_FAR, handle, isMax };
+			b.endpoint[axis][isMax] = (unsigned int)endpoints[axis].size();
+			endpoints[axis].push_back(e);
+		}
+	}
+
+	ch_updateBox(handle, box);
+	return handle;
+}
+
+
+// move or resize a box
+void ch_sweepAndPrune::ch_updateBox(unsigned int handle, const ch_aabb& box)
+{
+	double lo[3] = { box.lo.x, box.lo.y, box.lo.z };
+	double hi[3] = { box.hi.x, box.hi.y, box.hi.z };
+	ch_moveBox(handle, lo, hi);
+}
+
+
+// remove a box
+void ch_sweepAndPrune::ch_removeBox(unsigned int handle)
+{
+	// far away it overlaps nothing and its endpoints are the last ones of every axis
+	double far[3] = { CH_SAP_FAR, CH_SAP_FAR, CH_SAP_FAR };
+	ch_moveBox(handle, far, far);
+
+	ch_box& b = boxes[handle];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// order the two far endpoints so that they can be dropped from the end
+		unsigned int last = (unsigned int)endpoints[axis].size() - 1;
+		for (unsigned int isMax = 0; isMax < 2; isMax++, last--)
+		{
+			unsigned int index = b.endpoint[axis][isMax];
+			if (index != last)
+			{
+				ch_endpoint other = endpoints[axis][last];
+				endpoints[axis][last] = endpoints[axis][index];
+				endpoints[axis][index] = other;
+				boxes[other.box].endpoint[axis][other.isMax] = index;
+				b.endpoint[axis][isMax] = last;
+			}
+		}
+		endpoints[axis].resize(endpoints[axis].size() - 2);
+	}
+
+	if (b.tool >= 0)
+	{
+		toolOverlaps[b.tool].clear();
+		freeTools.push_back(b.tool);
+	}
+	b.used = false;
+	freeBoxes.push_back(handle);
+}
+
+
+// set the bounds of a box and move its endpoints
+void ch_sweepAndPrune::ch_moveBox(unsigned int handle, const double lo[3], const double hi[3])
+{
+	ch_box& b = boxes[handle];
+
+	// the overlap tests see the final bounds on every axis while the endpoints are still being sorted
+	double oldLo[3], oldHi[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		oldLo[axis] = b.lo[axis];
+		oldHi[axis] = b.hi[axis];
+		b.lo[axis] = lo[axis];
+		b.hi[axis] = hi[axis];
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		unsigned int minIndex = b.endpoint[axis][0];
+		endpoints[axis][minIndex].value = lo[axis];
+		if (lo[axis] < oldLo[axis])
+			ch_sortDown(axis, minIndex);
+		else if (lo[axis] > oldLo[axis])
+			ch_sortUp(axis, minIndex);
+
+		unsigned int maxIndex = b.endpoint[axis][1];
+		endpoints[axis][maxIndex].value = hi[axis];
+		if (hi[axis] < oldHi[axis])
+			ch_sortDown(axis, maxIndex);
+		else if (hi[axis] > oldHi[axis])
+			ch_sortUp(axis, maxIndex);
+	}
+}
+
+
+// move an endpoint down its axis
+void ch_sweepAndPrune::ch_sortDown(int axis, unsigned int index)
+{
+	vector<ch_endpoint>& e = endpoints[axis];
+	ch_endpoint moving = e[index];
+
+	while (index > 0 && e[index - 1].value > moving.value)
+	{
+		const ch_endpoint& other = e[index - 1];
+
+		// a min passing a max below: the boxes may overlap now; a max passing a min: they no longer do
+		if (other.box != moving.box)
+		{
+			if (!moving.isMax && other.isMax)
+				ch_overlapMayStart(moving.box, other.box);
+			else if (moving.isMax && !other.isMax)
+				ch_overlapMayEnd(moving.box, other.box);
+		}
+
+		e[index] = other;
+		boxes[other.box].endpoint[axis][other.isMax] = index;
+		index--;
+		numSwaps++;
+	}
+
+	e[index] = moving;
+	boxes[moving.box].endpoint[axis][moving.isMax] = index;
+}
+
+
+// move an endpoint up its axis
+void ch_sweepAndPrune::ch_sortUp(int axis, unsigned int index)
+{
+	vector<ch_endpoint>& e = endpoints[axis];
+	ch_endpoint moving = e[index];
+	unsigned int size = (unsigned int)e.size();
+
+	while (index + 1 < size && e[index + 1].value < moving.value)
+	{
+		const ch_endpoint& other = e[index + 1];
+
+		// a max passing a min above: the boxes may overlap now; a min passing a max: they no longer do
+		if (other.box != moving.box)
+		{
+			if (moving.isMax && !other.isMax)
+				ch_overlapMayStart(moving.box, other.box);
+			else if (!moving.isMax && other.isMax)
+				ch_overlapMayEnd(moving.box, other.box);
+		}
+
+		e[index] = other;
+		boxes[other.box].endpoint[axis][other.isMax] = index;
+		index++;
+		numSwaps++;
+	}
+
+	e[index] = moving;
+	boxes[moving.box].endpoint[axis][moving.isMax] = index;
+}
+
+
+// record an overlap between a tool and an object
+void ch_sweepAndPrune::ch_overlapMayStart(unsigned int a, unsigned int b)
+{
+	// only tool-object pairs are tracked
+	if ((boxes[a].tool >= 0) == (boxes[b].tool >= 0))
+		return;
+
+	if (boxes[b].tool >= 0)
+		swap(a, b);
+
+	if (!ch_overlap(boxes[a], boxes[b]))
+		return;
+
+	vector<unsigned int>& overlaps = toolOverlaps[boxes[a].tool];
+	if (find(overlaps.begin(), overlaps.end(), b) == overlaps.end())
+		overlaps.push_back(b);
+}
+
+
+// drop an overlap between a tool and an object
+void ch_sweepAndPrune::ch_overlapMayEnd(unsigned int a, unsigned int b)
+{
+	if ((boxes[a].tool >= 0) == (boxes[b].tool >= 0))
+		return;
+
+	if (boxes[b].tool >= 0)
+		swap(a, b);
+
+	// the box may have moved past the other one on this axis and still overlap it once all axes are done
+	if (ch_overlap(boxes[a], boxes[b]))
+		return;
+
+	vector<unsigned int>& overlaps = toolOverlaps[boxes[a].tool];
+	vector<unsigned int>::iterator it = find(overlaps.begin(), overlaps.end(), b);
+	if (it != overlaps.end())
+	{
+		*it = overlaps.back();
+		overlaps.pop_back();
+	}
+}
+
+
+// do two boxes overlap?
+bool ch_sweepAndPrune::ch_overlap(const ch_box& a, const ch_box& b) const
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (a.hi[axis] < b.lo[axis] || b.hi[axis] < a.lo[axis])
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,100 @@
+#ifndef CH_SWEEPANDPRUNE_H
+#define CH_SWEEPANDPRUNE_H
+
+// CH lab
+// incremental sweep and prune over the bounding boxes of the objects of a scene and of the tools that
+// probe it. the box endpoints stay sorted along every axis; a box that moves a little swaps with a few
+// neighbours only, and every swap that starts or ends an overlap between a tool and an object updates the
+// list of objects the tool touches. the cost per update depends on how far the box moved, not on the
+// number of objects. no CHAI3D dependency
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_geometry.h"
+
+using namespace std;
+
+
+class ch_sweepAndPrune
+{
+public:
+
+	// constructor
+	ch_sweepAndPrune();
+
+	// destructor
+	virtual ~ch_sweepAndPrune() {};
+
+	// add the box of an object or of a tool, returns its handle. handles of removed boxes are reused
+	unsigned int ch_addBox(const ch_aabb& box, bool tool);
+
+	// move or resize a box
+	void ch_updateBox(unsigned int handle, const ch_aabb& box);
+
+	// remove a box
+	void ch_removeBox(unsigned int handle);
+
+	// objects [first, last) whose boxes overlap the box of a tool
+	inline void ch_getOverlaps(unsigned int tool, const unsigned int*& first, const unsigned int*& last) const
+	{
+		const vector<unsigned int>& overlaps = toolOverlaps[boxes[tool].tool];
+		first = overlaps.empty() ? NULL : &overlaps[0];
+		last = first + overlaps.size();
+	}
+
+	// number of endpoint swaps so far, the work done by the updates
+	inline unsigned long long ch_getNumSwaps() const { return numSwaps; }
+
+protected:
+
+	// end of a box on one axis
+	struct ch_endpoint
+	{
+		double value;
+		unsigned int box;
+		unsigned int isMax;
+	};
+
+	// registered box
+	struct ch_box
+	{
+		double lo[3], hi[3];
+
+		// position of its endpoints in the sorted arrays, [axis][isMax]
+		unsigned int endpoint[3][2];
+
+		// index in toolOverlaps for a tool, -1 for an object
+		int tool;
+
+		bool used;
+	};
+
+	// move an endpoint down or up its axis to its sorted position, reporting the overlaps that start or end
+	void ch_sortDown(int axis, unsigned int index);
+	void ch_sortUp(int axis, unsigned int index);
+
+	// two endpoints of boxes a and b swapped: record or drop the overlap if one is a tool and the other an object
+	void ch_overlapMayStart(unsigned int a, unsigned int b);
+	void ch_overlapMayEnd(unsigned int a, unsigned int b);
+
+	// do two boxes overlap?
+	bool ch_overlap(const ch_box& a, const ch_box& b) const;
+
+	// set the bounds of a box and move its endpoints
+	void ch_moveBox(unsigned int handle, const double lo[3], const double hi[3]);
+
+	// the boxes, their sorted endpoints on every axis and the removed handles
+	vector<ch_box> boxes;
+	vector<ch_endpoint> endpoints[3];
+	vector<unsigned int> freeBoxes;
+
+	// objects overlapping every tool
+	vector<vector<unsigned int> > toolOverlaps;
+	vector<unsigned int> freeTools;
+
+	unsigned long long numSwaps;
+};
+
+#endif
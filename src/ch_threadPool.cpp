@@ -0,0 +1,160 @@
+#include "ch_threadPool.h"
+
+// system includes
+#include <algorithm>
+
+
+// constructor
+ch_threadPool::ch_threadPool(unsigned int numThreads)
+{
+	numPending = 0;
+	stopping = false;
+
+	if (numThreads == 0)
+		numThreads = max(1u, thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < numThreads; i++)
+		workers.push_back(thread(&ch_threadPool::ch_workerLoop, this));
+}
+
+
+// destructor
+ch_threadPool::~ch_threadPool()
+{
+	ch_wait();
+
+	{
+		lock_guard<mutex> lock(taskMutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+
+// queue a task
+void ch_threadPool::ch_submit(const function<void()>& task)
+{
+	{
+		lock_guard<mutex> lock(taskMutex);
+		tasks.push_back(task);
+		numPending++;
+	}
+	taskAvailable.notify_one();
+}
+
+
+// wait until every task submitted so far has finished
+void ch_threadPool::ch_wait()
+{
+	for (;;)
+	{
+		// help with the queue first, then sleep until the running tasks are done
+		if (ch_runOne())
+			continue;
+
+		unique_lock<mutex> lock(taskMutex);
+		if (numPending == 0)
+			return;
+		if (tasks.empty())
+			taskFinished.wait(lock);
+	}
+}
+
+
+// run body over [0, count) in chunks
+void ch_threadPool::ch_parallelFor(unsigned int count, unsigned int grain, const function<void(unsigned int, unsigned int)>& body)
+{
+	if (count == 0)
+		return;
+
+	unsigned int numChunks = (count + max(grain, 1u) - 1) / max(grain, 1u);
+	if (numChunks <= 1 || workers.empty())
+	{
+		body(0, count);
+		return;
+	}
+
+	// the chunks of this loop only, other tasks may be queued or running at the same time. the count is
+	// changed and signalled under the lock: the caller may return, and take these off the stack, as soon
+	// as it sees the last chunk done
+	unsigned int remaining = numChunks;
+	mutex doneMutex;
+	condition_variable done;
+
+	for (unsigned int c = 0; c < numChunks; c++)
+	{
+		unsigned int first = (unsigned int)((unsigned long long)count * c / numChunks);
+		unsigned int last = (unsigned int)((unsigned long long)count * (c + 1) / numChunks);
+		ch_submit([&body, &remaining, &doneMutex, &done, first, last]()
+		{
+			body(first, last);
+
+			lock_guard<mutex> lock(doneMutex);
+			if (--remaining == 0)
+				done.notify_all();
+		});
+	}
+
+	// help with the queue, then sleep until the last chunks, running on other threads, are done
+	while (ch_runOne())
+	{
+		lock_guard<mutex> lock(doneMutex);
+		if (remaining == 0)
+			return;
+	}
+
+	unique_lock<mutex> lock(doneMutex);
+	done.wait(lock, [&remaining]() { return remaining == 0; });
+}
+
+
+// worker thread: run tasks until stopped
+void ch_threadPool::ch_workerLoop()
+{
+	for (;;)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(taskMutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				return;
+			task = tasks.front();
+			tasks.pop_front();
+		}
+
+		task();
+
+		{
+			lock_guard<mutex> lock(taskMutex);
+			numPending--;
+		}
+		taskFinished.notify_all();
+	}
+}
+
+
+// run one queued task
+bool ch_threadPool::ch_runOne()
+{
+	function<void()> task;
+	{
+		lock_guard<mutex> lock(taskMutex);
+		if (tasks.empty())
+			return false;
+		task = tasks.front();
+		tasks.pop_front();
+	}
+
+	task();
+
+	{
+		lock_guard<mutex> lock(taskMutex);
+		numPending--;
+	}
+	taskFinished.notify_all();
+	return true;
+}
@@ -0,0 +1,65 @@
+#ifndef CH_THREADPOOL_H
+#define CH_THREADPOOL_H
+
+// CH lab
+// fixed set of worker threads for load-time work: independent tasks, and loops split into chunks. a
+// thread that waits for its work runs queued tasks meanwhile, so parallel loops may be nested in tasks.
+// not meant for the haptic thread, which must never wait. no CHAI3D dependency
+
+// system includes
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+class ch_threadPool
+{
+public:
+
+	// constructor, starts numThreads workers, 0 picks the number of cores
+	ch_threadPool(unsigned int numThreads = 0);
+
+	// destructor, finishes the queued tasks and stops the workers
+	virtual ~ch_threadPool();
+
+	// queue a task
+	void ch_submit(const function<void()>& task);
+
+	// wait until every task submitted so far has finished
+	void ch_wait();
+
+	// run body(first, last) over [0, count) in chunks of about grain items on the workers and the calling
+	// thread, returns when all chunks are done
+	void ch_parallelFor(unsigned int count, unsigned int grain, const function<void(unsigned int, unsigned int)>& body);
+
+	// number of workers
+	inline unsigned int ch_getNumThreads() const { return (unsigned int)workers.size(); }
+
+protected:
+
+	// worker thread: run tasks until stopped
+	void ch_workerLoop();
+
+	// run one queued task if there is one, returns false if the queue was empty
+	bool ch_runOne();
+
+	vector<thread> workers;
+
+	// queued tasks and their synchronisation
+	deque<function<void()> > tasks;
+	mutex taskMutex;
+	condition_variable taskAvailable;
+	condition_variable taskFinished;
+
+	// tasks queued or running
+	unsigned int numPending;
+
+	bool stopping;
+};
+
+#endif
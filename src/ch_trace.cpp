@@ -0,0 +1,108 @@
+#include "ch_trace.h"
+
+// system includes
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+
+
+CH_THREAD_LOCAL ch_traceBuffer* ch_traceThreadBuffer = NULL;
+
+// registered threads, guarded by traceMutex
+static ch_traceBuffer traceBuffers[CH_TRACE_MAX_THREADS];
+static unsigned int numTraceBuffers = 0;
+static bool traceRunning = false;
+static mutex traceMutex;
+
+// ticks and clock at the start, to convert ticks to time when writing
+static unsigned long long startTicks = 0;
+static unsigned long long startClock = 0;
+
+
+// time stamp counter, or a monotonic clock in nanoseconds where there is none
+unsigned long long ch_readTraceClock()
+{
+	return (unsigned long long)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// start recording
+void ch_trace::ch_start()
+{
+	unique_lock<mutex> guard(traceMutex);
+
+	if (traceRunning)
+		return;
+
+	startClock = ch_readTraceClock();
+	startTicks = ch_readTraceTicks();
+	traceRunning = true;
+}
+
+
+// is tracing on?
+bool ch_trace::ch_isRunning()
+{
+	unique_lock<mutex> guard(traceMutex);
+	return traceRunning;
+}
+
+
+// trace the calling thread
+void ch_trace::ch_registerThread(const char* threadName)
+{
+	unique_lock<mutex> guard(traceMutex);
+
+	if (!traceRunning || ch_traceThreadBuffer || numTraceBuffers == CH_TRACE_MAX_THREADS)
+		return;
+
+	// the whole ring is allocated here, recording never allocates
+	ch_traceBuffer& buffer = traceBuffers[numTraceBuffers++];
+	buffer.threadName = threadName;
+	buffer.events.resize(CH_TRACE_CAPACITY);
+	buffer.numEvents = 0;
+
+	ch_traceThreadBuffer = &buffer;
+}
+
+
+// write every recorded event to a Chrome trace JSON file
+bool ch_trace::ch_write(const char* fileName)
+{
+	unique_lock<mutex> guard(traceMutex);
+
+	if (!traceRunning)
+		return false;
+
+	FILE* file = fopen(fileName, "w");
+	if (!file)
+		return false;
+
+	// the tick rate follows from the ticks and the clock elapsed since the start
+	unsigned long long elapsedTicks = ch_readTraceTicks() - startTicks;
+	unsigned long long elapsedClock = ch_readTraceClock() - startClock;
+	double microsecondsPerTick = (elapsedTicks > 0) ? 0.001 * (double)elapsedClock / (double)elapsedTicks : 0.0;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"chl_task4\"}}");
+
+	for (unsigned int t = 0; t < numTraceBuffers; t++)
+	{
+		const ch_traceBuffer& buffer = traceBuffers[t];
+
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", t + 1, buffer.threadName);
+
+		// only the newest CH_TRACE_CAPACITY events are still in the ring
+		unsigned long long first = (buffer.numEvents > CH_TRACE_CAPACITY) ? buffer.numEvents - CH_TRACE_CAPACITY : 0;
+		for (unsigned long long i = first; i < buffer.numEvents; i++)
+		{
+			const ch_traceEvent& event = buffer.events[(size_t)(i % CH_TRACE_CAPACITY)];
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.name, t + 1,
+				(double)(event.begin - startTicks) * microsecondsPerTick, (double)(event.end - event.begin) * microsecondsPerTick);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+
+	return (fclose(file) == 0);
+}
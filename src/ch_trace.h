@@ -0,0 +1,141 @@
+#ifndef CH_TRACE_H
+#define CH_TRACE_H
+
+// CH lab
+// scoped stage timings of the haptic and graphics loops, written as Chrome trace JSON (chrome://tracing,
+// ui.perfetto.dev). a scope reads the time stamp counter twice and stores one event in a buffer of the
+// calling thread: no lock, no allocation, no system call. threads that are not registered, eg. when
+// tracing is off, only test one pointer per scope. define CH_NO_TRACE to compile the scopes out
+
+// system includes
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CH_THREAD_LOCAL __declspec(thread)
+#else
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#define CH_THREAD_LOCAL __thread
+#endif
+
+using namespace std;
+
+// events kept per thread, the oldest ones are overwritten (about two minutes of a 1 kHz loop with eight scopes)
+#define CH_TRACE_CAPACITY (1 << 20)
+
+// number of threads that can be traced
+#define CH_TRACE_MAX_THREADS 16
+
+
+// time stamp counter, or a monotonic clock in nanoseconds where there is none
+unsigned long long ch_readTraceClock();
+
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+inline unsigned long long ch_readTraceTicks() { return __rdtsc(); }
+#else
+inline unsigned long long ch_readTraceTicks() { return ch_readTraceClock(); }
+#endif
+
+
+// one timed scope
+struct ch_traceEvent
+{
+	// name of the stage, a string literal
+	const char* name;
+
+	// ticks at the start and the end of the scope
+	unsigned long long begin;
+	unsigned long long end;
+};
+
+
+// events of one thread
+struct ch_traceBuffer
+{
+	// name of the thread in the trace
+	const char* threadName;
+
+	// ring of CH_TRACE_CAPACITY events
+	vector<ch_traceEvent> events;
+
+	// number of events recorded so far, the next one goes to events[numEvents % CH_TRACE_CAPACITY]
+	unsigned long long numEvents;
+
+	// record one event
+	inline void ch_add(const char* name, unsigned long long begin, unsigned long long end)
+	{
+		ch_traceEvent& event = events[(size_t)(numEvents % CH_TRACE_CAPACITY)];
+		event.name = name;
+		event.begin = begin;
+		event.end = end;
+		numEvents++;
+	}
+};
+
+
+// buffer of the calling thread, NULL if the thread is not traced
+extern CH_THREAD_LOCAL ch_traceBuffer* ch_traceThreadBuffer;
+
+
+class ch_trace
+{
+public:
+
+	// start recording, threads registered from now on are traced
+	static void ch_start();
+
+	// is tracing on?
+	static bool ch_isRunning();
+
+	// trace the calling thread under the given name (a string literal). does nothing if tracing is off
+	static void ch_registerThread(const char* threadName);
+
+	// write every recorded event to a Chrome trace JSON file, once the traced threads have stopped.
+	// returns false if the file cannot be written
+	static bool ch_write(const char* fileName);
+};
+
+
+// times the enclosing scope
+class ch_traceScope
+{
+public:
+
+	// constructor, the scope starts
+	inline explicit ch_traceScope(const char* a_name)
+	{
+		buffer = ch_traceThreadBuffer;
+		if (buffer)
+		{
+			name = a_name;
+			begin = ch_readTraceTicks();
+		}
+	}
+
+	// destructor, the scope ends
+	inline ~ch_traceScope()
+	{
+		if (buffer)
+			buffer->ch_add(name, begin, ch_readTraceTicks());
+	}
+
+protected:
+
+	ch_traceBuffer* buffer;
+	const char* name;
+	unsigned long long begin;
+};
+
+
+#define CH_TRACE_CONCAT2(a, b) a##b
+#define CH_TRACE_CONCAT(a, b) CH_TRACE_CONCAT2(a, b)
+
+#if defined(CH_NO_TRACE)
+#define CH_TRACE_SCOPE(name)
+#else
+#define CH_TRACE_SCOPE(name) ch_traceScope CH_TRACE_CONCAT(ch_traceScope_, __LINE__)(name)
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef CH_TRIPLEBUFFER_H
+#define CH_TRIPLEBUFFER_H
+
+// CH lab
+// lock-free triple buffer: one writer thread publishes complete values, one reader thread always gets
+// the latest published value without waiting and without the writer ever touching what it reads
+
+// system includes
+#include <atomic>
+
+using namespace std;
+
+
+template <class T>
+class ch_tripleBuffer
+{
+public:
+
+	// constructor
+	ch_tripleBuffer() : middle(1)
+	{
+		back = 0;
+		front = 2;
+	}
+
+	// destructor
+	virtual ~ch_tripleBuffer() {}
+
+	// any of the three buffers, eg. to initialise all of them before the threads start
+	inline T& ch_getBuffer(int i) { return buffers[i]; }
+
+	// writer: the buffer to fill next
+	inline T& ch_getWriteBuffer() { return buffers[back]; }
+
+	// writer: index of the buffer to fill next, stays with the buffer until ch_publish()
+	inline int ch_getWriteIndex() const { return back; }
+
+	// writer: make the write buffer the latest value and continue on the buffer the reader does not hold
+	inline void ch_publish()
+	{
+		back = (int)(middle.exchange((unsigned int)back | FRESH) & INDEX);
+	}
+
+	// reader: the latest published value, valid until the next call
+	inline const T& ch_acquire()
+	{
+		if (middle.load() & FRESH)
+			front = (int)(middle.exchange((unsigned int)front) & INDEX);
+		return buffers[front];
+	}
+
+	// reader: the value returned by the last ch_acquire()
+	inline const T& ch_getReadBuffer() const { return buffers[front]; }
+
+	// reader: index of the buffer returned by the last ch_acquire()
+	inline int ch_getReadIndex() const { return front; }
+
+	// has the writer published a value the reader has not acquired yet?
+	inline bool ch_hasNewValue() const { return (middle.load() & FRESH) != 0; }
+
+protected:
+
+	// the middle index carries this bit while it holds a value the reader has not seen
+	static const unsigned int FRESH = 4;
+	static const unsigned int INDEX = 3;
+
+	T buffers[3];
+
+	// buffer exchanged between writer and reader, with the FRESH bit
+	atomic<unsigned int> middle;
+
+	// buffers owned by the writer and the reader
+	int back;
+	int front;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include "ch_uniformGrid.h"
+
+// system includes
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// largest number of cells along one axis that still fits the 21 bit key fields
+#define CH_GRID_MAX_DIM 2000000
+
+// never let the grid grow beyond this many cells per triangle
+#define CH_GRID_MAX_CELLS_PER_TRIANGLE 64.0
+
+
+// constructor
+ch_uniformGrid::ch_uniformGrid()
+{
+	built = false;
+	cellSize = 0.0;
+	dims[0] = dims[1] = dims[2] = 0;
+}
+
+
+// cell size derived from the triangle statistics
+double ch_uniformGrid::ch_computeCellSize(const ch_triangleArray& triangles)
+{
+	double extentSum = 0.0;
+
+	for (unsigned int i = 0; i < triangles.size(); i++)
+	{
+		// largest side of the triangle bounding box
+		ch_vec3 extent = ch_triangleBounds(triangles[i]).ch_extent();
+		extentSum += max(extent.x, max(extent.y, extent.z));
+	}
+
+	if (triangles.empty() || extentSum <= 0.0)
+		return 1.0;
+
+	// cells about one and a half triangles wide keep a few triangles per cell on evenly tessellated surfaces
+	return 1.5 * extentSum / triangles.size();
+}
+
+
+// build the grid over world space triangles
+void ch_uniformGrid::ch_build(const ch_triangleArray& triangles, double requestedCellSize)
+{
+	unsigned int numTriangles = (unsigned int)triangles.size();
+
+	built = false;
+	cellKeys.clear();
+	cellStart.clear();
+	cellTriangles.clear();
+	cellTable.ch_clear();
+
+	if (numTriangles == 0)
+		return;
+
+	// bounds of all triangles
+	bounds = ch_aabb();
+	for (unsigned int i = 0; i < numTriangles; i++)
+		bounds.ch_extend(ch_triangleBounds(triangles[i]));
+
+	cellSize = (requestedCellSize > 0.0) ? requestedCellSize : ch_computeCellSize(triangles);
+
+	// grow the cells until the grid resolution is bounded, both by the key size and by the triangle count
+	for (;;)
+	{
+		double numCells = 1.0;
+		bool fits = true;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double cells = floor((bounds.hi[axis] - bounds.lo[axis]) / cellSize) + 1.0;
+			fits = fits && (cells < CH_GRID_MAX_DIM);
+			numCells *= cells;
+		}
+		if (fits && numCells <= CH_GRID_MAX_CELLS_PER_TRIANGLE * numTriangles)
+			break;
+		cellSize *= 2.0;
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+		dims[axis] = (int)floor((bounds.hi[axis] - bounds.lo[axis]) / cellSize) + 1;
+
+	// bin every triangle into all cells overlapped by its bounding box
+	vector< pair<unsigned long long, unsigned int> > references;
+	references.reserve(2 * numTriangles);
+
+	for (unsigned int i = 0; i < numTriangles; i++)
+	{
+		ch_aabb box = ch_triangleBounds(triangles[i]);
+		int lo[3], hi[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			lo[axis] = ch_cellCoord(box.lo[axis], axis);
+			hi[axis] = ch_cellCoord(box.hi[axis], axis);
+		}
+
+		for (int iz = lo[2]; iz <= hi[2]; iz++)
+			for (int iy = lo[1]; iy <= hi[1]; iy++)
+				for (int ix = lo[0]; ix <= hi[0]; ix++)
+					references.push_back(make_pair(ch_packCellKey(ix, iy, iz), i));
+	}
+
+	// sorting by key stores the triangles of a cell next to each other
+	sort(references.begin(), references.end());
+
+	cellTriangles.resize(references.size());
+	for (unsigned int i = 0; i < references.size(); i++)
+	{
+		if (i == 0 || references[i].first != references[i - 1].first)
+		{
+			cellKeys.push_back(references[i].first);
+			cellStart.push_back(i);
+		}
+		cellTriangles[i] = references[i].second;
+	}
+	cellStart.push_back((unsigned int)references.size());
+
+	cellTable.ch_build(cellKeys);
+
+	built = true;
+}
+
+
+// cell coordinate of a position along one axis, clamped to the grid
+int ch_uniformGrid::ch_cellCoord(double value, int axis) const
+{
+	int c = (int)floor((value - bounds.lo[axis]) / cellSize);
+	return (c < 0) ? 0 : ((c >= dims[axis]) ? dims[axis] - 1 : c);
+}
+
+
+// start a 3D-DDA walk along the segment
+bool ch_uniformGrid::ch_beginWalk(const ch_vec3& segmentStart, const ch_vec3& segmentEnd, ch_gridWalk& walk) const
+{
+	ch_vec3 direction = segmentEnd - segmentStart;
+
+	walk.done = true;
+	if (!built)
+		return false;
+
+	// clip the segment against the grid bounds
+	double tStart = 0.0, tEnd = 1.0;
+	if (!ch_clipSegmentToBox(bounds, segmentStart, direction, tStart, tEnd))
+		return false;
+
+	// set up the walk from the cell that contains the clipped start point
+	for (int axis = 0; axis < 3; axis++)
+	{
+		walk.cell[axis] = ch_cellCoord(segmentStart[axis] + tStart * direction[axis], axis);
+
+		if (direction[axis] > SMALL_NUM)
+		{
+			walk.step[axis] = 1;
+			walk.tMax[axis] = (bounds.lo[axis] + (walk.cell[axis] + 1) * cellSize - segmentStart[axis]) / direction[axis];
+			walk.tDelta[axis] = cellSize / direction[axis];
+		}
+		else if (direction[axis] < -SMALL_NUM)
+		{
+			walk.step[axis] = -1;
+			walk.tMax[axis] = (bounds.lo[axis] + walk.cell[axis] * cellSize - segmentStart[axis]) / direction[axis];
+			walk.tDelta[axis] = -cellSize / direction[axis];
+		}
+		else
+		{
+			walk.step[axis] = 0;
+			walk.tMax[axis] = DBL_MAX;
+			walk.tDelta[axis] = DBL_MAX;
+		}
+	}
+
+	walk.tEnd = tEnd;
+	walk.tCellExit = tStart;
+	walk.done = false;
+	return true;
+}
+
+
+// advance the walk to the next occupied cell
+bool ch_uniformGrid::ch_nextCell(ch_gridWalk& walk, const unsigned int*& first, const unsigned int*& last) const
+{
+	while (!walk.done)
+	{
+		int ix = walk.cell[0], iy = walk.cell[1], iz = walk.cell[2];
+
+		// step into the neighbour across the nearest cell boundary
+		int axis = (walk.tMax[0] < walk.tMax[1]) ? ((walk.tMax[0] < walk.tMax[2]) ? 0 : 2) : ((walk.tMax[1] < walk.tMax[2]) ? 1 : 2);
+		double tExit = walk.tMax[axis];
+
+		walk.cell[axis] += walk.step[axis];
+		walk.tMax[axis] += walk.tDelta[axis];
+
+		if (tExit >= walk.tEnd || walk.cell[axis] < 0 || walk.cell[axis] >= dims[axis])
+		{
+			walk.done = true;
+			tExit = walk.tEnd;
+		}
+		walk.tCellExit = tExit;
+
+		int index = cellTable.ch_find(ch_packCellKey(ix, iy, iz));
+		if (index >= 0)
+		{
+			first = &cellTriangles[cellStart[index]];
+			last = &cellTriangles[0] + cellStart[index + 1];
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,104 @@
+#ifndef CH_UNIFORMGRID_H
+#define CH_UNIFORMGRID_H
+
+// CH lab
+// hashed uniform grid over the triangles of an object, walked with 3D-DDA by the segment checker
+
+// system includes
+#include <vector>
+
+// local includes
+#include "ch_geometry.h"
+#include "ch_spatialHash.h"
+
+using namespace std;
+
+// state of a 3D-DDA walk along a segment, filled by ch_uniformGrid::ch_beginWalk()
+struct ch_gridWalk
+{
+	// current cell
+	int cell[3];
+
+	// +1/-1 step along each axis
+	int step[3];
+
+	// segment parameter at which the next cell boundary on each axis is crossed
+	double tMax[3];
+
+	// segment parameter covered by one cell along each axis
+	double tDelta[3];
+
+	// segment parameter at which the segment leaves the grid bounds
+	double tEnd;
+
+	// segment parameter at which the segment leaves the cell returned last
+	double tCellExit;
+
+	// no more cells to visit
+	bool done;
+};
+
+
+class ch_uniformGrid
+{
+public:
+
+	// constructor
+	ch_uniformGrid();
+
+	// destructor
+	virtual ~ch_uniformGrid() {};
+
+	// build the grid over world space triangles. a cell size <= 0 picks one from the triangle statistics
+	void ch_build(const ch_triangleArray& triangles, double requestedCellSize = 0.0);
+
+	// cell size derived from the triangle statistics: about one and a half mean triangle extents
+	static double ch_computeCellSize(const ch_triangleArray& triangles);
+
+	// start a 3D-DDA walk along the segment, returns false if the segment misses the grid bounds
+	bool ch_beginWalk(const ch_vec3& segmentStart, const ch_vec3& segmentEnd, ch_gridWalk& walk) const;
+
+	// advance the walk to the next occupied cell and return its triangle indices as [first, last)
+	bool ch_nextCell(ch_gridWalk& walk, const unsigned int*& first, const unsigned int*& last) const;
+
+	// has the grid been built?
+	inline bool ch_isBuilt() const { return built; }
+
+	// edge length of a cell
+	inline double ch_getCellSize() const { return cellSize; }
+
+	// number of cells that contain at least one triangle
+	inline unsigned int ch_getNumOccupiedCells() const { return (unsigned int)cellKeys.size(); }
+
+	// number of triangle references stored over all cells
+	inline unsigned int ch_getNumReferences() const { return (unsigned int)cellTriangles.size(); }
+
+protected:
+
+	// cell coordinate of a position along one axis, clamped to the grid
+	int ch_cellCoord(double value, int axis) const;
+
+	// has the grid been built?
+	bool built;
+
+	// bounds of all triangles
+	ch_aabb bounds;
+
+	// edge length of a cell
+	double cellSize;
+
+	// number of cells along each axis
+	int dims[3];
+
+	// occupied cells: key, start into cellTriangles (one extra entry at the end)
+	vector<unsigned long long> cellKeys;
+	vector<unsigned int> cellStart;
+
+	// triangle indices of all occupied cells, stored contiguously per cell
+	vector<unsigned int> cellTriangles;
+
+	// index into cellKeys for every occupied cell
+	ch_spatialHash cellTable;
+};
+
+#endif
@@ -0,0 +1,378 @@
+// CH lab
+// checks of the CHAI3D-free core against brute force: the grid, the tree and the convex collider against
+// testing every triangle, the closest point search against the closest point of every triangle, the
+// feature tracker against ch_locate() and the parallel loops of the thread pool
+//
+// usage: ch_coreTest, returns 0 if every check passed
+
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+//------------------------------------------------------------------------------
+#include "../src/ch_aabbTree.h"
+#include "../src/ch_convexCollider.h"
+#include "../src/ch_featureTracker.h"
+#include "../src/ch_sceneGenerator.h"
+#include "../src/ch_threadPool.h"
+#include "../src/ch_uniformGrid.h"
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+
+//---------------------------------------------------------------------------
+// DECLARED CONSTANTS
+//---------------------------------------------------------------------------
+
+// triangles of the generated meshes
+const unsigned int TEST_TRIANGLES = 2000;
+
+// queries per mesh and check
+const unsigned int TEST_SAMPLES = 2000;
+
+// largest difference of two distances or segment parameters that still counts as equal
+const double TEST_TOLERANCE = 1.0e-9;
+
+
+//---------------------------------------------------------------------------
+// DECLARED VARIABLES
+//---------------------------------------------------------------------------
+
+// random generator state, reset per check so that every check sees the same queries
+unsigned int seed = 1;
+
+// failed checks
+unsigned int numFailures = 0;
+
+
+//---------------------------------------------------------------------------
+// HELPERS
+//---------------------------------------------------------------------------
+
+// uniform random number in [0, 1)
+double random01()
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) / 16777216.0;
+}
+
+
+// random point in the cube of edge 2 * extent around the origin
+ch_vec3 randomPoint(double extent)
+{
+	return ch_vec3((2.0 * random01() - 1.0) * extent, (2.0 * random01() - 1.0) * extent, (2.0 * random01() - 1.0) * extent);
+}
+
+
+// print the outcome of a check
+void report(const char* check, const char* mesh, unsigned int numErrors, unsigned int numQueries)
+{
+	printf("%-32s %-10s %s (%u of %u queries differ)\n", check, mesh, numErrors ? "FAILED" : "ok", numErrors, numQueries);
+	if (numErrors)
+		numFailures++;
+}
+
+
+// segments of the device: half cross the surface at a random point of a random triangle, half are random
+void makeSegments(const ch_triangleArray& triangles, vector<ch_vec3>& starts, vector<ch_vec3>& directions)
+{
+	seed = 1;
+	starts.resize(TEST_SAMPLES);
+	directions.resize(TEST_SAMPLES);
+
+	for (unsigned int i = 0; i < TEST_SAMPLES; i++)
+	{
+		if (i % 2)
+		{
+			starts[i] = randomPoint(0.6);
+			directions[i] = randomPoint(0.6) - starts[i];
+			continue;
+		}
+
+		const ch_triangle& triangle = triangles[(unsigned int)(random01() * triangles.size()) % triangles.size()];
+		double a = random01(), b = random01();
+		if (a + b > 1.0)
+		{
+			a = 1.0 - a;
+			b = 1.0 - b;
+		}
+		ch_vec3 point = triangle.v0 + (triangle.v1 - triangle.v0) * a + (triangle.v2 - triangle.v0) * b;
+		ch_vec3 normal(triangle.normal.x, triangle.normal.y, triangle.normal.z);
+		starts[i] = point + normal * 0.01 + randomPoint(0.005);
+		directions[i] = point - normal * 0.01 + randomPoint(0.005) - starts[i];
+	}
+}
+
+
+// every triangle the segment enters, sorted
+void hitsLinear(const ch_triangleArray& triangles, const ch_vec3& start, const ch_vec3& direction, vector<unsigned int>& hits)
+{
+	ch_vec3 point;
+	double t;
+
+	hits.clear();
+	for (unsigned int i = 0; i < triangles.size(); i++)
+	{
+		if (ch_intersectSegmentTriangle(triangles[i], start, direction, t, point) == CH_HIT)
+			hits.push_back(i);
+	}
+}
+
+
+// the same through the cells of the grid, a triangle of several cells is reported once
+void hitsGrid(const ch_uniformGrid& grid, const ch_triangleArray& triangles, const ch_vec3& start, const ch_vec3& direction, vector<unsigned int>& hits)
+{
+	ch_gridWalk walk;
+	const unsigned int *first, *last;
+	ch_vec3 point;
+	double t;
+
+	hits.clear();
+	if (!grid.ch_beginWalk(start, start + direction, walk))
+		return;
+
+	while (grid.ch_nextCell(walk, first, last))
+	{
+		for (; first != last; ++first)
+		{
+			if (ch_intersectSegmentTriangle(triangles[*first], start, direction, t, point) == CH_HIT)
+				hits.push_back(*first);
+		}
+	}
+	sort(hits.begin(), hits.end());
+	hits.erase(unique(hits.begin(), hits.end()), hits.end());
+}
+
+
+// the same through the leaves of the tree
+void hitsTree(const ch_aabbTree& tree, const ch_triangleArray& triangles, const ch_vec3& start, const ch_vec3& direction, vector<unsigned int>& hits)
+{
+	ch_treeWalk walk;
+	const unsigned int *first, *last;
+	ch_vec3 point;
+	double t;
+
+	hits.clear();
+	tree.ch_beginWalk(start, direction, walk);
+	while (tree.ch_nextLeaf(walk, 1.0, first, last))
+	{
+		for (; first != last; ++first)
+		{
+			if (ch_intersectSegmentTriangle(triangles[*first], start, direction, t, point) == CH_HIT)
+				hits.push_back(*first);
+		}
+	}
+	sort(hits.begin(), hits.end());
+}
+
+
+//---------------------------------------------------------------------------
+// CHECKS
+//---------------------------------------------------------------------------
+
+// the grid and the tree report the same triangles as testing all of them
+void checkBroadphases(const char* mesh, const ch_triangleArray& triangles)
+{
+	ch_uniformGrid grid;
+	grid.ch_build(triangles);
+	ch_aabbTree tree;
+	tree.ch_build(triangles);
+
+	vector<ch_vec3> starts, directions;
+	makeSegments(triangles, starts, directions);
+
+	vector<unsigned int> reference, hits;
+	unsigned int gridErrors = 0, treeErrors = 0;
+	for (unsigned int i = 0; i < TEST_SAMPLES; i++)
+	{
+		hitsLinear(triangles, starts[i], directions[i], reference);
+
+		hitsGrid(grid, triangles, starts[i], directions[i], hits);
+		if (hits != reference)
+			gridErrors++;
+
+		hitsTree(tree, triangles, starts[i], directions[i], hits);
+		if (hits != reference)
+			treeErrors++;
+	}
+
+	report("grid against linear", mesh, gridErrors, TEST_SAMPLES);
+	report("tree against linear", mesh, treeErrors, TEST_SAMPLES);
+}
+
+
+// the convex collider enters where the nearest triangle hit is
+void checkConvex(const char* mesh, const ch_triangleArray& triangles)
+{
+	ch_convexCollider collider;
+	if (!collider.ch_build(triangles))
+	{
+		report("convex build", mesh, 1, 1);
+		return;
+	}
+
+	vector<ch_vec3> starts, directions;
+	makeSegments(triangles, starts, directions);
+
+	unsigned int errors = 0;
+	for (unsigned int i = 0; i < TEST_SAMPLES; i++)
+	{
+		double tNearest = 2.0, t;
+		ch_vec3 point;
+		for (unsigned int k = 0; k < triangles.size(); k++)
+		{
+			if (ch_intersectSegmentTriangle(triangles[k], starts[i], directions[i], t, point) == CH_HIT)
+				tNearest = min(tNearest, t);
+		}
+
+		unsigned int face;
+		bool hit = collider.ch_intersectSegment(starts[i], directions[i], t, face);
+		if (hit != (tNearest <= 1.0) || (hit && fabs(t - tNearest) > TEST_TOLERANCE))
+			errors++;
+	}
+
+	report("convex against linear", mesh, errors, TEST_SAMPLES);
+}
+
+
+// the tree finds the closest point as near as the closest point of every triangle
+void checkClosestPoint(const char* mesh, const ch_triangleArray& triangles)
+{
+	ch_aabbTree tree;
+	tree.ch_build(triangles);
+
+	// a radius that most points reach the surface within, and some do not
+	const double radius = 0.1;
+	seed = 1;
+
+	unsigned int errors = 0;
+	for (unsigned int i = 0; i < TEST_SAMPLES; i++)
+	{
+		ch_vec3 point = randomPoint(0.6);
+
+		double reference = radius * radius;
+		for (unsigned int k = 0; k < triangles.size(); k++)
+			reference = min(reference, ch_distanceSq(point, ch_closestPointOnTriangle(point, triangles[k].v0, triangles[k].v1, triangles[k].v2)));
+		bool found = reference < radius * radius;
+
+		ch_vec3 closest;
+		double distanceSq;
+		int triangle = tree.ch_findClosest(triangles, point, radius * radius, closest, distanceSq);
+		if ((triangle >= 0) != found || (found && fabs(sqrt(distanceSq) - sqrt(reference)) > TEST_TOLERANCE))
+			errors++;
+	}
+
+	report("closest point against linear", mesh, errors, TEST_SAMPLES);
+}
+
+
+// the tracker finds the feature ch_locate() finds along a path around the object through faces, edges and
+// corners, in and out, without giving up on its walk
+void checkFeatureTracker(const char* mesh, const ch_triangleArray& triangles)
+{
+	ch_convexCollider collider;
+	if (!collider.ch_build(triangles))
+	{
+		report("feature tracker build", mesh, 1, 1);
+		return;
+	}
+
+	ch_featureTracker tracker(&collider);
+	ch_closestFeature tracked, located;
+	seed = 1;
+
+	// a random walk of small steps pulled back towards a sphere through the edges and corners
+	const unsigned int numTicks = 20 * TEST_SAMPLES;
+	ch_vec3 point(0.75, 0.1, 0.2);
+	unsigned int errors = 0;
+	for (unsigned int i = 0; i < numTicks; i++)
+	{
+		double length = ch_length(point);
+		point += randomPoint(0.01) - point * (0.02 * (length - 0.75) / length);
+
+		tracker.ch_update(point, tracked);
+		ch_featureTracker::ch_locate(collider, point, located);
+		if (fabs(tracked.distance - located.distance) > TEST_TOLERANCE || ch_distance(tracked.point, located.point) > TEST_TOLERANCE)
+			errors++;
+	}
+
+	report("feature tracker against locate", mesh, errors, numTicks);
+	report("feature tracker fallbacks", mesh, (unsigned int)tracker.ch_getNumFallbacks(), numTicks);
+	if (tracker.ch_getNumSteps() == 0)
+		report("feature tracker steps", mesh, 1, numTicks);
+}
+
+
+// parallel loops cover every item once, also nested in tasks
+void checkThreadPool()
+{
+	ch_threadPool pool(4);
+	const unsigned int count = 1000;
+	vector<unsigned int> visits(count * count, 0);
+
+	unsigned int errors = 0;
+	for (unsigned int run = 0; run < 100; run++)
+	{
+		fill(visits.begin(), visits.end(), 0u);
+		pool.ch_parallelFor(count, 100, [&pool, &visits, count](unsigned int first, unsigned int last)
+		{
+			for (unsigned int i = first; i < last; i++)
+			{
+				pool.ch_parallelFor(count, 64, [&visits, count, i](unsigned int innerFirst, unsigned int innerLast)
+				{
+					for (unsigned int j = innerFirst; j < innerLast; j++)
+						visits[i * count + j]++;
+				});
+			}
+		});
+
+		if (count_if(visits.begin(), visits.end(), [](unsigned int v) { return v != 1; }) != 0)
+			errors++;
+	}
+
+	report("nested parallel loops", "-", errors, 100);
+}
+
+
+//---------------------------------------------------------------------------
+// MAIN
+//---------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+	printf("CH lab - checks of the CHAI3D-free core\n\n");
+
+	for (int type = 0; type < CH_NUM_SCENE_TYPES; type++)
+	{
+		ch_sceneGenerator generator;
+		generator.ch_generate((ch_sceneType)type, TEST_TRIANGLES);
+		ch_triangleArray triangles;
+		generator.ch_getTriangles(triangles);
+
+		const char* mesh = ch_sceneGenerator::ch_getName((ch_sceneType)type);
+		checkBroadphases(mesh, triangles);
+		checkClosestPoint(mesh, triangles);
+	}
+
+	// convex meshes: the box, and a sphere coarse enough for the face limit of the collider
+	ch_sceneType convexTypes[2] = { CH_SCENE_BOX, CH_SCENE_ICOSPHERE };
+	unsigned int convexTriangles[2] = { TEST_TRIANGLES, 80 };
+	for (int c = 0; c < 2; c++)
+	{
+		ch_sceneGenerator generator;
+		generator.ch_generate(convexTypes[c], convexTriangles[c]);
+		ch_triangleArray triangles;
+		generator.ch_getTriangles(triangles);
+
+		const char* mesh = ch_sceneGenerator::ch_getName(convexTypes[c]);
+		checkConvex(mesh, triangles);
+		checkFeatureTracker(mesh, triangles);
+	}
+
+	checkThreadPool();
+
+	printf("\n%s\n", numFailures ? "FAILED" : "all checks passed");
+	return numFailures ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+// CH lab
+// console monitor of the haptic loop: reads the state the application publishes in shared memory, without
+// locks and without any effect on the haptic thread
+//
+// usage: ch_stateMonitor [--name segment] [--rate hz]
+
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+//------------------------------------------------------------------------------
+#include "../src/ch_sharedState.h"
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+
+int main(int argc, char* argv[])
+{
+	const char* name = CH_STATE_NAME;
+	double rate = 10.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--name") == 0 && i + 1 < argc)
+		{
+			name = argv[++i];
+		}
+		else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+		{
+			rate = atof(argv[++i]);
+		}
+		else
+		{
+			printf("usage: %s [--name segment] [--rate hz]\n", argv[0]);
+			return (-1);
+		}
+	}
+
+	// wait for the application to create the segment
+	ch_sharedState sharedState;
+	while (!sharedState.ch_open(name))
+	{
+		printf("waiting for %s ...\n", name);
+		this_thread::sleep_for(chrono::seconds(1));
+	}
+
+	ch_hapticState state;
+	unsigned long long lastTick = 0;
+	chrono::milliseconds period((long long)(1000.0 / (rate > 0.0 ? rate : 10.0)));
+
+	for (;;)
+	{
+		if (!sharedState.ch_read(state))
+		{
+			printf("writer busy\n");
+		}
+		else if (state.tick != lastTick)
+		{
+			printf("tick %10llu  t %8.3f s  proxy (%7.4f %7.4f %7.4f)  device (%7.4f %7.4f %7.4f)  force (%6.2f %6.2f %6.2f)  contacts %2u",
+				state.tick, state.time, state.proxyPos[0], state.proxyPos[1], state.proxyPos[2], state.devicePos[0], state.devicePos[1], state.devicePos[2],
+				state.force[0], state.force[1], state.force[2], state.numContacts);
+			printf("  period %.3f/%.3f/%.3f ms (last/mean/max)  overruns %llu",
+				1000.0 * state.tickPeriod, 1000.0 * state.meanTickPeriod, 1000.0 * state.maxTickPeriod, state.numOverruns);
+			printf("  skipped %5.1f %% of queries, %4u ahead on %.1f mm\n",
+				state.numQueries ? 100.0 * state.numSkippedQueries / state.numQueries : 0.0, state.skipTicks, 1000.0 * state.clearance);
+			lastTick = state.tick;
+		}
+
+		this_thread::sleep_for(period);
+	}
+}